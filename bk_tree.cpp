@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+using namespace std;
+
+namespace fingerprints
+{
+
+BKTree::BKTree()
+{
+
+}
+
+void BKTree::preprocess(const vector<string> &wordsIn)
+{
+    // We remove the duplicates, equal words would be stored as children at distance 0.
+    unordered_set<string> wordSet(wordsIn.begin(), wordsIn.end());
+
+    words.clear();
+    nodes.clear();
+    children.clear();
+    depth = 0;
+
+    if (wordSet.size() >= numeric_limits<uint32_t>::max())
+    {
+        throw invalid_argument("too many words for a BK-tree: " + to_string(wordSet.size()));
+    }
+
+    clock_t start, end;
+    start = std::clock();
+
+    // The children are collected per node during insertion and stored contiguously afterwards.
+    vector<vector<Child>> nodeChildren;
+    nodes.reserve(wordSet.size());
+    nodeChildren.reserve(wordSet.size());
+
+    for (const string &word : wordSet)
+    {
+        const uint32_t iNewNode = nodes.size();
+
+        nodes.push_back({ static_cast<uint32_t>(words.size()), static_cast<uint32_t>(word.size()), 0, 0 });
+        nodeChildren.emplace_back();
+        words += word;
+
+        if (iNewNode == 0)
+        {
+            depth = 1;
+            continue;
+        }
+
+        // We descend from the root along the edges labeled with the distance to the new word.
+        uint32_t iNode = 0;
+        size_t curDepth = 1;
+
+        while (true)
+        {
+            const Node &node = nodes[iNode];
+            const int bound = max(node.wordSize, static_cast<uint32_t>(word.size()));
+            const uint32_t distance = calcLevDistanceAtMost(getWord(node), node.wordSize, word.c_str(), word.size(), bound);
+
+            vector<Child> &curChildren = nodeChildren[iNode];
+            auto it = find_if(curChildren.begin(), curChildren.end(), [distance](const Child &child) {
+                return child.distance == distance;
+            });
+
+            curDepth += 1;
+
+            if (it == curChildren.end())
+            {
+                curChildren.push_back({ distance, iNewNode });
+                break;
+            }
+
+            iNode = it->iNode;
+        }
+
+        depth = max(depth, curDepth);
+    }
+
+    for (size_t iNode = 0; iNode < nodes.size(); ++iNode)
+    {
+        vector<Child> &curChildren = nodeChildren[iNode];
+
+        sort(curChildren.begin(), curChildren.end(), [](const Child &child1, const Child &child2) {
+            return child1.distance < child2.distance;
+        });
+
+        nodes[iNode].childrenStart = children.size();
+        nodes[iNode].nChildren = curChildren.size();
+
+        children.insert(children.end(), curChildren.begin(), curChildren.end());
+        vector<Child>().swap(curChildren);
+    }
+
+    end = std::clock();
+
+    float elapsedS = (end - start) / static_cast<float>(CLOCKS_PER_SEC);
+    elapsedUs = elapsedS * 1'000'000.0f;
+}
+
+int BKTree::test(const vector<string> &patterns, int k, int nIter)
+{
+    if (k < 0)
+    {
+        throw invalid_argument("bad k: " + to_string(k));
+    }
+
+    int nMatches = 0;
+    clock_t start, end;
+
+    start = std::clock();
+
+    for (int i = 0; i < nIter; ++i)
+    {
+        nMatches = 0;
+        processedWordsCount = 0;
+
+        if (nodes.empty())
+        {
+            continue;
+        }
+
+        for (const string &pattern : patterns)
+        {
+            nodesStack.clear();
+            nodesStack.push_back(0);
+
+            while (not nodesStack.empty())
+            {
+                const Node &node = nodes[nodesStack.back()];
+                nodesStack.pop_back();
+
+                const Child *curChildren = children.data() + node.childrenStart;
+                const Child *curChildrenEnd = curChildren + node.nChildren;
+
+                // If the distance exceeds the largest child distance by more than k, it does not matter by how much,
+                // since all children are pruned anyway.
+                const int maxChildDistance = (node.nChildren == 0) ? 0 : (curChildrenEnd - 1)->distance;
+                const int distance = calcLevDistanceAtMost(pattern.c_str(), pattern.size(),
+                    getWord(node), node.wordSize, maxChildDistance + k);
+
+                processedWordsCount += 1;
+
+                if (distance <= k)
+                {
+                    // Make sure that the number of results is returned in order to
+                    // prevent the compiler from overoptimizing unused results.
+                    nMatches += 1;
+                }
+
+                // By the triangle inequality, only children whose distance to this node is within k
+                // of the distance between this node and the pattern can match.
+                for (const Child *child = curChildren; child != curChildrenEnd; ++child)
+                {
+                    const int childDistance = child->distance;
+
+                    if (childDistance > distance + k)
+                    {
+                        break;
+                    }
+                    if (childDistance >= distance - k)
+                    {
+                        nodesStack.push_back(child->iNode);
+                    }
+                }
+            }
+        }
+    }
+
+    end = std::clock();
+
+    float elapsedS = (end - start) / static_cast<float>(CLOCKS_PER_SEC);
+    elapsedUs = elapsedS * 1'000'000.0f;
+
+    return nMatches;
+}
+
+size_t BKTree::getSizeB() const
+{
+    return words.size() + nodes.size() * sizeof(Node) + children.size() * sizeof(Child);
+}
+
+int BKTree::calcLevDistanceAtMost(const char *str1, size_t size1, const char *str2, size_t size2, int bound)
+{
+    const int size1s = size1;
+    const int size2s = size2;
+
+    // Each value is capped at bound + 1, which also serves as infinity outside of the strip.
+    const int overBound = bound + 1;
+
+    if (abs(size1s - size2s) > bound)
+    {
+        return overBound;
+    }
+    if (size1s == 0 or size2s == 0)
+    {
+        return max(size1s, size2s);
+    }
+
+    if (levV0.size() < size1 + 1)
+    {
+        levV0.resize(size1 + 1);
+        levV1.resize(size1 + 1);
+    }
+
+    for (int i1 = 0; i1 <= size1s; ++i1)
+    {
+        levV0[i1] = min(i1, overBound);
+    }
+
+    for (int i = 1; i <= size2s; ++i)
+    {
+        const int left = max(1, i - bound);
+        const int right = min(size1s, i + bound);
+
+        levV1[left - 1] = (left == 1) ? min(i, overBound) : overBound;
+        int rowMin = levV1[left - 1];
+
+        const char c = str2[i - 1];
+
+        for (int iCur = left; iCur <= right; ++iCur)
+        {
+            int val;
+
+            if (str1[iCur - 1] == c)
+            {
+                val = levV0[iCur - 1];
+            }
+            else
+            {
+                val = 1 + min(min(levV1[iCur - 1], levV0[iCur]), levV0[iCur - 1]);
+            }
+
+            levV1[iCur] = min(val, overBound);
+            rowMin = min(rowMin, levV1[iCur]);
+        }
+
+        // The cell just right of the strip is read as the upper neighbor in the next row.
+        if (right < size1s)
+        {
+            levV1[right + 1] = overBound;
+        }
+
+        if (rowMin > bound)
+        {
+            return overBound;
+        }
+
+        swap(levV0, levV1);
+    }
+
+    return levV0[size1s];
+}
+
+} // namespace fingerprints
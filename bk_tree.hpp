@@ -0,0 +1,82 @@
+#ifndef BK_TREE_HPP
+#define BK_TREE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fingerprints
+{
+
+/** A BK-tree (Burkhard-Keller metric tree) over the dictionary for the Levenshtein distance.
+ * Serves as a baseline for the fingerprint scan, the tree prunes subtrees using the triangle inequality. */
+class BKTree
+{
+public:
+    BKTree();
+
+    /** Constructs a tree which stores [words] (without duplicates) and sets elapsedUs to time elapsed during construction. */
+    void preprocess(const std::vector<std::string> &words);
+
+    /** Performs approximate matching for [patterns] and [k] errors, iterates [nIter] times.
+     * Returns the total number of matches. Sets elapsedUs to time elapsed during this matching. */
+    int test(const std::vector<std::string> &patterns, int k, int nIter = 1);
+
+    /** Returns total elapsed time during construction or testing in microseconds. */
+    float getElapsedUs() const { return elapsedUs; }
+    /** Returns the number of distance calculations (i.e. visited nodes) during a single test iteration. */
+    size_t getProcessedWordsCount() const { return processedWordsCount; }
+
+    /** Returns the number of nodes, i.e. the number of unique words. */
+    size_t getNodesCount() const { return nodes.size(); }
+    /** Returns the maximum depth of the tree, 1 for a single node and 0 for an empty tree. */
+    size_t getDepth() const { return depth; }
+    /** Returns the number of bytes used by the tree including the words. */
+    size_t getSizeB() const;
+
+    /** Returns the Levenshtein distance between [str1] of [size1] and [str2] of [size2] if it is at most [bound],
+     * and bound + 1 otherwise. Calculates only the 2 * bound + 1 strip and stops early once all its values exceed [bound]. */
+    int calcLevDistanceAtMost(const char *str1, size_t size1, const char *str2, size_t size2, int bound);
+
+private:
+    struct Node
+    {
+        /** Position and size of the word in words. */
+        uint32_t wordStart;
+        uint32_t wordSize;
+
+        /** Range of the children of this node in children, sorted by their distance. */
+        uint32_t childrenStart;
+        uint32_t nChildren;
+    };
+
+    struct Child
+    {
+        /** Distance between this child and its parent. */
+        uint32_t distance;
+        uint32_t iNode;
+    };
+
+    /** Returns the word stored in [node]. */
+    const char *getWord(const Node &node) const { return words.data() + node.wordStart; }
+
+    /** All words stored contiguously, nodes[0] is the root. */
+    std::string words;
+    std::vector<Node> nodes;
+    std::vector<Child> children;
+
+    size_t depth = 0;
+
+    /** Nodes to be visited during a single query, kept between queries in order to avoid reallocation. */
+    std::vector<uint32_t> nodesStack;
+
+    /** Rows of the Levenshtein distance calculation (previous and current), grown to the longest word when needed. */
+    std::vector<int> levV0, levV1;
+
+    float elapsedUs = 0.0f;
+    size_t processedWordsCount = 0;
+};
+
+} // namespace fingerprints
+
+#endif // BK_TREE_HPP
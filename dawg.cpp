@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace fingerprints
+{
+
+Dawg::Dawg()
+{
+    fill(letterBits, letterBits + 256, 0);
+
+    for (size_t i = 0; i < strlen(fingerprintLetters); ++i)
+    {
+        letterBits[static_cast<unsigned char>(fingerprintLetters[i])] = 0x1U << i;
+    }
+}
+
+void Dawg::preprocess(const vector<string> &wordsIn)
+{
+    // Incremental construction of a minimal automaton requires sorted words, and we remove the duplicates.
+    vector<string> words(wordsIn.begin(), wordsIn.end());
+    sort(words.begin(), words.end());
+    words.erase(unique(words.begin(), words.end()), words.end());
+
+    for (const string &word : words)
+    {
+        if (word.size() > numeric_limits<uint16_t>::max())
+        {
+            throw invalid_argument("word too long for a DAWG: " + to_string(word.size()));
+        }
+    }
+
+    clock_t start, end;
+    start = std::clock();
+
+    nWords = words.size();
+
+    buildNodes.assign(1, BuildNode());
+    buildPath.assign(1, 0);
+    freeBuildNodes.clear();
+    buildRegister.clear();
+    registeredNodes.clear();
+
+    const string *prevWord = nullptr;
+
+    for (const string &word : words)
+    {
+        size_t prefixSize = 0;
+
+        if (prevWord != nullptr)
+        {
+            while (prefixSize < word.size() and prefixSize < prevWord->size() and word[prefixSize] == (*prevWord)[prefixSize])
+            {
+                prefixSize += 1;
+            }
+        }
+
+        // The part of the previous word after the common prefix will not change anymore.
+        minimizePath(prefixSize);
+
+        for (size_t i = prefixSize; i < word.size(); ++i)
+        {
+            uint32_t iNewNode;
+
+            if (freeBuildNodes.empty())
+            {
+                iNewNode = buildNodes.size();
+                buildNodes.emplace_back();
+            }
+            else
+            {
+                iNewNode = freeBuildNodes.back();
+                freeBuildNodes.pop_back();
+            }
+
+            buildNodes[buildPath.back()].edges.push_back({ word[i], iNewNode });
+            buildPath.push_back(iNewNode);
+        }
+
+        buildNodes[buildPath.back()].isTerminal = true;
+        prevWord = &word;
+    }
+
+    minimizePath(0);
+    flatten(0);
+
+    vector<BuildNode>().swap(buildNodes);
+    vector<uint32_t>().swap(freeBuildNodes);
+    unordered_map<string, uint32_t>().swap(buildRegister);
+    vector<uint32_t>().swap(registeredNodes);
+
+    end = std::clock();
+
+    float elapsedS = (end - start) / static_cast<float>(CLOCKS_PER_SEC);
+    elapsedUs = elapsedS * 1'000'000.0f;
+}
+
+void Dawg::minimizePath(size_t depth)
+{
+    while (buildPath.size() > depth + 1)
+    {
+        const uint32_t iNode = buildPath.back();
+        buildPath.pop_back();
+
+        // Nodes on the path are always reached through the last edge of their parents.
+        const string signature = getSignature(buildNodes[iNode]);
+        auto it = buildRegister.find(signature);
+
+        if (it != buildRegister.end())
+        {
+            buildNodes[buildPath.back()].edges.back().second = it->second;
+
+            buildNodes[iNode] = BuildNode();
+            freeBuildNodes.push_back(iNode);
+        }
+        else
+        {
+            buildRegister.emplace(signature, iNode);
+            registeredNodes.push_back(iNode);
+        }
+    }
+}
+
+string Dawg::getSignature(const BuildNode &node) const
+{
+    string signature(1 + node.edges.size() * (1 + sizeof(uint32_t)), '\0');
+    signature[0] = node.isTerminal;
+
+    char *cur = &signature[1];
+
+    for (const pair<char, uint32_t> &edge : node.edges)
+    {
+        *cur = edge.first;
+        memcpy(cur + 1, &edge.second, sizeof(uint32_t));
+
+        cur += 1 + sizeof(uint32_t);
+    }
+
+    return signature;
+}
+
+void Dawg::flatten(uint32_t iRoot)
+{
+    // Fingerprints and suffix sizes are calculated for children before their parents.
+    vector<uint16_t> fingerprints(buildNodes.size(), 0);
+    vector<uint16_t> maxSuffixSizes(buildNodes.size(), 0);
+
+    registeredNodes.push_back(iRoot);
+
+    for (uint32_t iBuildNode : registeredNodes)
+    {
+        for (const pair<char, uint32_t> &edge : buildNodes[iBuildNode].edges)
+        {
+            fingerprints[iBuildNode] |= letterBits[static_cast<unsigned char>(edge.first)] | fingerprints[edge.second];
+            maxSuffixSizes[iBuildNode] = max<uint16_t>(maxSuffixSizes[iBuildNode], maxSuffixSizes[edge.second] + 1);
+        }
+    }
+
+    constexpr uint32_t noNode = numeric_limits<uint32_t>::max();
+    vector<uint32_t> flatIds(buildNodes.size(), noNode);
+
+    nodes.assign(1, Node());
+    edges.clear();
+
+    // Depth first order, the children of a node are numbered consecutively when it is visited,
+    // and the first child is visited next, so that a query usually moves to a nearby node.
+    vector<uint32_t> stack { iRoot };
+    vector<uint32_t> newChildren;
+    flatIds[iRoot] = 0;
+
+    while (not stack.empty())
+    {
+        const uint32_t iBuildNode = stack.back();
+        stack.pop_back();
+
+        const BuildNode &buildNode = buildNodes[iBuildNode];
+
+        nodes[flatIds[iBuildNode]] = { static_cast<uint32_t>(edges.size()), static_cast<uint16_t>(buildNode.edges.size()),
+            buildNode.isTerminal };
+
+        newChildren.clear();
+
+        for (const pair<char, uint32_t> &edge : buildNode.edges)
+        {
+            if (flatIds[edge.second] == noNode)
+            {
+                flatIds[edge.second] = nodes.size();
+                nodes.emplace_back();
+                newChildren.push_back(edge.second);
+            }
+
+            const uint16_t fingerprint = letterBits[static_cast<unsigned char>(edge.first)] | fingerprints[edge.second];
+            edges.push_back({ flatIds[edge.second], fingerprint, static_cast<uint16_t>(maxSuffixSizes[edge.second] + 1), edge.first });
+        }
+
+        stack.insert(stack.end(), newChildren.rbegin(), newChildren.rend());
+    }
+}
+
+int Dawg::test(const vector<string> &patterns, int k, int nIter)
+{
+    if (k < 0)
+    {
+        throw invalid_argument("bad k: " + to_string(k));
+    }
+
+    int nMatches = 0;
+    clock_t start, end;
+
+    // Values are capped at k + 1, which also serves as infinity outside of the 2k + 1 strip.
+    const int overBound = k + 1;
+
+    start = std::clock();
+
+    for (int i = 0; i < nIter; ++i)
+    {
+        nMatches = 0;
+        processedWordsCount = 0;
+
+        if (nodes.empty())
+        {
+            continue;
+        }
+
+        for (const string &pattern : patterns)
+        {
+            const int size = pattern.size();
+            const size_t rowSize = size + 1;
+
+            // Rows deeper than size + k are never calculated, since all their values would exceed k.
+            if (rows.size() < (size + k + 1) * rowSize)
+            {
+                rows.resize((size + k + 1) * rowSize);
+            }
+
+            const uint16_t patFingerprint = calcFingerprint(pattern.c_str(), size);
+
+            for (int j = 0; j <= size; ++j)
+            {
+                rows[j] = min(j, overBound);
+            }
+
+            processedWordsCount += 1;
+
+            if (nodes[0].isTerminal and size <= k)
+            {
+                nMatches += 1;
+            }
+
+            visitsStack.clear();
+            pushChildren(nodes[0], 0, 0, patFingerprint, size, k);
+
+            while (not visitsStack.empty())
+            {
+                const Visit visit = visitsStack.back();
+                visitsStack.pop_back();
+
+                const Node &node = nodes[visit.iNode];
+                const int depth = visit.depth;
+
+                const int *prev = rows.data() + (depth - 1) * rowSize;
+                int *cur = rows.data() + depth * rowSize;
+
+                const int left = max(1, depth - k);
+                const int right = min(size, depth + k);
+
+                cur[left - 1] = (left == 1) ? min(depth, overBound) : overBound;
+                int rowMin = cur[left - 1];
+
+                for (int j = left; j <= right; ++j)
+                {
+                    int val = prev[j - 1] + (pattern[j - 1] != visit.label);
+                    val = min(val, min(prev[j], cur[j - 1]) + 1);
+
+                    cur[j] = min(val, overBound);
+                    rowMin = min(rowMin, cur[j]);
+                }
+
+                // The cell just right of the strip is read as the upper neighbor in the next row.
+                if (right < size)
+                {
+                    cur[right + 1] = overBound;
+                }
+
+                processedWordsCount += 1;
+
+                if (node.isTerminal and abs(depth - size) <= k and cur[size] <= k)
+                {
+                    // Make sure that the number of results is returned in order to
+                    // prevent the compiler from overoptimizing unused results.
+                    nMatches += 1;
+                }
+
+                if (rowMin <= k and depth < size + k)
+                {
+                    pushChildren(node, depth, visit.prefixFingerprint, patFingerprint, size, k);
+                }
+            }
+        }
+    }
+
+    end = std::clock();
+
+    float elapsedS = (end - start) / static_cast<float>(CLOCKS_PER_SEC);
+    elapsedUs = elapsedS * 1'000'000.0f;
+
+    return nMatches;
+}
+
+void Dawg::pushChildren(const Node &node, int depth, uint16_t prefixFingerprint, uint16_t patFingerprint, int size, int k)
+{
+    const Edge *edgesEnd = edges.data() + node.edgesStart + node.nEdges;
+
+    for (const Edge *edge = edges.data() + node.edgesStart; edge != edgesEnd; ++edge)
+    {
+        // Words below the edge consist of the prefix and one of the suffixes, each letter of the pattern
+        // which does not occur in any of them requires an edit. The words are also at most this long.
+        const uint16_t missing = patFingerprint & ~(prefixFingerprint | edge->fingerprint);
+
+        if (static_cast<int>(bitset<16>(missing).count()) > k or depth + edge->maxSuffixSize + k < size)
+        {
+            continue;
+        }
+
+        visitsStack.push_back({ edge->target, static_cast<uint32_t>(depth + 1),
+            static_cast<uint16_t>(prefixFingerprint | letterBits[static_cast<unsigned char>(edge->label)]), edge->label });
+    }
+}
+
+size_t Dawg::getSizeB() const
+{
+    return nodes.size() * sizeof(Node) + edges.size() * sizeof(Edge);
+}
+
+uint16_t Dawg::calcFingerprint(const char *str, size_t size) const
+{
+    uint16_t fingerprint = 0;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        fingerprint |= letterBits[static_cast<unsigned char>(str[i])];
+    }
+
+    return fingerprint;
+}
+
+} // namespace fingerprints
@@ -0,0 +1,130 @@
+#ifndef DAWG_HPP
+#define DAWG_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fingerprints
+{
+
+/** A DAWG (a trie with equal subtrees merged, i.e. a minimal deterministic automaton) over the dictionary
+ * for the Levenshtein distance. Queries walk the graph depth first and simulate the Levenshtein automaton
+ * of the pattern with a banded dynamic programming row per visited node, shared prefixes are processed once.
+ * Each edge stores the occurrence fingerprint (as in Fingerprints) of all the suffixes starting with its label,
+ * which prunes subtrees lacking pattern letters before they are visited. */
+class Dawg
+{
+public:
+    Dawg();
+
+    /** Constructs a graph which stores [words] (without duplicates) and sets elapsedUs to time elapsed during construction. */
+    void preprocess(const std::vector<std::string> &words);
+
+    /** Performs approximate matching for [patterns] and [k] errors, iterates [nIter] times.
+     * Returns the total number of matches. Sets elapsedUs to time elapsed during this matching. */
+    int test(const std::vector<std::string> &patterns, int k, int nIter = 1);
+
+    /** Returns total elapsed time during construction or testing in microseconds. */
+    float getElapsedUs() const { return elapsedUs; }
+    /** Returns the number of visited nodes (i.e. calculated rows) during a single test iteration. */
+    size_t getProcessedWordsCount() const { return processedWordsCount; }
+
+    /** Returns the number of nodes after merging equal subtrees. */
+    size_t getNodesCount() const { return nodes.size(); }
+    /** Returns the number of edges. */
+    size_t getEdgesCount() const { return edges.size(); }
+    /** Returns the number of unique words. */
+    size_t getWordsCount() const { return nWords; }
+    /** Returns the number of bytes used by the graph. */
+    size_t getSizeB() const;
+
+    /** Returns the occurrence fingerprint of [str] having [size] chars over fingerprintLetters. */
+    uint16_t calcFingerprint(const char *str, size_t size) const;
+
+    /** Letters stored in fingerprints, the 16 most common English letters as for common occurrence fingerprints. */
+    static constexpr const char *fingerprintLetters = "etaoinshrdlcumwf";
+
+private:
+    struct Node
+    {
+        /** Range of the outgoing edges of this node in edges, sorted by their labels. */
+        uint32_t edgesStart;
+        uint16_t nEdges;
+
+        bool isTerminal;
+    };
+
+    struct Edge
+    {
+        uint32_t target;
+
+        /** Occurrence fingerprint of all the suffixes starting with this edge (i.e. OR of their fingerprints)
+         * and the size of the longest one, so that subtrees are pruned without visiting their nodes. */
+        uint16_t fingerprint;
+        uint16_t maxSuffixSize;
+
+        char label;
+    };
+
+    /** A node during construction, the edges of the nodes which are still being built change. */
+    struct BuildNode
+    {
+        bool isTerminal = false;
+        std::vector<std::pair<char, uint32_t>> edges;
+    };
+
+    /** Merges the nodes on the path of the previous word deeper than [depth] with equal registered nodes,
+     * or registers them. */
+    void minimizePath(size_t depth);
+    /** Returns the key identifying the subtree of [node] in the register. */
+    std::string getSignature(const BuildNode &node) const;
+    /** Pushes onto visitsStack the children of [node] at [depth] having [prefixFingerprint] which can contain
+     * matches for a pattern of [size] having [patFingerprint] and [k] errors. */
+    void pushChildren(const Node &node, int depth, uint16_t prefixFingerprint, uint16_t patFingerprint, int size, int k);
+    /** Converts buildNodes reachable from [iRoot] (the last node to be visited in registration order)
+     * into nodes and edges numbered in depth first order. */
+    void flatten(uint32_t iRoot);
+
+    /** Nodes during construction and the path of the previous word (starting with the root). Nodes merged
+     * with equal ones are reused, and the register maps signatures to the nodes which are final,
+     * in order of registration, which lists children before their parents. */
+    std::vector<BuildNode> buildNodes;
+    std::vector<uint32_t> buildPath;
+    std::vector<uint32_t> freeBuildNodes;
+    std::unordered_map<std::string, uint32_t> buildRegister;
+    std::vector<uint32_t> registeredNodes;
+
+    /** Maps chars to their bits in fingerprints, 0 for chars which are not stored. */
+    uint16_t letterBits[256];
+
+    /** Graph, nodes[0] is the root. */
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+
+    size_t nWords = 0;
+
+    /** A node to be visited during a query, the row for depth is calculated from the row at depth - 1 and label,
+     * the prefix fingerprint includes the label. */
+    struct Visit
+    {
+        uint32_t iNode;
+        uint32_t depth;
+        uint16_t prefixFingerprint;
+        char label;
+    };
+
+    /** Nodes to be visited and rows of the dynamic programming (one for each depth), kept between queries
+     * in order to avoid reallocation. */
+    std::vector<Visit> visitsStack;
+    std::vector<int> rows;
+
+    float elapsedUs = 0.0f;
+    size_t processedWordsCount = 0;
+};
+
+} // namespace fingerprints
+
+#endif // DAWG_HPP
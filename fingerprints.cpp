@@ -2,9 +2,11 @@
 #include <bitset>
 #include <cassert>
 #include <climits>
+#include <cstdint>
 #include <cstring>
 #include <chrono>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -16,16 +18,91 @@ namespace fingerprints
 
 template<typename FING_T>
 Fingerprints<FING_T>::Fingerprints(DistanceType distanceType,
-    FingerprintType fingerprintType, LettersType lettersType)
+    FingerprintType fingerprintType, LettersType lettersType, const IndexOptions &indexOptions)
+    : entryAlignment(indexOptions.entryAlignment), memoryType(indexOptions.memoryType),
+    lockMemory(indexOptions.lockMemory), qgramSize(indexOptions.qgramSize), useExactHash(indexOptions.exactHash),
+    useFingerprintGroups(indexOptions.fingerprintGroups), useFingerprintNeighborhood(indexOptions.fingerprintNeighborhood),
+    usePopcountBuckets(indexOptions.popcountBuckets), usePackedWords(indexOptions.packedWords),
+    useFrontCoding(indexOptions.frontCoding), deletionIndexK(indexOptions.deletionIndexK),
+    partitionIndexK(indexOptions.partitionIndexK), usePlanner(indexOptions.planner)
 {
-    initNErrorsLUT();
-    
     if (distanceType != DistanceType::Ham)
     {
         useHamming = false;
-        
-        levV0 = new int[maxWordSize];
-        levV1 = new int[maxWordSize];
+    }
+    if (distanceType == DistanceType::Osa)
+    {
+        useOsa = true;
+    }
+
+    if (entryAlignment == 0 or entryAlignment > maxEntryAlignment or (entryAlignment & (entryAlignment - 1)) != 0)
+    {
+        throw invalid_argument("bad entry alignment: " + to_string(entryAlignment));
+    }
+
+    if (deletionIndexK < -1 or deletionIndexK > maxDeletionIndexK)
+    {
+        throw invalid_argument("bad deletion index k: " + to_string(deletionIndexK));
+    }
+    if (partitionIndexK < -1 or partitionIndexK > maxPartitionIndexK)
+    {
+        throw invalid_argument("bad partition index k: " + to_string(partitionIndexK));
+    }
+    if (useFingerprintGroups and fingerprintType == FingerprintType::None)
+    {
+        throw invalid_argument("fingerprint groups require fingerprints");
+    }
+    if (useFingerprintNeighborhood and not useFingerprintGroups)
+    {
+        throw invalid_argument("fingerprint neighborhood requires fingerprint groups");
+    }
+    if (usePopcountBuckets and fingerprintType == FingerprintType::None)
+    {
+        throw invalid_argument("popcount buckets require fingerprints");
+    }
+    if (usePopcountBuckets and useFingerprintNeighborhood)
+    {
+        // The directories rank the groups by fingerprint, which would not match their order.
+        throw invalid_argument("popcount buckets cannot be combined with fingerprint neighborhood");
+    }
+    if (usePackedWords and distanceType != DistanceType::Ham)
+    {
+        throw invalid_argument("packed words require Hamming distance");
+    }
+    if (useFrontCoding and distanceType != DistanceType::Lev)
+    {
+        throw invalid_argument("front coding requires Levenshtein distance");
+    }
+    if (useFrontCoding and useFingerprintGroups)
+    {
+        // Both would sort the scanned words, by fingerprint and lexicographically.
+        throw invalid_argument("front coding cannot be combined with fingerprint groups");
+    }
+
+    if (indexOptions.utf8)
+    {
+        useUtf8 = true;
+    }
+
+    if (not indexOptions.normalizationTable.empty())
+    {
+        if (indexOptions.normalizationTable.size() != Normalization::tableSize)
+        {
+            throw invalid_argument("bad normalization table size: " + to_string(indexOptions.normalizationTable.size()));
+        }
+
+        useNormalization = true;
+        copy(indexOptions.normalizationTable.begin(), indexOptions.normalizationTable.end(), normalizationTable);
+    }
+
+    for (size_t i = 0; i < nAcceptBitmaps; ++i)
+    {
+        for (size_t j = 0; j < nAcceptBitmaps; ++j)
+        {
+            acceptBitmaps[i][j] = nullptr;
+            acceptedXors[i][j] = nullptr;
+            maxAcceptedWeights[i][j] = -1;
+        }
     }
 
     switch (fingerprintType)
@@ -44,6 +121,11 @@ Fingerprints<FING_T>::Fingerprints(DistanceType distanceType,
             initCharsMap(fingerprintType, lettersType);
             calcOccNMismatchesLUT();
 
+            // The inserted or deleted character and the one which crosses the middle of the word.
+            indelNMismatches = 3;
+            // Both swapped characters may cross the middle of the word.
+            transNMismatches = 4;
+
             calcFingerprintFun = bind(&Fingerprints<FING_T>::calcFingerprintOccHalved, this,
                 placeholders::_1, placeholders::_2);
             break;
@@ -58,18 +140,44 @@ Fingerprints<FING_T>::Fingerprints(DistanceType distanceType,
             initCharList(lettersType);
             calcPosNMismatchesLUT();
 
+            // Inserting or deleting at the front can change all positions as well as the occurrence bit.
+            indelNMismatches = sizeof(FING_T) * 8;
+            // Only the first positions of both swapped characters can change.
+            transNMismatches = 2;
+
             calcFingerprintFun = bind(&Fingerprints<FING_T>::calcFingerprintPos, this,
                 placeholders::_1, placeholders::_2);
             break;
+        case FingerprintType::QGram:
+            if (qgramSize < minQGramSize or qgramSize > maxQGramSize)
+            {
+                throw invalid_argument("bad q-gram size: " + to_string(qgramSize));
+            }
+
+            // Letters type is not used here, all grams are hashed.
+            calcOccNMismatchesLUT();
+
+            // A substitution replaces up to q grams. An insertion or deletion destroys up to q - 1 grams
+            // which span the edited position and creates up to q new ones (or the other way round).
+            subNMismatches = 2 * qgramSize;
+            indelNMismatches = 2 * qgramSize - 1;
+            // Swapping replaces the q + 1 grams which cover either of the swapped characters.
+            transNMismatches = 2 * qgramSize + 2;
+
+            calcFingerprintFun = bind(&Fingerprints<FING_T>::calcFingerprintQGram, this,
+                placeholders::_1, placeholders::_2);
+            break;
         default:
             assert(false);
     }
+
+    initNErrorsLUT();
 }
 
 template<typename FING_T>
 Fingerprints<FING_T>::~Fingerprints()
 {
-    delete[] fingArray;
+    IndexMemory::release(fingArray, fingArraySize, fingArrayBacking);
 
     delete[] charsMap;
     delete[] charList;
@@ -77,15 +185,43 @@ Fingerprints<FING_T>::~Fingerprints()
     delete[] nErrorsLUT;
     delete[] nMismatchesLUT;
 
-    delete[] levV0;
-    delete[] levV1;
+    delete[] exactHash;
+
+    for (size_t i = 0; i < nAcceptBitmaps; ++i)
+    {
+        for (size_t j = 0; j < nAcceptBitmaps; ++j)
+        {
+            delete[] acceptBitmaps[i][j].load();
+            delete acceptedXors[i][j].load();
+        }
+    }
 }
 
 template<typename FING_T>
 void Fingerprints<FING_T>::preprocess(const vector<string> &words)
 {
-    // We remove the duplicates.
-    unordered_set<string> wordSet(words.begin(), words.end());
+    // We remove the duplicates, words which differ only before normalization become duplicates as well.
+    unordered_set<string> wordSet;
+
+    if (useUtf8)
+    {
+        assignCodeUnits(words);
+    }
+
+    for (const string &word : words)
+    {
+        if (useNormalization or useUtf8)
+        {
+            string mapped(word.size(), '\0');
+            mapped.resize(mapWord(word.c_str(), word.size(), &mapped[0]));
+
+            wordSet.insert(move(mapped));
+        }
+        else
+        {
+            wordSet.insert(word);
+        }
+    }
 
     // We convert the set back to a vector for further sorting.
     vector<string> wordsUnique(wordSet.begin(), wordSet.end());
@@ -99,10 +235,57 @@ void Fingerprints<FING_T>::preprocess(const vector<string> &words)
     {
         preprocessWords(move(wordsUnique));
     }
+
+    if (usePackedWords)
+    {
+        buildPackedWords();
+    }
+    if (useFrontCoding)
+    {
+        buildFrontCodedWords();
+        releaseFingArray();
+    }
+    if (useExactHash)
+    {
+        buildExactHash();
+    }
+
+    if (deletionIndexK >= 0 or partitionIndexK >= 0)
+    {
+        initWordIds();
+    }
+    if (deletionIndexK >= 0)
+    {
+        buildDeletionIndex();
+    }
+    if (partitionIndexK >= 0)
+    {
+        buildPartitionIndex();
+    }
+
+    if (usePlanner)
+    {
+        calibratePlanner(words);
+    }
+
+    if (lockMemory)
+    {
+        lockIndexMemory();
+    }
 }
 
 template<typename FING_T>
 int Fingerprints<FING_T>::test(const vector<string> &patterns, int k, int nIter, bool setProcessedWordsCollection)
+{
+    const int nMatches = test(defaultContext, patterns, k, nIter, setProcessedWordsCollection);
+    elapsedUs = defaultContext.elapsedUs;
+
+    return nMatches;
+}
+
+template<typename FING_T>
+int Fingerprints<FING_T>::test(QueryContext &context, const vector<string> &patterns, int k, int nIter,
+    bool setProcessedWordsCollection) const
 {
     if (k < 0)
     {
@@ -114,75 +297,144 @@ int Fingerprints<FING_T>::test(const vector<string> &patterns, int k, int nIter,
 
     if (useFingerprints)
     {
-        if (useHamming)
+        // Making sure that the accept bitmaps are not calculated during time measurement.
+        prepareAcceptBitmaps(k);
+    }
+
+    prepareContext(context);
+
+    start = std::clock();
+
+    // Patterns are grouped by their plans once for all iterations, planning is included in the elapsed time.
+    const vector<string> *patternGroups[nPlans] = {};
+    fill(context.planCounts, context.planCounts + nPlans, 0);
+
+    if (usePlanner and k <= maxPlannerK)
+    {
+        for (vector<string> &group : context.plannedPatterns)
         {
-            start = std::clock();
+            group.clear();
+        }
 
-            for (int i = 0; i < nIter; ++i)
-            {
-                nMatches = testFingerprintsHamming(patterns, k);
-            }
+        for (const string &pattern : patterns)
+        {
+            size_t patSize;
+            normalizePattern(context, pattern, patSize);
 
-            end = std::clock();
+            context.plannedPatterns[static_cast<size_t>(choosePlan(patSize, k))].push_back(pattern);
         }
-        else
+
+        for (size_t iPlan = 0; iPlan < nPlans; ++iPlan)
         {
-            start = std::clock();
-            
-            for (int i = 0; i < nIter; ++i)
+            context.planCounts[iPlan] = context.plannedPatterns[iPlan].size();
+
+            if (not context.plannedPatterns[iPlan].empty())
             {
-                nMatches = testFingerprintsLeven(patterns, k);
+                patternGroups[iPlan] = &context.plannedPatterns[iPlan];
             }
-
-            end = std::clock();        
         }
     }
     else
     {
-        if (useHamming)
-        {
-            start = std::clock();
-            
-            for (int i = 0; i < nIter; ++i)
-            {
-                nMatches = testWordsHamming(patterns, k);
-            }
+        const size_t iPlan = static_cast<size_t>(getDefaultPlan(k));
+
+        context.planCounts[iPlan] = patterns.size();
+        patternGroups[iPlan] = &patterns;
+    }
+
+    // The kernels specialized for k are selected once for all patterns and iterations.
+    TestFun testFuns[nPlans] = {};
 
-            end = std::clock();
+    for (size_t iPlan = 0; iPlan < nPlans; ++iPlan)
+    {
+        if (patternGroups[iPlan] != nullptr)
+        {
+            testFuns[iPlan] = getTestFun(k, static_cast<Plan>(iPlan));
         }
-        else
+    }
+
+    for (int i = 0; i < nIter; ++i)
+    {
+        nMatches = 0;
+
+        for (size_t iPlan = 0; iPlan < nPlans; ++iPlan)
         {
-            start = std::clock();
-            
-            for (int i = 0; i < nIter; ++i)
+            if (patternGroups[iPlan] != nullptr)
             {
-                nMatches = testWordsLeven(patterns, k);
+                nMatches += (this->*testFuns[iPlan])(context, *patternGroups[iPlan], k);
             }
-
-            end = std::clock();
         }
     }
 
-    processedWords.clear();
-    processedWordsCount = 0;
+    end = std::clock();
+
+    context.processedWords.clear();
+    context.processedWordsCount = 0;
 
     // An additional run which does not affect time measurement is performed only to set the processed words count.
     // It mirrors the search which is performed above.
-    if (setProcessedWordsCollection)
-    {
-        setProcessedWords(patterns, k);
-    }
-    else
+    for (size_t iPlan = 0; iPlan < nPlans; ++iPlan)
     {
-        setProcessedWordsCount(patterns, k);
+        if (patternGroups[iPlan] == nullptr)
+        {
+            continue;
+        }
+
+        if (setProcessedWordsCollection)
+        {
+            setProcessedWords(context, *patternGroups[iPlan], k, static_cast<Plan>(iPlan));
+        }
+        else
+        {
+            setProcessedWordsCount(context, *patternGroups[iPlan], k, static_cast<Plan>(iPlan));
+        }
     }
 
     float elapsedS = (end - start) / static_cast<float>(CLOCKS_PER_SEC);
-    elapsedUs = elapsedS * 1'000'000.0f;
+    context.elapsedUs = elapsedS * 1'000'000.0f;
 
     return nMatches;
 }
 
+template<typename FING_T>
+int Fingerprints<FING_T>::testPattern(QueryContext &context, const char *pattern, size_t size, int k) const
+{
+    if (k < 0)
+    {
+        throw invalid_argument("bad k: " + to_string(k));
+    }
+
+    prepareContext(context);
+
+    // The kernels take batches of patterns, the capacity of the string is reused by subsequent patterns.
+    context.singlePattern.resize(1);
+    context.singlePattern[0].assign(pattern, size);
+
+    size_t patSize;
+    normalizePattern(context, context.singlePattern[0], patSize);
+
+    // The kernels rely on patterns having between 1 and maxWordSize chars, like the words. An empty pattern
+    // is within the distance from the words having at most k chars, except for the Hamming distance.
+    if (patSize > maxWordSize)
+    {
+        return 0;
+    }
+    if (patSize == 0)
+    {
+        int nMatches = 0;
+
+        for (size_t wordSize = 1; wordSize <= static_cast<size_t>(k) and wordSize <= maxWordSize and not useHamming; ++wordSize)
+        {
+            nMatches += getBucketSize(wordSize);
+        }
+
+        return nMatches;
+    }
+
+    const Plan plan = (usePlanner and k <= maxPlannerK) ? choosePlan(patSize, k) : getDefaultPlan(k);
+    return (this->*getTestFun(k, plan))(context, context.singlePattern, k);
+}
+
 template<typename FING_T>
 float Fingerprints<FING_T>::testRejection(const vector<string> &patterns, int k)
 {
@@ -192,6 +444,7 @@ float Fingerprints<FING_T>::testRejection(const vector<string> &patterns, int k)
     }
 
     float res;
+    prepareContext(defaultContext);
 
     if (useHamming)
     {
@@ -206,890 +459,3555 @@ float Fingerprints<FING_T>::testRejection(const vector<string> &patterns, int k)
 }
 
 template<typename FING_T>
-void Fingerprints<FING_T>::preprocessFingerprints(vector<string> words)
+const char *Fingerprints<FING_T>::findExact(const string &pattern) const
 {
-    size_t wordCountsBySize[maxWordSize + 1];
-    size_t totalSize = calcTotalSize(words, wordCountsBySize);
+    if (pattern.size() > maxWordSize * Utf8::maxSequenceSize)
+    {
+        return nullptr;
+    }
 
-    fingArray = new char[totalSize];
-    
-    sort(words.begin(), words.end(), [](const string &str1, const string &str2) {
-        return str1.size() < str2.size();
-    });
+    // This method is const, hence the pattern is mapped on the stack instead of in normalizedPattern.
+    char mapped[maxWordSize * Utf8::maxSequenceSize];
 
-    char *curEntry = fingArray;
-    size_t iWord = 0;
+    const char *patStr = pattern.c_str();
+    size_t size = pattern.size();
 
-    clock_t start, end;
+    if (useNormalization or useUtf8)
+    {
+        size = mapWord(pattern.c_str(), pattern.size(), mapped);
+        patStr = mapped;
+    }
 
-    start = std::clock();
+    if (size == 0 or size > maxWordSize)
+    {
+        return nullptr;
+    }
 
-    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
+    const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+    if (exactHash != nullptr)
     {
-        fingArrayEntries[wordSize] = curEntry;
+        size_t nCompared = 0;
+        const int64_t iEntry = probeExactHash(patStr, size, nCompared);
 
-        for (size_t iCurWord = 0; iCurWord < wordCountsBySize[wordSize]; ++iCurWord)
-        {
-            assert(words[iWord].size() == wordSize);
-            const char *wordPtr = words[iWord].c_str();
+        return (iEntry < 0) ? nullptr : getEntry(size, iEntry) + wordOffset;
+    }
+    if (frontCodedOnly)
+    {
+        // Front coded words are not stored contiguously, there is no word to point to.
+        throw logic_error("finding exact words requires the dictionary array, which is not kept with front coding alone");
+    }
 
-            *(reinterpret_cast<FING_T *>(curEntry)) = calcFingerprintFun(wordPtr, wordSize);
-            curEntry += sizeof(FING_T);
+    for (size_t iEntry = 0; iEntry < getBucketSize(size); ++iEntry)
+    {
+        const char *word = getEntry(size, iEntry) + wordOffset;
 
-            strncpy(curEntry, wordPtr, wordSize);
-        
-            curEntry += wordSize;
-            iWord += 1;
+        if (memcmp(word, patStr, size) == 0)
+        {
+            return word;
         }
     }
 
-    fingArrayEntries[maxWordSize + 1] = curEntry;
-    assert(iWord == words.size()); // Making sure that all words have been processed.
+    return nullptr;
+}
 
-    end = std::clock();
+template<typename FING_T>
+typename Fingerprints<FING_T>::Plan Fingerprints<FING_T>::getDefaultPlan(int k) const
+{
+    if (k == 0 and exactHash != nullptr)
+    {
+        return Plan::ExactHash;
+    }
+    if (usesDeletionIndex(k))
+    {
+        return Plan::DeletionIndex;
+    }
+    if (usesPartitionIndex(k))
+    {
+        return Plan::PartitionIndex;
+    }
 
-    float elapsedS = (end - start) / static_cast<float>(CLOCKS_PER_SEC);
-    elapsedUs = elapsedS * 1'000'000.0f;
+    return useFingerprints ? Plan::FingerprintScan : Plan::WordScan;
 }
 
 template<typename FING_T>
-void Fingerprints<FING_T>::preprocessWords(vector<string> words)
+bool Fingerprints<FING_T>::isPlanAvailable(Plan plan, int k) const
 {
-    size_t wordCountsBySize[maxWordSize + 1];
-    size_t totalSize = calcTotalSize(words, wordCountsBySize);
+    switch (plan)
+    {
+        case Plan::ExactHash:
+            return k == 0 and exactHash != nullptr;
+        case Plan::DeletionIndex:
+            return k <= deletionIndexK and deletionPostings.isBuilt();
+        case Plan::PartitionIndex:
+            return k <= partitionIndexK and partitionPostings.isBuilt();
+        case Plan::FingerprintScan:
+            return useFingerprints;
+        default:
+            return true;
+    }
+}
 
-    // No fingerprints in this version.
-    totalSize -= words.size() * sizeof(FING_T);
+template<typename FING_T>
+typename Fingerprints<FING_T>::TestFun Fingerprints<FING_T>::getTestFun(int k, Plan plan) const
+{
+    assert(isPlanAvailable(plan, k));
 
-    fingArray = new char[totalSize];
-    
-    sort(words.begin(), words.end(), [](const string &str1, const string &str2) {
-        return str1.size() < str2.size();
-    });
+    // An exact lookup does not depend on the distance or fingerprint type,
+    // and the candidate indexes handle all distances, candidates are verified with the kernels for k.
+    switch (plan)
+    {
+        case Plan::ExactHash:
+            return &Fingerprints<FING_T>::testExactHash;
+        case Plan::DeletionIndex:
+            return getCandidateIndexTestFun<Plan::DeletionIndex>(k);
+        case Plan::PartitionIndex:
+            return getCandidateIndexTestFun<Plan::PartitionIndex>(k);
+        default:
+            break;
+    }
 
-    char *curEntry = fingArray;
-    size_t iWord = 0;
+    // Front coded words share the rows calculated for their prefixes, for any k.
+    if (useFrontCoding)
+    {
+        return (plan == Plan::FingerprintScan) ? &Fingerprints<FING_T>::testFrontCodedLeven<true>
+            : &Fingerprints<FING_T>::testFrontCodedLeven<false>;
+    }
 
-    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
+    // Packed words are compared lane by lane, which does not depend on k either.
+    if (plan == Plan::WordScan and usePackedWords)
     {
-        fingArrayEntries[wordSize] = curEntry;
+        return (packedBits == 4) ? &Fingerprints<FING_T>::testPackedHamming<4> : &Fingerprints<FING_T>::testPackedHamming<5>;
+    }
 
-        for (size_t iCurWord = 0; iCurWord < wordCountsBySize[wordSize]; ++iCurWord)
+    // The bit-parallel verifier does not depend on k.
+    if (useOsa)
+    {
+        if (plan == Plan::FingerprintScan)
         {
-            assert(words[iWord].size() == wordSize);
-            strncpy(curEntry, words[iWord].c_str(), wordSize);
-        
-            curEntry += wordSize;
-            iWord += 1;
+            return useFingerprintGroups ? &Fingerprints<FING_T>::testGroupsLeven<anyK, true>
+                : &Fingerprints<FING_T>::testFingerprintsLeven<anyK, true>;
         }
+
+        return &Fingerprints<FING_T>::testWordsLeven<anyK, true>;
     }
 
-    fingArrayEntries[maxWordSize + 1] = curEntry;
-    assert(iWord == words.size()); // Making sure that all words have been processed.
+    switch (k)
+    {
+        case 0:
+            return getTestFunForK<0>(plan);
+        case 1:
+            return getTestFunForK<1>(plan);
+        case 2:
+            return getTestFunForK<2>(plan);
+        case 3:
+            return getTestFunForK<3>(plan);
+        default:
+            return getTestFunForK<anyK>(plan);
+    }
 }
 
 template<typename FING_T>
-void Fingerprints<FING_T>::initNErrorsLUT()
+template<int K>
+typename Fingerprints<FING_T>::TestFun Fingerprints<FING_T>::getTestFunForK(Plan plan) const
 {
-    size_t fingSizeBits = sizeof(FING_T) * 8;
-    nErrorsLUT = new unsigned char[fingSizeBits + 1];
-
-    for (size_t i = 0; i <= fingSizeBits; ++i)
+    if (plan == Plan::FingerprintScan and useFingerprintGroups)
+    {
+        return useHamming ? &Fingerprints<FING_T>::testGroupsHamming<K> : &Fingerprints<FING_T>::testGroupsLeven<K>;
+    }
+    if (plan == Plan::FingerprintScan)
+    {
+        return useHamming ? &Fingerprints<FING_T>::testFingerprintsHamming<K> : &Fingerprints<FING_T>::testFingerprintsLeven<K>;
+    }
+    else
     {
-        nErrorsLUT[i] = ceil(i / 2.0f);
+        return useHamming ? &Fingerprints<FING_T>::testWordsHamming<K> : &Fingerprints<FING_T>::testWordsLeven<K>;
     }
 }
 
 template<typename FING_T>
-void Fingerprints<FING_T>::initCharsMap(FingerprintType fingerprintType,
-    LettersType lettersType)
+template<typename Fingerprints<FING_T>::Plan P>
+typename Fingerprints<FING_T>::TestFun Fingerprints<FING_T>::getCandidateIndexTestFun(int k) const
 {
-    charsMap = new unsigned char[charsMapSize];
+    switch (k)
+    {
+        case 0:
+            return &Fingerprints<FING_T>::testCandidateIndex<0, P>;
+        case 1:
+            return &Fingerprints<FING_T>::testCandidateIndex<1, P>;
+        case 2:
+            return &Fingerprints<FING_T>::testCandidateIndex<2, P>;
+        case 3:
+            return &Fingerprints<FING_T>::testCandidateIndex<3, P>;
+        default:
+            return &Fingerprints<FING_T>::testCandidateIndex<anyK, P>;
+    }
+}
 
-    for (size_t i = 0; i < charsMapSize; ++i)
+template<typename FING_T>
+const char *Fingerprints<FING_T>::normalizePattern(QueryContext &context, const string &pattern, size_t &size) const
+{
+    if (not useNormalization and not useUtf8)
     {
-        charsMap[i] = noCharIndex;
+        size = pattern.size();
+        return pattern.c_str();
     }
 
-    size_t nChars;
+    // Resizing within the reserved capacity does not allocate, a mapped word is never longer than the original one.
+    context.normalizedPattern.resize(pattern.size());
+    size = mapWord(pattern.c_str(), pattern.size(), &context.normalizedPattern[0]);
 
-    switch (fingerprintType)
+    return context.normalizedPattern.c_str();
+}
+
+template<typename FING_T>
+size_t Fingerprints<FING_T>::mapWord(const char *str, size_t size, char *out) const
+{
+    if (not useUtf8)
     {
-        case FingerprintType::Occ:
-            nChars = sizeof(FING_T) * 8;
-            break;
-        case FingerprintType::OccHalved:
-            nChars = sizeof(FING_T) * 4;
-            break;
-        case FingerprintType::Count:
-            nChars = sizeof(FING_T) * 4;
-            break;
-        default:
-            assert(false);
-            return;
+        assert(useNormalization);
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            out[i] = normalizationTable[static_cast<unsigned char>(str[i])];
+        }
+
+        return size;
     }
 
-    string charList = getCharList(nChars, lettersType);
-    assert(charList.size() == nChars);
+    size_t pos = 0, nCodeUnits = 0;
 
-    for (size_t i = 0; i < nChars; ++i)
+    while (pos < size)
     {
-        const char c = charList[i];
+        uint32_t codePoint;
 
-        if (fingerprintType == FingerprintType::OccHalved)
+        // Invalid sequences can only occur in patterns, they do not match any dictionary character.
+        if (Utf8::decodeNext(str, size, pos, codePoint))
         {
-            charsMap[static_cast<size_t>(c)] = 2 * i;
+            out[nCodeUnits] = getCodeUnit(codePoint);
         }
         else
         {
-            charsMap[static_cast<size_t>(c)] = i;
+            out[nCodeUnits] = static_cast<char>(unknownCodeUnit);
         }
+
+        nCodeUnits += 1;
     }
+
+    return nCodeUnits;
 }
 
 template<typename FING_T>
-void Fingerprints<FING_T>::initCharList(LettersType lettersType)
+char Fingerprints<FING_T>::getCodeUnit(uint32_t codePoint) const
 {
-    size_t nChars = sizeof(FING_T) * 8 / nBitsPerPos;
-    string curList = getCharList(nChars, lettersType);
-
-    charList = new unsigned char[curList.size() + 1];
+    // Latin-1 bytes are the first 256 Unicode code points, hence the normalization table applies to them as well.
+    if (useNormalization and codePoint < Normalization::tableSize)
+    {
+        codePoint = normalizationTable[codePoint];
+    }
 
-    for (size_t i = 0; i < curList.size(); ++i)
+    if (codePoint < firstCodeUnit)
     {
-        charList[i] = curList[i];
+        return static_cast<char>(codePoint);
     }
 
-    charList[curList.size()] = '\0';
+    const auto it = codePointUnits.find(codePoint);
+    return static_cast<char>((it == codePointUnits.end()) ? unknownCodeUnit : it->second);
 }
 
 template<typename FING_T>
-string Fingerprints<FING_T>::getCharList(size_t nChars, LettersType lettersType) const
+void Fingerprints<FING_T>::assignCodeUnits(const vector<string> &words)
 {
-    switch (lettersType)
+    unordered_map<uint32_t, size_t> codePointCounts;
+
+    for (const string &word : words)
     {
-        case LettersType::Common:
-            switch (nChars)
+        size_t pos = 0;
+
+        while (pos < word.size())
+        {
+            uint32_t codePoint;
+
+            if (not Utf8::decodeNext(word.c_str(), word.size(), pos, codePoint))
             {
-                case 5:
-                    return engCommonLettersPos5;
-                case 8:
-                    return engCommonLetters8;
-                case 16:
-                    return engCommonLetters16;
+                throw invalid_argument("bad UTF-8 word: " + word);
             }
-        case LettersType::Mixed:
-            switch (nChars)
+
+            if (useNormalization and codePoint < Normalization::tableSize)
             {
-                case 5:
-                    return engMixedLettersPos5;
-                case 8:
-                    return engMixedLetters8;
-                case 16:
-                    return engMixedLetters16;
+                codePoint = normalizationTable[codePoint];
             }
-        case LettersType::Rare:
-            switch (nChars)
+
+            if (codePoint >= firstCodeUnit)
             {
-                case 5:
-                    return engRareLettersPos5;
-                case 8:
-                    return engRareLetters8;
-                case 16:
-                    return engRareLetters16;
+                codePointCounts[codePoint] += 1;
             }
+        }
     }
 
-    assert(false);
-    return "";
-}
-
-template<typename FING_T>
-void Fingerprints<FING_T>::calcOccNMismatchesLUT()
-{
-    FING_T maxVal = std::numeric_limits<FING_T>::max();
+    // Ties are broken by code point, so that the assignment does not depend on the hash map order.
+    vector<pair<size_t, uint32_t>> codePoints;
 
-    assert(nMismatchesLUT == nullptr);
-    nMismatchesLUT = new unsigned char[maxVal + 1];
+    for (const auto &codePointCount : codePointCounts)
+    {
+        codePoints.emplace_back(codePointCount.second, codePointCount.first);
+    }
 
-    FING_T n = 0x0U;
+    sort(codePoints.begin(), codePoints.end(), [](const pair<size_t, uint32_t> &a, const pair<size_t, uint32_t> &b) {
+        return a.first > b.first or (a.first == b.first and a.second < b.second);
+    });
 
-    while (true)
-    {
-        nMismatchesLUT[n] = calcHammingWeight(n);
-        assert(nMismatchesLUT[n] >= 0 and nMismatchesLUT[n] <= sizeof(FING_T) * 8);
+    // If all code points fit, the shared code unit is used by the last one alone.
+    const size_t nOwnCodeUnits = sharedCodeUnit - firstCodeUnit;
 
-        // Beware of overflows here.
-        if (n == maxVal)
-        {
-            break;
-        }
+    codePointUnits.clear();
+    nSharedCodePoints = (codePoints.size() > nOwnCodeUnits + 1) ? codePoints.size() - nOwnCodeUnits : 0;
 
-        n += 1;
+    for (size_t i = 0; i < codePoints.size(); ++i)
+    {
+        codePointUnits[codePoints[i].second] = static_cast<unsigned char>(firstCodeUnit + min(i, nOwnCodeUnits));
     }
 }
 
 template<typename FING_T>
-void Fingerprints<FING_T>::calcCountNMismatchesLUT()
+size_t Fingerprints<FING_T>::calcEntryStride(size_t wordSize) const
 {
-    assert(sizeof(FING_T) == 2);
+    const size_t entrySize = useFingerprints ? sizeof(FING_T) + wordSize : wordSize;
+    return (entrySize + entryAlignment - 1) & ~(entryAlignment - 1);
+}
 
-    FING_T maxVal = std::numeric_limits<FING_T>::max();
+template<typename FING_T>
+size_t Fingerprints<FING_T>::getBucketSize(size_t wordSize) const
+{
+    assert(wordSize >= 1 and wordSize <= maxWordSize);
+    return bucketSizes[wordSize];
+}
 
-    assert(nMismatchesLUT == nullptr);
-    nMismatchesLUT = new unsigned char[maxVal + 1];
+template<typename FING_T>
+const char *Fingerprints<FING_T>::getEntry(size_t wordSize, size_t iEntry) const
+{
+    assert(iEntry < getBucketSize(wordSize));
+    return fingArrayEntries[wordSize] + iEntry * calcEntryStride(wordSize);
+}
 
-    FING_T mask = 0b011U;
-    FING_T n = 0x0U;
+template<typename FING_T>
+void Fingerprints<FING_T>::preprocessFingerprints(vector<string> words)
+{
+    size_t wordCountsBySize[maxWordSize + 1];
+    calcTotalSize(words, wordCountsBySize);
+    copy(wordCountsBySize, wordCountsBySize + maxWordSize + 1, bucketSizes);
 
-    while (true)
+    fingArraySize = calcArraySize(wordCountsBySize);
+    fingArray = IndexMemory::allocate(fingArraySize, memoryType, fingArrayBacking);
+    assert(reinterpret_cast<uintptr_t>(fingArray) % entryAlignment == 0);
+    
+    if (useFingerprintGroups or usePopcountBuckets)
     {
-        unsigned char nErrors = 0;
+        // Entries sharing a fingerprint become adjacent within each bracket, the popcount comes first
+        // if the bracket is split into sub-buckets.
+        vector<pair<uint32_t, size_t>> keys(words.size());
 
-        for (int iM = 0; iM < 8; ++iM)
+        for (size_t iWord = 0; iWord < words.size(); ++iWord)
         {
-            // Unfortunately each difference in a count can lead only up to max 1 error.
-            // Example: fingerprint 01 (letter count = 1) xored with fingerprint 10 (letter count = 2) 
-            // -> results in 11.
-            // Two bits are set in the result but they translate to only 1 error.
-            if (n & (mask << (2 * iM)))
-            {
-                nErrors += 1;
-            }
+            const FING_T fingerprint = calcFingerprintFun(words[iWord].c_str(), words[iWord].size());
+            const uint32_t weight = usePopcountBuckets ? calcHammingWeight(fingerprint) : 0;
+
+            keys[iWord] = { (weight << (8 * sizeof(FING_T))) | fingerprint, iWord };
         }
 
-        assert(nErrors >= 0 and nErrors <= 8);
-        nMismatchesLUT[n] = nErrors;
+        sort(keys.begin(), keys.end(), [&words](const pair<uint32_t, size_t> &key1, const pair<uint32_t, size_t> &key2) {
+            const size_t size1 = words[key1.second].size();
+            const size_t size2 = words[key2.second].size();
 
-        // Beware of overflows here.
-        if (n == maxVal)
+            return size1 < size2 or (size1 == size2 and key1.first < key2.first);
+        });
+
+        vector<string> sortedWords;
+        sortedWords.reserve(words.size());
+
+        for (const pair<uint32_t, size_t> &key : keys)
         {
-            break;
+            sortedWords.emplace_back(move(words[key.second]));
         }
 
-        n += 1;
+        words.swap(sortedWords);
+    }
+    else
+    {
+        sort(words.begin(), words.end(), [](const string &str1, const string &str2) {
+            return str1.size() < str2.size();
+        });
     }
-}
-
-template<typename FING_T>
-void Fingerprints<FING_T>::calcPosNMismatchesLUT()
-{
-    assert(sizeof(FING_T) == 2);
 
-    FING_T maxVal = std::numeric_limits<FING_T>::max();
+    char *curEntry = fingArray;
+    size_t iWord = 0;
 
-    assert(nMismatchesLUT == nullptr);
-    nMismatchesLUT = new unsigned char[maxVal + 1];
+    clock_t start, end;
 
-    FING_T mask = 0b0111U;
-    FING_T n = 0x0U;
+    start = std::clock();
 
-    while (true)
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
     {
-        unsigned char nErrors = 0;
+        fingArrayEntries[wordSize] = curEntry;
+        const size_t entryStride = calcEntryStride(wordSize);
 
-        // If there is any difference between the corresponding positions,
-        // then at least one of the bits in the triplet will be set.
-        for (int iM = 0; iM < 5; ++iM)
+        for (size_t iCurWord = 0; iCurWord < wordCountsBySize[wordSize]; ++iCurWord)
         {
-            if (n & (mask << (nBitsPerPos * iM)))
-            {
-                nErrors += 1;
-            }
-        }
-
-        assert(nErrors >= 0 and nErrors <= 5);
+            assert(words[iWord].size() == wordSize);
+            const char *wordPtr = words[iWord].c_str();
 
-        // The last bit is used for a single occurrence.
-        if (n & (0x1U << 15))
-        {
-            nErrors += 1;
+            *(reinterpret_cast<FING_T *>(curEntry)) = calcFingerprintFun(wordPtr, wordSize);
+            strncpy(curEntry + sizeof(FING_T), wordPtr, wordSize);
+        
+            curEntry += entryStride;
+            iWord += 1;
         }
+    }
 
-        assert(nErrors >= 0 and nErrors <= 6);
-        nMismatchesLUT[n] = nErrors;
+    fingArrayEntries[maxWordSize + 1] = curEntry;
+    assert(iWord == words.size()); // Making sure that all words have been processed.
 
-        // Beware of overflows here.
-        if (n == maxVal)
-        {
-            break;
-        }
+    if (useFingerprintGroups)
+    {
+        buildFingerprintGroups();
+    }
 
-        n += 1;
+    fill(neighborhoodStarts, neighborhoodStarts + maxWordSize + 2, static_cast<size_t>(noNeighborhood));
+
+    if (useFingerprintNeighborhood)
+    {
+        buildFingerprintNeighborhood();
     }
+    if (usePopcountBuckets)
+    {
+        buildPopcountBuckets();
+    }
+
+    end = std::clock();
+
+    float elapsedS = (end - start) / static_cast<float>(CLOCKS_PER_SEC);
+    elapsedUs = elapsedS * 1'000'000.0f;
 }
 
 template<typename FING_T>
-size_t Fingerprints<FING_T>::calcTotalSize(const vector<string> &words, size_t *wordCountsBySize)
+void Fingerprints<FING_T>::preprocessWords(vector<string> words)
 {
-    size_t totalSize = 0;
+    size_t wordCountsBySize[maxWordSize + 1];
+    calcTotalSize(words, wordCountsBySize);
+    copy(wordCountsBySize, wordCountsBySize + maxWordSize + 1, bucketSizes);
 
-    for (size_t i = 0; i <= maxWordSize; ++i)
-    {
-        wordCountsBySize[i] = 0;
-    }
+    // No fingerprints in this version, which is taken into account by calcEntryStride.
+    fingArraySize = calcArraySize(wordCountsBySize);
+    fingArray = IndexMemory::allocate(fingArraySize, memoryType, fingArrayBacking);
+    assert(reinterpret_cast<uintptr_t>(fingArray) % entryAlignment == 0);
+    
+    sort(words.begin(), words.end(), [](const string &str1, const string &str2) {
+        return str1.size() < str2.size();
+    });
 
-    for (const string &word : words)
+    char *curEntry = fingArray;
+    size_t iWord = 0;
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
     {
-        wordCountsBySize[word.size()] += 1;
-        totalSize += word.size() + sizeof(FING_T);
+        fingArrayEntries[wordSize] = curEntry;
+        const size_t entryStride = calcEntryStride(wordSize);
+
+        for (size_t iCurWord = 0; iCurWord < wordCountsBySize[wordSize]; ++iCurWord)
+        {
+            assert(words[iWord].size() == wordSize);
+            strncpy(curEntry, words[iWord].c_str(), wordSize);
+        
+            curEntry += entryStride;
+            iWord += 1;
+        }
     }
 
-    return totalSize;
+    fingArrayEntries[maxWordSize + 1] = curEntry;
+    assert(iWord == words.size()); // Making sure that all words have been processed.
 }
 
 template<typename FING_T>
-int Fingerprints<FING_T>::testFingerprintsHamming(const vector<string> &patterns, int k)
+void Fingerprints<FING_T>::buildFingerprintGroups()
 {
-    int nMatches = 0;
+    fingerprintGroups.clear();
 
-    for (const string &pattern : patterns) 
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
     {
-        const size_t curSize = pattern.size();
-        const FING_T patFingerprint = calcFingerprintFun(pattern.c_str(), curSize);
+        fingerprintGroupStarts[wordSize] = fingerprintGroups.size();
 
-        char *curEntry = fingArrayEntries[curSize];
-        char *nextEntry = fingArrayEntries[curSize + 1];
+        const size_t bucketSize = getBucketSize(wordSize);
 
-        while (curEntry != nextEntry)
+        if (bucketSize >= numeric_limits<uint32_t>::max())
         {
-            // We iterate over all words and calculate the Hamming distance only
-            // when the fingerprint comparison is not successful.
-            if (calcNErrors(patFingerprint, *(reinterpret_cast<FING_T *>(curEntry))) <= k)
-            {
-                curEntry += sizeof(FING_T);
+            throw invalid_argument("too many words for fingerprint groups: " + to_string(bucketSize));
+        }
 
-                if (isHamAtMostK(pattern.c_str(), curEntry, curSize, k))
-                {
-                    // Make sure that the number of results is returned in order to
-                    // prevent the compiler from overoptimizing unused results.
-                    nMatches += 1;
-                }
+        for (size_t iEntry = 0; iEntry < bucketSize; ++iEntry)
+        {
+            const FING_T fingerprint = *reinterpret_cast<const FING_T *>(getEntry(wordSize, iEntry));
 
-                curEntry += curSize;
+            if (fingerprintGroups.size() > fingerprintGroupStarts[wordSize] and fingerprintGroups.back().fingerprint == fingerprint)
+            {
+                fingerprintGroups.back().nEntries += 1;
             }
             else
             {
-                curEntry += sizeof(FING_T);
-                curEntry += curSize;
+                fingerprintGroups.push_back({ fingerprint, static_cast<uint32_t>(iEntry), 1 });
             }
         }
     }
 
-    return nMatches;
+    fingerprintGroupStarts[0] = 0;
+    fingerprintGroupStarts[maxWordSize + 1] = fingerprintGroups.size();
 }
 
 template<typename FING_T>
-int Fingerprints<FING_T>::testFingerprintsLeven(const vector<string> &patterns, int k)
+void Fingerprints<FING_T>::buildFingerprintNeighborhood()
 {
-    int nMatches = 0;
+    neighborhoodBits.clear();
+    neighborhoodRanks.clear();
 
-    for (const string &pattern : patterns) 
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
     {
-        const size_t patSize = pattern.size();
-        const FING_T patFingerprint = calcFingerprintFun(pattern.c_str(), patSize);
+        const size_t groupsStart = fingerprintGroupStarts[wordSize];
+        const size_t groupsEnd = fingerprintGroupStarts[wordSize + 1];
 
-        // We omit sizes which differ by more than k.
-        int left = static_cast<int>(patSize) - k;
-        size_t right = patSize + k;
+        if (groupsEnd - groupsStart < minNeighborhoodGroups)
+        {
+            continue;
+        }
 
-        const size_t start = (left < 1) ? 1u : left;
-        const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+        const size_t iBits = neighborhoodBits.size();
+        neighborhoodStarts[wordSize] = iBits;
 
-        for (size_t curSize = start; curSize <= stop; ++curSize)
-        {
-            char *curEntry = fingArrayEntries[curSize];
-            char *nextEntry = fingArrayEntries[curSize + 1];
+        neighborhoodBits.resize(iBits + acceptBitmapSize(), 0);
+        neighborhoodRanks.resize(iBits + acceptBitmapSize(), 0);
 
-            while (curEntry != nextEntry)
-            {
-                // We iterate over all words and calculate the Hamming distance only
-                // when the fingerprint comparison is not successful.
-                if (calcNErrors(patFingerprint, *(reinterpret_cast<FING_T *>(curEntry))) <= k)
-                {
-                    curEntry += sizeof(FING_T);
+        // Groups are sorted by fingerprint, hence the index of a group is the number of smaller fingerprints.
+        for (size_t iGroup = groupsStart; iGroup < groupsEnd; ++iGroup)
+        {
+            const size_t x = fingerprintGroups[iGroup].fingerprint;
+            neighborhoodBits[iBits + x / 64] |= (0x1ULL << (x % 64));
+        }
 
-                    if (isLevAtMostK(pattern.c_str(), patSize, curEntry, curSize, k))
-                    {
-                        // Make sure that the number of results is returned in order to
-                        // prevent the compiler from overoptimizing unused results.
-                        nMatches += 1;
-                    }
+        uint32_t rank = 0;
 
-                    curEntry += curSize;
-                }
-                else
-                {
-                    curEntry += sizeof(FING_T);
-                    curEntry += curSize;
-                }
-            }
+        for (size_t iWord = iBits; iWord < iBits + acceptBitmapSize(); ++iWord)
+        {
+            neighborhoodRanks[iWord] = rank;
+            rank += bitset<64>(neighborhoodBits[iWord]).count();
         }
     }
-
-    return nMatches;
 }
 
 template<typename FING_T>
-int Fingerprints<FING_T>::testWordsHamming(const vector<string> &patterns, int k)
+void Fingerprints<FING_T>::buildPopcountBuckets()
 {
-    int nMatches = 0;
-   
-    for (const string &pattern : patterns) 
+    popcountStarts.assign((maxWordSize + 1) * nPopcountStarts, 0);
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
     {
-        const size_t curSize = pattern.size();
+        uint32_t *starts = popcountStarts.data() + wordSize * nPopcountStarts;
+        const size_t bucketSize = getBucketSize(wordSize);
 
-        char *curEntry = fingArrayEntries[curSize];
-        char *nextEntry = fingArrayEntries[curSize + 1];
+        if (bucketSize >= numeric_limits<uint32_t>::max())
+        {
+            throw invalid_argument("too many words for popcount buckets: " + to_string(bucketSize));
+        }
 
-        while (curEntry != nextEntry)
+        // Counts of each popcount, shifted by one, are turned into the starts.
+        for (size_t iEntry = 0; iEntry < bucketSize; ++iEntry)
         {
-            if (isHamAtMostK(pattern.c_str(), curEntry, curSize, k))
-            {
-                // Make sure that the number of results is returned in order to
-                // prevent the compiler from overoptimizing unused results.
-                nMatches += 1;
-            }
+            const FING_T fingerprint = *reinterpret_cast<const FING_T *>(getEntry(wordSize, iEntry));
+            starts[calcHammingWeight(fingerprint) + 1] += 1;
+        }
 
-            curEntry += curSize;
+        for (size_t weight = 1; weight < nPopcountStarts; ++weight)
+        {
+            starts[weight] += starts[weight - 1];
         }
     }
-
-    return nMatches;
 }
 
 template<typename FING_T>
-int Fingerprints<FING_T>::testWordsLeven(const vector<string> &patterns, int k)
+void Fingerprints<FING_T>::buildPackedWords()
 {
-    int nMatches = 0;
+    const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
 
-    for (const string &pattern : patterns) 
+    bool isUsed[256] = { false };
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
     {
-        const size_t patSize = pattern.size();
+        for (size_t iEntry = 0; iEntry < getBucketSize(wordSize); ++iEntry)
+        {
+            const unsigned char *word = reinterpret_cast<const unsigned char *>(getEntry(wordSize, iEntry) + wordOffset);
 
-        // We omit sizes which differ by more than k.
-        int left = static_cast<int>(patSize) - k;
-        size_t right = patSize + k;
+            for (size_t i = 0; i < wordSize; ++i)
+            {
+                isUsed[word[i]] = true;
+            }
+        }
+    }
 
-        const size_t start = (left < 1) ? 1u : left;
-        const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+    fill(packedCodes, packedCodes + 256, 0);
+    unsigned char nCodes = 0;
 
-        for (size_t curSize = start; curSize <= stop; ++curSize)
+    for (size_t c = 0; c < 256; ++c)
+    {
+        if (isUsed[c])
         {
-            char *curEntry = fingArrayEntries[curSize];
-            char *nextEntry = fingArrayEntries[curSize + 1];
+            nCodes += 1;
+            packedCodes[c] = nCodes;
+        }
+    }
 
-            while (curEntry != nextEntry)
-            {
-                if (isLevAtMostK(pattern.c_str(), patSize, curEntry, curSize, k))
-                {
-                    // Make sure that the number of results is returned in order to
-                    // prevent the compiler from overoptimizing unused results.
-                    nMatches += 1;
-                }
+    if (nCodes >= 32)
+    {
+        throw invalid_argument("too many distinct chars for packed words: " + to_string(nCodes));
+    }
+
+    packedBits = (nCodes < 16) ? 4 : 5;
+    packedLanes.clear();
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
+    {
+        const size_t nLanes = calcPackedLanesCount(wordSize);
+        const size_t bucketSize = getBucketSize(wordSize);
+
+        packedStarts[wordSize] = packedLanes.size();
+        packedLanes.resize(packedLanes.size() + bucketSize * nLanes, 0);
+
+        for (size_t iEntry = 0; iEntry < bucketSize; ++iEntry)
+        {
+            const char *word = getEntry(wordSize, iEntry) + wordOffset;
+            uint64_t *lanes = packedLanes.data() + packedStarts[wordSize] + iEntry * nLanes;
 
-                curEntry += curSize;
+            if (packedBits == 4)
+            {
+                packWord<4>(word, wordSize, lanes);
+            }
+            else
+            {
+                packWord<5>(word, wordSize, lanes);
             }
         }
     }
 
-    return nMatches;
+    packedStarts[0] = 0;
+    packedStarts[maxWordSize + 1] = packedLanes.size();
 }
 
 template<typename FING_T>
-float Fingerprints<FING_T>::testRejectionHamming(const vector<string> &patterns, int k)
+template<size_t Bits>
+void Fingerprints<FING_T>::packWord(const char *str, size_t size, uint64_t *lanes) const
 {
-    int nRejected = 0, nTested = 0;
+    constexpr size_t charsPerLane = 64 / Bits;
 
-    for (const string &pattern : patterns) 
+    fill(lanes, lanes + (size + charsPerLane - 1) / charsPerLane, 0);
+
+    for (size_t i = 0; i < size; ++i)
     {
-        const size_t curSize = pattern.size();
-        const FING_T patFingerprint = calcFingerprintFun(pattern.c_str(), curSize);
+        const uint64_t code = packedCodes[static_cast<unsigned char>(str[i])];
+        lanes[i / charsPerLane] |= code << ((i % charsPerLane) * Bits);
+    }
+}
 
-        char *curEntry = fingArrayEntries[curSize];
-        char *nextEntry = fingArrayEntries[curSize + 1];
+template<typename FING_T>
+template<size_t Bits>
+size_t Fingerprints<FING_T>::countPackedMismatches(uint64_t x)
+{
+    static_assert(Bits == 4 or Bits == 5, "packed codes have 4 or 5 bits");
 
-        while (curEntry != nextEntry)
-        {
-            if (calcNErrors(patFingerprint, *(reinterpret_cast<FING_T *>(curEntry))) > k)
-            {
-                nRejected += 1;
-            }
+    // Each code which differs has at least one bit set, these bits are gathered in the lowest bit of the code,
+    // and the flags are summed with a multiplication, which accumulates them in the top code without carries.
+    if (Bits == 4)
+    {
+        x |= x >> 1;
+        x |= x >> 2;
+        x &= 0x1111111111111111ULL;
 
-            curEntry += sizeof(FING_T);
-            curEntry += curSize;
-        
-            nTested += 1;
-        }
-    }
+        // 16 flags do not fit in 4 bits, hence pairs of codes are summed in bytes first.
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
 
-    if (nTested == 0)
-    {
-        return 0.0f;
+        return (x * 0x0101010101010101ULL) >> 56;
     }
+    else
+    {
+        uint64_t y = x | (x >> 1);
+        y |= y >> 2;
+        y |= x >> 4;
+        y &= 0x0084210842108421ULL;
 
-    return static_cast<float>(nRejected) / nTested;
+        return ((y * 0x0084210842108421ULL) >> 55) & 0x1FU;
+    }
 }
 
 template<typename FING_T>
-float Fingerprints<FING_T>::testRejectionLeven(const vector<string> &patterns, int k)
+void Fingerprints<FING_T>::buildFrontCodedWords()
 {
-    int nRejected = 0, nTested = 0;
+    const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+    vector<const char *> entries;
 
-    for (const string &pattern : patterns) 
+    frontCodedWords.clear();
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
     {
-        const size_t patSize = pattern.size();
-        const FING_T patFingerprint = calcFingerprintFun(pattern.c_str(), patSize);
+        frontCodedStarts[wordSize] = frontCodedWords.size();
+        entries.resize(getBucketSize(wordSize));
 
-        int left = static_cast<int>(patSize) - k;
-        size_t right = patSize + k;
+        for (size_t iEntry = 0; iEntry < entries.size(); ++iEntry)
+        {
+            entries[iEntry] = getEntry(wordSize, iEntry);
+        }
 
-        const size_t start = (left < 1) ? 1u : left;
-        const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+        sort(entries.begin(), entries.end(), [wordOffset, wordSize](const char *entry1, const char *entry2) {
+            return memcmp(entry1 + wordOffset, entry2 + wordOffset, wordSize) < 0;
+        });
 
-        for (size_t curSize = start; curSize <= stop; ++curSize)
+        const char *prevWord = nullptr;
+
+        for (const char *entry : entries)
         {
-            char *curEntry = fingArrayEntries[curSize];
-            char *nextEntry = fingArrayEntries[curSize + 1];
+            const char *word = entry + wordOffset;
+            size_t prefixSize = 0;
 
-            while (curEntry != nextEntry)
+            if (prevWord != nullptr)
             {
-                if (calcNErrors(patFingerprint, *(reinterpret_cast<FING_T *>(curEntry))) > k)
+                while (prefixSize < wordSize and prefixSize < numeric_limits<unsigned char>::max()
+                    and word[prefixSize] == prevWord[prefixSize])
                 {
-                    nRejected += 1;
+                    prefixSize += 1;
                 }
-
-                curEntry += sizeof(FING_T);
-                curEntry += curSize;
-            
-                nTested += 1;
             }
+
+            frontCodedWords.insert(frontCodedWords.end(), entry, entry + wordOffset);
+            frontCodedWords.push_back(static_cast<char>(prefixSize));
+            frontCodedWords.insert(frontCodedWords.end(), word + prefixSize, word + wordSize);
+
+            prevWord = word;
         }
     }
 
-    if (nTested == 0)
+    frontCodedStarts[0] = 0;
+    frontCodedStarts[maxWordSize + 1] = frontCodedWords.size();
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::releaseFingArray()
+{
+    // These address the entries of fingArray, the scans for Levenshtein distance walk the front coded words.
+    if (useExactHash or deletionIndexK >= 0 or partitionIndexK >= 0 or usePopcountBuckets)
     {
-        return 0.0f;
+        return;
     }
 
-    return static_cast<float>(nRejected) / nTested;
+    IndexMemory::release(fingArray, fingArraySize, fingArrayBacking);
+
+    fingArray = nullptr;
+    fingArraySize = 0;
+    fill(fingArrayEntries, fingArrayEntries + maxWordSize + 2, nullptr);
+
+    frontCodedOnly = true;
 }
 
 template<typename FING_T>
-void Fingerprints<FING_T>::setProcessedWords(const vector<string> &patterns, int k)
+template<typename Fun>
+void Fingerprints<FING_T>::forEachFrontCodedWord(size_t wordSize, char *word, Fun fun) const
 {
-    if (useHamming)
-    {
-        for (const string &pattern : patterns) 
-        {
-            const size_t curSize = pattern.size();
+    const size_t fingSize = useFingerprints ? sizeof(FING_T) : 0;
 
-            char *curEntry = fingArrayEntries[curSize];
-            char *nextEntry = fingArrayEntries[curSize + 1];
-
-            while (curEntry != nextEntry)
-            {
-                if (useFingerprints)
-                {
-                    curEntry += sizeof(FING_T);
-                }
+    const char *curEntry = frontCodedWords.data() + frontCodedStarts[wordSize];
+    const char *entriesEnd = frontCodedWords.data() + frontCodedStarts[wordSize + 1];
 
-                processedWords.push_back(string(curEntry, curSize));
-                curEntry += curSize;
-            }
-        }
-    }
-    else
+    while (curEntry != entriesEnd)
     {
-        for (const string &pattern : patterns) 
-        {
-            const size_t patSize = pattern.size();
+        const FING_T fingerprint = useFingerprints ? *reinterpret_cast<const FING_T *>(curEntry) : 0;
+        const size_t prefixSize = static_cast<unsigned char>(curEntry[fingSize]);
 
-            // We omit sizes which differ by more than k.
-            int left = static_cast<int>(patSize) - k;
-            size_t right = patSize + k;
+        const char *suffix = curEntry + fingSize + 1;
+        curEntry = suffix + wordSize - prefixSize;
 
-            const size_t start = (left < 1) ? 1u : left;
-            const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+        copy(suffix, curEntry, word + prefixSize);
+        fun(fingerprint, static_cast<const char *>(word));
+    }
+}
 
-            for (size_t curSize = start; curSize <= stop; ++curSize)
-            {
-                char *curEntry = fingArrayEntries[curSize];
-                char *nextEntry = fingArrayEntries[curSize + 1];
+template<typename FING_T>
+void Fingerprints<FING_T>::getPopcountWindow(size_t wordSize, size_t patWeight, size_t maxWeightDiff,
+    size_t &iBegin, size_t &iEnd) const
+{
+    const uint32_t *starts = popcountStarts.data() + wordSize * nPopcountStarts;
 
-                while (curEntry != nextEntry)
-                {
-                    if (useFingerprints)
-                    {
-                        curEntry += sizeof(FING_T);
-                    }
+    const size_t minWeight = (patWeight > maxWeightDiff) ? patWeight - maxWeightDiff : 0;
+    const size_t maxWeight = min(patWeight + maxWeightDiff, nPopcountStarts - 2);
 
-                    processedWords.push_back(string(curEntry, curSize));
-                    curEntry += curSize;
-                }
-            }   
-        }
+    iBegin = starts[minWeight];
+    iEnd = starts[maxWeight + 1];
+}
+
+template<typename FING_T>
+size_t Fingerprints<FING_T>::getFingerprintNeighborhoodSizeB() const
+{
+    if (not useFingerprintNeighborhood)
+    {
+        return 0;
     }
+
+    return neighborhoodBits.size() * sizeof(uint64_t) + neighborhoodRanks.size() * sizeof(uint32_t) + sizeof(neighborhoodStarts);
 }
 
 template<typename FING_T>
-void Fingerprints<FING_T>::setProcessedWordsCount(const vector<string> &patterns, int k)
+template<typename Fun>
+void Fingerprints<FING_T>::forEachAcceptedGroup(size_t wordSize, FING_T patFingerprint, const uint64_t *acceptBitmap,
+    const vector<FING_T> *acceptedXors, size_t maxWeightDiff, Fun fun) const
 {
-    if (useHamming)
+    const FingerprintGroup *groups = fingerprintGroups.data() + fingerprintGroupStarts[wordSize];
+    const FingerprintGroup *groupsEnd = fingerprintGroups.data() + fingerprintGroupStarts[wordSize + 1];
+
+    const size_t iBits = neighborhoodStarts[wordSize];
+
+    if (iBits != noNeighborhood and acceptedXors->size() < static_cast<size_t>(groupsEnd - groups))
     {
-        for (const string &pattern : patterns) 
-        {
-            const size_t curSize = pattern.size();
+        const uint64_t *bits = neighborhoodBits.data() + iBits;
+        const uint32_t *ranks = neighborhoodRanks.data() + iBits;
 
-            char *curEntry = fingArrayEntries[curSize];
-            char *nextEntry = fingArrayEntries[curSize + 1];
+        // Only the fingerprints which pass are looked up, rejected groups are never touched.
+        for (const FING_T fingXor : *acceptedXors)
+        {
+            const size_t x = patFingerprint ^ fingXor;
+            const uint64_t bitsWord = bits[x / 64];
 
-            while (curEntry != nextEntry)
+            if ((bitsWord >> (x % 64)) & 0x1U)
             {
-                if (useFingerprints)
-                {
-                    curEntry += sizeof(FING_T);
-                }
-
-                processedWordsCount += 1;
-                curEntry += curSize;
+                const uint64_t precedingMask = (0x1ULL << (x % 64)) - 1;
+                fun(groups[ranks[x / 64] + bitset<64>(bitsWord & precedingMask).count()]);
             }
         }
-    }
-    else
-    {
-        for (const string &pattern : patterns) 
-        {
-            const size_t patSize = pattern.size();
 
-            // We omit sizes which differ by more than k.
-            int left = static_cast<int>(patSize) - k;
-            size_t right = patSize + k;
+        return;
+    }
 
-            const size_t start = (left < 1) ? 1u : left;
-            const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+    if (usePopcountBuckets)
+    {
+        size_t iBegin, iEnd;
+        getPopcountWindow(wordSize, calcHammingWeight(patFingerprint), maxWeightDiff, iBegin, iEnd);
 
-            for (size_t curSize = start; curSize <= stop; ++curSize)
-            {
-                char *curEntry = fingArrayEntries[curSize];
-                char *nextEntry = fingArrayEntries[curSize + 1];
+        // Groups do not cross sub-buckets, since equal fingerprints have equal popcounts.
+        const auto isBefore = [](const FingerprintGroup &group, size_t iEntry) { return group.iEntry < iEntry; };
 
-                while (curEntry != nextEntry)
-                {
-                    if (useFingerprints)
-                    {
-                        curEntry += sizeof(FING_T);
-                    }
+        groupsEnd = lower_bound(groups, groupsEnd, iEnd, isBefore);
+        groups = lower_bound(groups, groupsEnd, iBegin, isBefore);
+    }
 
-                    processedWordsCount += 1;
-                    curEntry += curSize;
-                }
-            }   
+    for (const FingerprintGroup *curGroup = groups; curGroup != groupsEnd; ++curGroup)
+    {
+        // A rejected group is skipped as a whole, its words are not touched.
+        if (isAccepted(acceptBitmap, patFingerprint ^ curGroup->fingerprint))
+        {
+            fun(*curGroup);
         }
     }
 }
 
 template<typename FING_T>
-FING_T Fingerprints<FING_T>::calcFingerprintOcc(const char *str, size_t size) const
+size_t Fingerprints<FING_T>::getFingerprintGroupsSizeB() const
 {
-    assert(charsMap != nullptr);
-
-    FING_T fing = 0x0U;
-    FING_T mask = 0x1U;
-
-    for (size_t i = 0; i < size; ++i)
+    if (not useFingerprintGroups)
     {
-        unsigned char index = charsMap[static_cast<size_t>(str[i])];
-        assert(index < sizeof(FING_T) * 8 or index == noCharIndex);
-
-        if (index != noCharIndex)
-        {
-            fing |= (mask << index);
-        }
+        return 0;
     }
 
-    return fing;
+    return fingerprintGroups.size() * sizeof(FingerprintGroup) + sizeof(fingerprintGroupStarts);
 }
 
 template<typename FING_T>
-FING_T Fingerprints<FING_T>::calcFingerprintCount(const char *str, size_t size) const
+void Fingerprints<FING_T>::buildExactHash()
 {
-    assert(charsMap != nullptr);
-    
-    // 2 byte == 16 bit fingerprints, 2 bits per count -> counts for 8 letters.
-    assert(sizeof(FING_T) == 2);
-
-    FING_T fing = 0x0U;
+    assert(exactHash == nullptr);
+    exactHashSize = 0;
 
-    for (size_t i = 0; i < size; ++i)
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
     {
-        FING_T mask = 0x1U;
-        unsigned char index = charsMap[static_cast<size_t>(str[i])];
+        exactHashStarts[wordSize] = exactHashSize;
+        const size_t bucketSize = getBucketSize(wordSize);
+
+        if (bucketSize != 0)
+        {
+            if (bucketSize >= numeric_limits<uint32_t>::max())
+            {
+                throw invalid_argument("too many words for the exact hash: " + to_string(bucketSize));
+            }
+
+            size_t nSlots = 1;
+
+            while (nSlots < 2 * bucketSize)
+            {
+                nSlots *= 2;
+            }
+
+            exactHashSize += nSlots;
+        }
+    }
+
+    exactHashStarts[maxWordSize + 1] = exactHashSize;
+    exactHash = new uint32_t[exactHashSize]();
+
+    const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
+    {
+        const size_t mask = exactHashStarts[wordSize + 1] - exactHashStarts[wordSize] - 1;
+        uint32_t *slots = exactHash + exactHashStarts[wordSize];
+
+        for (size_t iEntry = 0; iEntry < getBucketSize(wordSize); ++iEntry)
+        {
+            size_t iSlot = calcExactHash(getEntry(wordSize, iEntry) + wordOffset, wordSize) & mask;
+
+            // Words are unique at this point, so we only look for an empty slot.
+            while (slots[iSlot] != 0)
+            {
+                iSlot = (iSlot + 1) & mask;
+            }
+
+            slots[iSlot] = iEntry + 1;
+        }
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::buildDeletionIndex()
+{
+    vector<char> deletionBuffers(deletionBuffersSize);
+
+    // Pairs (hash, id) are packed into 64-bit values, so that sorting them sorts by hash.
+    vector<uint64_t> pairs;
+    vector<uint32_t> wordHashes;
+
+    const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
+    {
+        for (size_t iEntry = 0; iEntry < getBucketSize(wordSize); ++iEntry)
+        {
+            wordHashes.clear();
+            addDeletionVariants(getEntry(wordSize, iEntry) + wordOffset, wordSize, 0, deletionIndexK, 0,
+                deletionBuffers.data(), wordHashes);
+
+            sort(wordHashes.begin(), wordHashes.end());
+            wordHashes.erase(unique(wordHashes.begin(), wordHashes.end()), wordHashes.end());
+
+            const uint32_t id = wordIdStarts[wordSize] + iEntry;
+
+            for (uint32_t hash : wordHashes)
+            {
+                pairs.push_back((static_cast<uint64_t>(hash) << 32) | id);
+            }
+        }
+    }
+
+    deletionPostings.build(pairs);
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::addDeletionVariants(const char *str, size_t size, size_t start, int nDeletions, size_t depth,
+    char *buffers, vector<uint32_t> &hashes)
+{
+    hashes.push_back(calcDeletionHash(str, size));
+
+    if (nDeletions == 0)
+    {
+        return;
+    }
+
+    char *buffer = buffers + depth * (maxWordSize + maxDeletionIndexK);
+
+    for (size_t i = start; i < size; ++i)
+    {
+        if (i > start and str[i] == str[i - 1])
+        {
+            continue;
+        }
+
+        memcpy(buffer, str, i);
+        memcpy(buffer + i, str + i + 1, size - i - 1);
+
+        addDeletionVariants(buffer, size - 1, i, nDeletions - 1, depth + 1, buffers, hashes);
+    }
+}
+
+template<typename FING_T>
+uint32_t Fingerprints<FING_T>::calcDeletionHash(const char *str, size_t size)
+{
+    // The high bits of the exact hash are mixed the best.
+    return calcExactHash(str, size) >> 32;
+}
+
+template<typename FING_T>
+size_t Fingerprints<FING_T>::getDeletionIndexSizeB() const
+{
+    if (not deletionPostings.isBuilt())
+    {
+        return 0;
+    }
+
+    return deletionPostings.getSizeB() + sizeof(wordIdStarts);
+}
+
+template<typename FING_T>
+bool Fingerprints<FING_T>::usesDeletionIndex(int k) const
+{
+    return k <= deletionIndexK and deletionPostings.isBuilt() and not (k == 0 and exactHash != nullptr);
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::collectDeletionCandidates(QueryContext &context, const char *pattern, size_t size, int k) const
+{
+    startCandidates(context);
+
+    // Only words of these sizes can be within the distance.
+    const int left = useHamming ? static_cast<int>(size) : static_cast<int>(size) - k;
+    const size_t right = useHamming ? size : size + k;
+
+    const size_t minSize = (left < 1) ? 1u : left;
+    const size_t maxSize = (right > maxWordSize) ? maxWordSize : right;
+
+    if (minSize > maxSize)
+    {
+        return;
+    }
+
+    vector<uint32_t> &patternVariantHashes = context.patternVariantHashes;
+
+    patternVariantHashes.clear();
+    addDeletionVariants(pattern, size, 0, k, 0, context.deletionBuffers.data(), patternVariantHashes);
+
+    sort(patternVariantHashes.begin(), patternVariantHashes.end());
+    patternVariantHashes.erase(unique(patternVariantHashes.begin(), patternVariantHashes.end()), patternVariantHashes.end());
+
+    for (uint32_t hash : patternVariantHashes)
+    {
+        deletionPostings.forEachId(hash, [&](uint32_t id) {
+            if (id < wordIdStarts[minSize] or id >= wordIdStarts[maxSize + 1])
+            {
+                return;
+            }
+
+            size_t curSize = minSize;
+
+            while (id >= wordIdStarts[curSize + 1])
+            {
+                curSize += 1;
+            }
+
+            addCandidate(context, id, curSize);
+        });
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::buildPartitionIndex()
+{
+    // A transposition can break the two segments around a boundary.
+    nPartitionSegments = useOsa ? 2 * partitionIndexK + 1 : partitionIndexK + 1;
+
+    // Pairs (hash, id) are packed into 64-bit values, so that sorting them sorts by hash.
+    vector<uint64_t> pairs;
+
+    const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+    // Shorter words are not split, they are all candidates.
+    for (size_t wordSize = nPartitionSegments; wordSize <= maxWordSize; ++wordSize)
+    {
+        for (size_t iEntry = 0; iEntry < getBucketSize(wordSize); ++iEntry)
+        {
+            const char *word = getEntry(wordSize, iEntry) + wordOffset;
+            const uint32_t id = wordIdStarts[wordSize] + iEntry;
+
+            for (size_t iSegment = 0; iSegment < nPartitionSegments; ++iSegment)
+            {
+                size_t start, size;
+                getPartitionSegment(wordSize, iSegment, start, size);
+
+                const uint32_t hash = calcPartitionHash(wordSize, iSegment, word + start, size);
+                pairs.push_back((static_cast<uint64_t>(hash) << 32) | id);
+            }
+        }
+    }
+
+    partitionPostings.build(pairs);
+
+    // The sorted pairs give the expected number of hits when probing all segments of a bracket with segments
+    // drawn from the same distribution as the words, i.e. the sum of squared posting list sizes over the bracket size.
+    partitionHitsPerProbes.assign(maxWordSize + 1, 0.0f);
+
+    for (size_t iPair = 0; iPair < pairs.size(); )
+    {
+        size_t iNext = iPair + 1;
+
+        while (iNext < pairs.size() and (pairs[iNext] >> 32) == (pairs[iPair] >> 32))
+        {
+            iNext += 1;
+        }
+
+        const uint32_t id = static_cast<uint32_t>(pairs[iPair]);
+        const size_t wordSize = upper_bound(wordIdStarts, wordIdStarts + maxWordSize + 2, id) - wordIdStarts - 1;
+        const float nPostings = iNext - iPair;
+
+        partitionHitsPerProbes[wordSize] += nPostings * nPostings / getBucketSize(wordSize);
+        iPair = iNext;
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::getPartitionSegment(size_t wordSize, size_t iSegment, size_t &start, size_t &size) const
+{
+    start = iSegment * wordSize / nPartitionSegments;
+    size = (iSegment + 1) * wordSize / nPartitionSegments - start;
+}
+
+template<typename FING_T>
+uint32_t Fingerprints<FING_T>::calcPartitionHash(size_t wordSize, size_t iSegment, const char *str, size_t size)
+{
+    // Equal segments at different positions or in different brackets must not collide systematically,
+    // the multiplication spreads the word size and segment number into the high bits.
+    const uint64_t hash = (calcExactHash(str, size) ^ ((wordSize << 8) | iSegment)) * 0x9E3779B97F4A7C15ULL;
+    return hash >> 32;
+}
+
+template<typename FING_T>
+size_t Fingerprints<FING_T>::getPartitionIndexSizeB() const
+{
+    if (not partitionPostings.isBuilt())
+    {
+        return 0;
+    }
+
+    return partitionPostings.getSizeB() + sizeof(wordIdStarts);
+}
+
+template<typename FING_T>
+bool Fingerprints<FING_T>::usesPartitionIndex(int k) const
+{
+    return k <= partitionIndexK and partitionPostings.isBuilt() and not (k == 0 and exactHash != nullptr)
+        and not usesDeletionIndex(k);
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::collectPartitionCandidates(QueryContext &context, const char *pattern, size_t size, int k) const
+{
+    startCandidates(context);
+
+    // Only words of these sizes can be within the distance.
+    const int left = useHamming ? static_cast<int>(size) : static_cast<int>(size) - k;
+    const size_t right = useHamming ? size : size + k;
+
+    const size_t minSize = (left < 1) ? 1u : left;
+    const size_t maxSize = (right > maxWordSize) ? maxWordSize : right;
+
+    // An intact segment is shifted by the difference between the insertions and deletions before it.
+    const size_t maxShift = useHamming ? 0 : k;
+
+    for (size_t curSize = minSize; curSize <= maxSize; ++curSize)
+    {
+        const uint32_t idStart = wordIdStarts[curSize];
+
+        if (curSize < nPartitionSegments)
+        {
+            for (uint32_t id = idStart; id < wordIdStarts[curSize + 1]; ++id)
+            {
+                addCandidate(context, id, curSize);
+            }
+
+            continue;
+        }
+
+        if (idStart == wordIdStarts[curSize + 1])
+        {
+            continue;
+        }
+
+        for (size_t iSegment = 0; iSegment < nPartitionSegments; ++iSegment)
+        {
+            size_t start, segmentSize;
+            getPartitionSegment(curSize, iSegment, start, segmentSize);
+
+            if (segmentSize > size)
+            {
+                continue;
+            }
+
+            const size_t minPos = (start > maxShift) ? start - maxShift : 0;
+            const size_t maxPos = min(start + maxShift, size - segmentSize);
+
+            for (size_t pos = minPos; pos <= maxPos; ++pos)
+            {
+                const uint32_t hash = calcPartitionHash(curSize, iSegment, pattern + pos, segmentSize);
+
+                partitionPostings.forEachId(hash, [&](uint32_t id) {
+                    // Hashes include the word size, but they can collide with other brackets.
+                    if (id >= idStart and id < wordIdStarts[curSize + 1])
+                    {
+                        addCandidate(context, id, curSize);
+                    }
+                });
+            }
+        }
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::initWordIds()
+{
+    // There is no bracket for empty words.
+    size_t id = 0;
+    wordIdStarts[0] = 0;
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
+    {
+        wordIdStarts[wordSize] = id;
+        id += getBucketSize(wordSize);
+
+        if (id >= numeric_limits<uint32_t>::max())
+        {
+            throw invalid_argument("too many words for a candidate index: " + to_string(id));
+        }
+    }
+
+    wordIdStarts[maxWordSize + 1] = id;
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::collectCandidates(QueryContext &context, const char *pattern, size_t size, int k, Plan plan) const
+{
+    assert(plan == Plan::DeletionIndex or plan == Plan::PartitionIndex);
+
+    if (plan == Plan::DeletionIndex)
+    {
+        collectDeletionCandidates(context, pattern, size, k);
+    }
+    else
+    {
+        collectPartitionCandidates(context, pattern, size, k);
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::startCandidates(QueryContext &context)
+{
+    context.candidates.clear();
+    context.candidateStamp += 1;
+
+    if (context.candidateStamp == 0)
+    {
+        fill(context.candidateStamps.begin(), context.candidateStamps.end(), 0);
+        context.candidateStamp = 1;
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::addCandidate(QueryContext &context, uint32_t id, size_t wordSize) const
+{
+    if (context.candidateStamps[id] == context.candidateStamp)
+    {
+        return;
+    }
+
+    context.candidateStamps[id] = context.candidateStamp;
+    context.candidates.push_back({ getEntry(wordSize, id - wordIdStarts[wordSize]), wordSize });
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::prepareContext(QueryContext &context) const
+{
+    // Moving a context moves the rows, hence the pointers are set again only if the rows are missing.
+    if (not useHamming and context.levRows.size() < 3 * (maxWordSize + 1))
+    {
+        context.levRows.assign(3 * (maxWordSize + 1), 0);
+
+        context.levV0 = context.levRows.data();
+        context.levV1 = context.levV0 + maxWordSize + 1;
+        context.levV2 = context.levV1 + maxWordSize + 1;
+    }
+
+    // Resizing a mapped pattern within the reserved capacity does not allocate.
+    if (useNormalization or useUtf8)
+    {
+        context.normalizedPattern.reserve(maxWordSize * Utf8::maxSequenceSize);
+    }
+
+    if (usePackedWords and packedBits != 0 and context.packedPattern.size() < calcPackedLanesCount(maxWordSize))
+    {
+        context.packedPattern.resize(calcPackedLanesCount(maxWordSize));
+    }
+    if (useFrontCoding and context.frontCodedWord.size() < maxWordSize)
+    {
+        context.frontCodedWord.resize(maxWordSize);
+    }
+
+    if (deletionPostings.isBuilt() or partitionPostings.isBuilt())
+    {
+        // Stamps left by another index are smaller than the current stamp, hence they are harmless.
+        if (context.candidateStamps.size() != wordIdStarts[maxWordSize + 1])
+        {
+            context.candidateStamps.assign(wordIdStarts[maxWordSize + 1], 0);
+            context.candidateStamp = 0;
+        }
+
+        context.deletionBuffers.resize(deletionBuffersSize);
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::calibratePlanner(const vector<string> &words)
+{
+    for (int k = 0; k <= maxPlannerK; ++k)
+    {
+        fill(planUnitCostsNs[k], planUnitCostsNs[k] + nPlans, -1.0f);
+    }
+
+    size_t nWords = 0;
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
+    {
+        nWords += getBucketSize(wordSize);
+    }
+
+    if (nWords == 0)
+    {
+        return;
+    }
+
+    prepareContext(defaultContext);
+    const vector<string> samples = makePlannerSamples(words);
+
+    if (samples.empty())
+    {
+        return;
+    }
+
+    for (int k = 0; k <= maxPlannerK; ++k)
+    {
+        for (size_t iPlan = 0; iPlan < nPlans; ++iPlan)
+        {
+            const Plan plan = static_cast<Plan>(iPlan);
+
+            if (not isPlanAvailable(plan, k))
+            {
+                continue;
+            }
+
+            size_t nUnits = 0;
+
+            for (const string &sample : samples)
+            {
+                size_t sampleSize;
+                normalizePattern(defaultContext, sample, sampleSize);
+
+                nUnits += calcPlanUnits(plan, sampleSize, k);
+            }
+
+            const TestFun testFun = getTestFun(k, plan);
+
+            // The faster of two runs, the first one also warms up the caches and calculates the accept bitmaps.
+            float elapsedNs = numeric_limits<float>::max();
+
+            for (int iRun = 0; iRun < 2; ++iRun)
+            {
+                const auto start = chrono::steady_clock::now();
+                (this->*testFun)(defaultContext, samples, k);
+                const auto end = chrono::steady_clock::now();
+
+                elapsedNs = min(elapsedNs, static_cast<float>(chrono::duration_cast<chrono::nanoseconds>(end - start).count()));
+            }
+
+            planUnitCostsNs[k][iPlan] = elapsedNs / max<size_t>(nUnits, 1);
+        }
+    }
+}
+
+template<typename FING_T>
+vector<string> Fingerprints<FING_T>::makePlannerSamples(const vector<string> &words)
+{
+    // Sample queries are dictionary words spread evenly over the input, hence over the word sizes, with a substitution
+    // in the middle, so that each plan processes what it would for a typical misspelling. They are taken before
+    // normalization or decoding (like any pattern), since the kernels map them again.
+    vector<string> samples;
+    const size_t nSamples = (words.size() < nPlannerSamples) ? words.size() : nPlannerSamples;
+
+    for (size_t iSample = 0; iSample < nSamples; ++iSample)
+    {
+        string sample = words[iSample * words.size() / nSamples];
+
+        size_t sampleSize;
+        normalizePattern(defaultContext, sample, sampleSize);
+
+        if (sampleSize == 0 or sampleSize > maxWordSize)
+        {
+            continue;
+        }
+
+        // In UTF-8 mode the whole sequence of the middle code point is substituted.
+        size_t subStart = sample.size() / 2, subEnd = subStart + 1;
+
+        if (useUtf8)
+        {
+            uint32_t codePoint;
+            subEnd = 0;
+
+            for (size_t iCodePoint = 0; iCodePoint <= sampleSize / 2; ++iCodePoint)
+            {
+                subStart = subEnd;
+                Utf8::decodeNext(sample.c_str(), sample.size(), subEnd, codePoint);
+            }
+        }
+
+        const char subChar = (sample[subStart] == 'e') ? 'a' : 'e';
+        sample.replace(subStart, subEnd - subStart, 1, subChar);
+
+        samples.emplace_back(move(sample));
+    }
+
+    return samples;
+}
+
+template<typename FING_T>
+size_t Fingerprints<FING_T>::calcPlanUnits(Plan plan, size_t size, int k) const
+{
+    // Only words of these sizes can be within the distance.
+    const int left = useHamming ? static_cast<int>(size) : static_cast<int>(size) - k;
+    const size_t right = useHamming ? size : size + k;
+
+    const size_t minSize = (left < 1) ? 1u : left;
+    const size_t maxSize = (right > maxWordSize) ? maxWordSize : right;
+
+    size_t nUnits = 0;
+
+    switch (plan)
+    {
+        case Plan::ExactHash:
+            return 1;
+
+        case Plan::DeletionIndex:
+        {
+            // Variants with up to k deletions, repeated ones are not subtracted.
+            size_t nCombinations = 1;
+            nUnits = 1;
+
+            for (size_t nDeletions = 1; nDeletions <= static_cast<size_t>(k) and nDeletions <= size; ++nDeletions)
+            {
+                nCombinations = nCombinations * (size - nDeletions + 1) / nDeletions;
+                nUnits += nCombinations;
+            }
+
+            return nUnits;
+        }
+
+        case Plan::PartitionIndex:
+        {
+            const size_t nShifts = useHamming ? 1 : 2 * k + 1;
+
+            for (size_t curSize = minSize; curSize <= maxSize; ++curSize)
+            {
+                if (curSize < nPartitionSegments)
+                {
+                    nUnits += getBucketSize(curSize);
+                }
+                else if (getBucketSize(curSize) != 0)
+                {
+                    nUnits += nShifts * (nPartitionSegments + static_cast<size_t>(partitionHitsPerProbes[curSize]));
+                }
+            }
+
+            return nUnits;
+        }
+
+        default:
+            for (size_t curSize = minSize; curSize <= maxSize; ++curSize)
+            {
+                nUnits += getBucketSize(curSize);
+            }
+
+            return nUnits;
+    }
+}
+
+template<typename FING_T>
+typename Fingerprints<FING_T>::Plan Fingerprints<FING_T>::choosePlan(size_t size, int k) const
+{
+    assert(usePlanner and k <= maxPlannerK);
+
+    Plan bestPlan = getDefaultPlan(k);
+    float bestCostNs = numeric_limits<float>::max();
+
+    for (size_t iPlan = 0; iPlan < nPlans; ++iPlan)
+    {
+        const float unitCostNs = planUnitCostsNs[k][iPlan];
+
+        if (unitCostNs < 0.0f)
+        {
+            continue;
+        }
+
+        const float costNs = unitCostNs * calcPlanUnits(static_cast<Plan>(iPlan), size, k);
+
+        if (costNs < bestCostNs)
+        {
+            bestPlan = static_cast<Plan>(iPlan);
+            bestCostNs = costNs;
+        }
+    }
+
+    return bestPlan;
+}
+
+template<typename FING_T>
+float Fingerprints<FING_T>::getPlanUnitCostNs(Plan plan, int k) const
+{
+    if (not usePlanner or k < 0 or k > maxPlannerK)
+    {
+        return -1.0f;
+    }
+
+    return planUnitCostsNs[k][static_cast<size_t>(plan)];
+}
+
+template<typename FING_T>
+string Fingerprints<FING_T>::getPlanName(Plan plan)
+{
+    switch (plan)
+    {
+        case Plan::ExactHash:
+            return "exact hash";
+        case Plan::DeletionIndex:
+            return "deletion index";
+        case Plan::PartitionIndex:
+            return "partition index";
+        case Plan::FingerprintScan:
+            return "fingerprint scan";
+        default:
+            return "word scan";
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::initNErrorsLUT()
+{
+    size_t fingSizeBits = sizeof(FING_T) * 8;
+    nErrorsLUT = new unsigned char[fingSizeBits + 1];
+
+    for (size_t i = 0; i <= fingSizeBits; ++i)
+    {
+        nErrorsLUT[i] = (i + subNMismatches - 1) / subNMismatches;
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::initCharsMap(FingerprintType fingerprintType,
+    LettersType lettersType)
+{
+    charsMap = new unsigned char[charsMapSize];
+
+    for (size_t i = 0; i < charsMapSize; ++i)
+    {
+        charsMap[i] = noCharIndex;
+    }
+
+    size_t nChars;
+
+    switch (fingerprintType)
+    {
+        case FingerprintType::Occ:
+            nChars = sizeof(FING_T) * 8;
+            break;
+        case FingerprintType::OccHalved:
+            nChars = sizeof(FING_T) * 4;
+            break;
+        case FingerprintType::Count:
+            nChars = sizeof(FING_T) * 4;
+            break;
+        default:
+            assert(false);
+            return;
+    }
+
+    string charList = getCharList(nChars, lettersType);
+    assert(charList.size() == nChars);
+
+    for (size_t i = 0; i < nChars; ++i)
+    {
+        const char c = charList[i];
+
+        if (fingerprintType == FingerprintType::OccHalved)
+        {
+            charsMap[static_cast<unsigned char>(c)] = 2 * i;
+        }
+        else
+        {
+            charsMap[static_cast<unsigned char>(c)] = i;
+        }
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::initCharList(LettersType lettersType)
+{
+    size_t nChars = sizeof(FING_T) * 8 / nBitsPerPos;
+    string curList = getCharList(nChars, lettersType);
+
+    charList = new unsigned char[curList.size() + 1];
+
+    for (size_t i = 0; i < curList.size(); ++i)
+    {
+        charList[i] = curList[i];
+    }
+
+    charList[curList.size()] = '\0';
+}
+
+template<typename FING_T>
+string Fingerprints<FING_T>::getCharList(size_t nChars, LettersType lettersType) const
+{
+    switch (lettersType)
+    {
+        case LettersType::Common:
+            switch (nChars)
+            {
+                case 5:
+                    return engCommonLettersPos5;
+                case 8:
+                    return engCommonLetters8;
+                case 16:
+                    return engCommonLetters16;
+            }
+        case LettersType::Mixed:
+            switch (nChars)
+            {
+                case 5:
+                    return engMixedLettersPos5;
+                case 8:
+                    return engMixedLetters8;
+                case 16:
+                    return engMixedLetters16;
+            }
+        case LettersType::Rare:
+            switch (nChars)
+            {
+                case 5:
+                    return engRareLettersPos5;
+                case 8:
+                    return engRareLetters8;
+                case 16:
+                    return engRareLetters16;
+            }
+    }
+
+    assert(false);
+    return "";
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::allocNMismatchesLUT()
+{
+    assert(nMismatchesLUT == nullptr);
+
+    // The table is only read when calculating the accept bitmaps, a huge page of its own would be wasted.
+    nMismatchesLUT = new unsigned char[nMismatchesLUTSize()];
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::lockIndexMemory()
+{
+    memoryLocked = IndexMemory::lock(fingArray, fingArraySize);
+
+    if (nMismatchesLUT != nullptr)
+    {
+        memoryLocked = IndexMemory::lock(reinterpret_cast<const char *>(nMismatchesLUT), nMismatchesLUTSize()) and memoryLocked;
+    }
+    if (exactHash != nullptr)
+    {
+        memoryLocked = IndexMemory::lock(reinterpret_cast<const char *>(exactHash), getExactHashSizeB()) and memoryLocked;
+    }
+
+    // The remaining arrays are empty unless the corresponding options are set.
+    memoryLocked = IndexMemory::lock(fingerprintGroups) and memoryLocked;
+    memoryLocked = IndexMemory::lock(neighborhoodBits) and memoryLocked;
+    memoryLocked = IndexMemory::lock(neighborhoodRanks) and memoryLocked;
+    memoryLocked = IndexMemory::lock(popcountStarts) and memoryLocked;
+    memoryLocked = IndexMemory::lock(packedLanes) and memoryLocked;
+    memoryLocked = IndexMemory::lock(frontCodedWords) and memoryLocked;
+    memoryLocked = deletionPostings.lock() and memoryLocked;
+    memoryLocked = partitionPostings.lock() and memoryLocked;
+
+    if (useFingerprints)
+    {
+        // Otherwise the first query for each k would calculate its bitmaps.
+        for (int k = 0; k <= maxPrebuiltK; ++k)
+        {
+            prepareAcceptBitmaps(k);
+        }
+
+        for (size_t i = 0; i < nAcceptBitmaps; ++i)
+        {
+            for (size_t j = 0; j < nAcceptBitmaps; ++j)
+            {
+                const uint64_t *bitmap = acceptBitmaps[i][j].load();
+
+                if (bitmap != nullptr)
+                {
+                    memoryLocked = IndexMemory::lock(reinterpret_cast<const char *>(bitmap),
+                        acceptBitmapSize() * sizeof(uint64_t)) and memoryLocked;
+                }
+            }
+        }
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::calcOccNMismatchesLUT()
+{
+    FING_T maxVal = std::numeric_limits<FING_T>::max();
+
+    allocNMismatchesLUT();
+
+    FING_T n = 0x0U;
+
+    while (true)
+    {
+        nMismatchesLUT[n] = calcHammingWeight(n);
+        assert(nMismatchesLUT[n] >= 0 and nMismatchesLUT[n] <= sizeof(FING_T) * 8);
+
+        // Beware of overflows here.
+        if (n == maxVal)
+        {
+            break;
+        }
+
+        n += 1;
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::calcCountNMismatchesLUT()
+{
+    assert(sizeof(FING_T) == 2);
+
+    FING_T maxVal = std::numeric_limits<FING_T>::max();
+
+    allocNMismatchesLUT();
+
+    FING_T mask = 0b011U;
+    FING_T n = 0x0U;
+
+    while (true)
+    {
+        unsigned char nErrors = 0;
+
+        for (int iM = 0; iM < 8; ++iM)
+        {
+            // Unfortunately each difference in a count can lead only up to max 1 error.
+            // Example: fingerprint 01 (letter count = 1) xored with fingerprint 10 (letter count = 2) 
+            // -> results in 11.
+            // Two bits are set in the result but they translate to only 1 error.
+            if (n & (mask << (2 * iM)))
+            {
+                nErrors += 1;
+            }
+        }
+
+        assert(nErrors >= 0 and nErrors <= 8);
+        nMismatchesLUT[n] = nErrors;
+
+        // Beware of overflows here.
+        if (n == maxVal)
+        {
+            break;
+        }
+
+        n += 1;
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::calcPosNMismatchesLUT()
+{
+    assert(sizeof(FING_T) == 2);
+
+    FING_T maxVal = std::numeric_limits<FING_T>::max();
+
+    allocNMismatchesLUT();
+
+    FING_T mask = 0b0111U;
+    FING_T n = 0x0U;
+
+    while (true)
+    {
+        unsigned char nErrors = 0;
+
+        // If there is any difference between the corresponding positions,
+        // then at least one of the bits in the triplet will be set.
+        for (int iM = 0; iM < 5; ++iM)
+        {
+            if (n & (mask << (nBitsPerPos * iM)))
+            {
+                nErrors += 1;
+            }
+        }
+
+        assert(nErrors >= 0 and nErrors <= 5);
+
+        // The last bit is used for a single occurrence.
+        if (n & (0x1U << 15))
+        {
+            nErrors += 1;
+        }
+
+        assert(nErrors >= 0 and nErrors <= 6);
+        nMismatchesLUT[n] = nErrors;
+
+        // Beware of overflows here.
+        if (n == maxVal)
+        {
+            break;
+        }
+
+        n += 1;
+    }
+}
+
+template<typename FING_T>
+size_t Fingerprints<FING_T>::calcTotalSize(const vector<string> &words, size_t *wordCountsBySize)
+{
+    size_t totalSize = 0;
+
+    for (size_t i = 0; i <= maxWordSize; ++i)
+    {
+        wordCountsBySize[i] = 0;
+    }
+
+    for (const string &word : words)
+    {
+        wordCountsBySize[word.size()] += 1;
+        totalSize += word.size() + sizeof(FING_T);
+    }
+
+    return totalSize;
+}
+
+template<typename FING_T>
+size_t Fingerprints<FING_T>::calcArraySize(const size_t *wordCountsBySize) const
+{
+    size_t arraySize = 0;
+
+    for (size_t wordSize = 1; wordSize <= maxWordSize; ++wordSize)
+    {
+        arraySize += wordCountsBySize[wordSize] * calcEntryStride(wordSize);
+    }
+
+    return arraySize;
+}
+
+template<typename FING_T>
+template<int K>
+int Fingerprints<FING_T>::testFingerprintsHamming(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    int nMatches = 0;
+    const uint64_t *acceptBitmap = getAcceptBitmap(k);
+    const size_t maxWeightDiff = usePopcountBuckets ? getMaxAcceptedWeight(k) : 0;
+
+    for (const string &pattern : patterns) 
+    {
+        size_t curSize;
+        const char *patStr = normalizePattern(context, pattern, curSize);
+        const FING_T patFingerprint = calcFingerprintFun(patStr, curSize);
+
+        char *curEntry = fingArrayEntries[curSize];
+        char *nextEntry = fingArrayEntries[curSize + 1];
+
+        const size_t entryStride = calcEntryStride(curSize);
+        const size_t prefetchOffset = calcPrefetchDistance(entryStride) * entryStride;
+
+        if (usePopcountBuckets)
+        {
+            size_t iBegin, iEnd;
+            getPopcountWindow(curSize, calcHammingWeight(patFingerprint), maxWeightDiff, iBegin, iEnd);
+
+            nextEntry = curEntry + iEnd * entryStride;
+            curEntry += iBegin * entryStride;
+        }
+
+        while (curEntry != nextEntry)
+        {
+            if (prefetchOffset != 0)
+            {
+                prefetchEntries(curEntry, nextEntry, patFingerprint, acceptBitmap, entryStride, prefetchOffset);
+            }
+
+            // We iterate over all words and calculate the Hamming distance only
+            // when the fingerprint comparison is not successful.
+            if (isAccepted(acceptBitmap, patFingerprint ^ *(reinterpret_cast<FING_T *>(curEntry))))
+            {
+                if (isHamAtMost<K>(patStr, curEntry + sizeof(FING_T), curSize, k))
+                {
+                    // Make sure that the number of results is returned in order to
+                    // prevent the compiler from overoptimizing unused results.
+                    nMatches += 1;
+                }
+            }
+
+            curEntry += entryStride;
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+template<int K, bool Osa>
+int Fingerprints<FING_T>::testFingerprintsLeven(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    int nMatches = 0;
+
+    for (const string &pattern : patterns) 
+    {
+        size_t patSize;
+        const char *patStr = normalizePattern(context, pattern, patSize);
+        const FING_T patFingerprint = calcFingerprintFun(patStr, patSize);
+        const size_t patWeight = calcHammingWeight(patFingerprint);
+
+        if (Osa)
+        {
+            setOsaPattern(context, patStr, patSize);
+        }
+
+        // We omit sizes which differ by more than k.
+        int left = static_cast<int>(patSize) - k;
+        size_t right = patSize + k;
+
+        const size_t start = (left < 1) ? 1u : left;
+        const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+
+        for (size_t curSize = start; curSize <= stop; ++curSize)
+        {
+            char *curEntry = fingArrayEntries[curSize];
+            char *nextEntry = fingArrayEntries[curSize + 1];
+
+            // Words whose size differs by d require at least d errors, which tightens the fingerprint bound.
+            const size_t lenDiff = (curSize > patSize) ? curSize - patSize : patSize - curSize;
+            const uint64_t *acceptBitmap = getAcceptBitmap(k, lenDiff);
+
+            const size_t entryStride = calcEntryStride(curSize);
+            const size_t prefetchOffset = calcPrefetchDistance(entryStride) * entryStride;
+
+            if (usePopcountBuckets)
+            {
+                size_t iBegin, iEnd;
+                getPopcountWindow(curSize, patWeight, getMaxAcceptedWeight(k, lenDiff), iBegin, iEnd);
+
+                nextEntry = curEntry + iEnd * entryStride;
+                curEntry += iBegin * entryStride;
+            }
+
+            while (curEntry != nextEntry)
+            {
+                if (prefetchOffset != 0)
+                {
+                    prefetchEntries(curEntry, nextEntry, patFingerprint, acceptBitmap, entryStride, prefetchOffset);
+                }
+
+                // We iterate over all words and calculate the Hamming distance only
+                // when the fingerprint comparison is not successful.
+                if (isAccepted(acceptBitmap, patFingerprint ^ *(reinterpret_cast<FING_T *>(curEntry))))
+                {
+                    const char *word = curEntry + sizeof(FING_T);
+
+                    if (Osa ? isOsaAtMostK(context, patStr, patSize, word, curSize, k)
+                        : isLevAtMost<K>(context, patStr, patSize, word, curSize, k))
+                    {
+                        // Make sure that the number of results is returned in order to
+                        // prevent the compiler from overoptimizing unused results.
+                        nMatches += 1;
+                    }
+                }
+
+                curEntry += entryStride;
+            }
+        }
+
+        if (Osa)
+        {
+            clearOsaPattern(context, patStr, patSize);
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+template<int K>
+int Fingerprints<FING_T>::testGroupsHamming(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    int nMatches = 0;
+    const uint64_t *acceptBitmap = getAcceptBitmap(k);
+    const vector<FING_T> *acceptedXors = useFingerprintNeighborhood ? &getAcceptedXors(k) : nullptr;
+    const size_t maxWeightDiff = usePopcountBuckets ? getMaxAcceptedWeight(k) : 0;
+
+    for (const string &pattern : patterns)
+    {
+        size_t curSize;
+        const char *patStr = normalizePattern(context, pattern, curSize);
+        const FING_T patFingerprint = calcFingerprintFun(patStr, curSize);
+
+        const char *bucket = fingArrayEntries[curSize];
+        const size_t entryStride = calcEntryStride(curSize);
+
+        forEachAcceptedGroup(curSize, patFingerprint, acceptBitmap, acceptedXors, maxWeightDiff, [&](const FingerprintGroup &group) {
+            const char *curEntry = bucket + group.iEntry * entryStride;
+            const char *groupEnd = curEntry + group.nEntries * entryStride;
+
+            for (; curEntry != groupEnd; curEntry += entryStride)
+            {
+                if (isHamAtMost<K>(patStr, curEntry + sizeof(FING_T), curSize, k))
+                {
+                    // Make sure that the number of results is returned in order to
+                    // prevent the compiler from overoptimizing unused results.
+                    nMatches += 1;
+                }
+            }
+        });
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+template<int K, bool Osa>
+int Fingerprints<FING_T>::testGroupsLeven(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    int nMatches = 0;
+
+    for (const string &pattern : patterns)
+    {
+        size_t patSize;
+        const char *patStr = normalizePattern(context, pattern, patSize);
+        const FING_T patFingerprint = calcFingerprintFun(patStr, patSize);
+
+        if (Osa)
+        {
+            setOsaPattern(context, patStr, patSize);
+        }
+
+        // We omit sizes which differ by more than k.
+        int left = static_cast<int>(patSize) - k;
+        size_t right = patSize + k;
+
+        const size_t start = (left < 1) ? 1u : left;
+        const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+
+        for (size_t curSize = start; curSize <= stop; ++curSize)
+        {
+            // Words whose size differs by d require at least d errors, which tightens the fingerprint bound.
+            const size_t lenDiff = (curSize > patSize) ? curSize - patSize : patSize - curSize;
+            const uint64_t *acceptBitmap = getAcceptBitmap(k, lenDiff);
+            const vector<FING_T> *acceptedXors = useFingerprintNeighborhood ? &getAcceptedXors(k, lenDiff) : nullptr;
+            const size_t maxWeightDiff = usePopcountBuckets ? getMaxAcceptedWeight(k, lenDiff) : 0;
+
+            const char *bucket = fingArrayEntries[curSize];
+            const size_t entryStride = calcEntryStride(curSize);
+
+            forEachAcceptedGroup(curSize, patFingerprint, acceptBitmap, acceptedXors, maxWeightDiff,
+                [&](const FingerprintGroup &group) {
+                const char *curEntry = bucket + group.iEntry * entryStride;
+                const char *groupEnd = curEntry + group.nEntries * entryStride;
+
+                for (; curEntry != groupEnd; curEntry += entryStride)
+                {
+                    const char *word = curEntry + sizeof(FING_T);
+
+                    if (Osa ? isOsaAtMostK(context, patStr, patSize, word, curSize, k)
+                        : isLevAtMost<K>(context, patStr, patSize, word, curSize, k))
+                    {
+                        // Make sure that the number of results is returned in order to
+                        // prevent the compiler from overoptimizing unused results.
+                        nMatches += 1;
+                    }
+                }
+            });
+        }
+
+        if (Osa)
+        {
+            clearOsaPattern(context, patStr, patSize);
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+int Fingerprints<FING_T>::testExactHash(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    assert(k == 0 and exactHash != nullptr);
+    (void)k;
+
+    int nMatches = 0;
+    size_t nCompared = 0;
+
+    for (const string &pattern : patterns)
+    {
+        size_t patSize;
+        const char *patStr = normalizePattern(context, pattern, patSize);
+
+        if (probeExactHash(patStr, patSize, nCompared) >= 0)
+        {
+            nMatches += 1;
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+template<int K, typename Fingerprints<FING_T>::Plan P>
+int Fingerprints<FING_T>::testCandidateIndex(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    assert(isPlanAvailable(P, k));
+
+    int nMatches = 0;
+
+    // Accept bitmaps for each size difference, there are at most k + 1 of them.
+    static_assert(maxPartitionIndexK >= maxDeletionIndexK, "the partition index covers the largest k");
+    const uint64_t *acceptBitmapsForK[maxPartitionIndexK + 1];
+
+    for (int lenDiff = 0; lenDiff <= k and useFingerprints; ++lenDiff)
+    {
+        acceptBitmapsForK[lenDiff] = getAcceptBitmap(k, useHamming ? 0 : lenDiff);
+    }
+
+    for (const string &pattern : patterns)
+    {
+        size_t patSize;
+        const char *patStr = normalizePattern(context, pattern, patSize);
+
+        collectCandidates(context, patStr, patSize, k, P);
+
+        if (context.candidates.empty())
+        {
+            continue;
+        }
+
+        const FING_T patFingerprint = useFingerprints ? calcFingerprintFun(patStr, patSize) : 0;
+        const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+        if (useOsa)
+        {
+            setOsaPattern(context, patStr, patSize);
+        }
+
+        for (const Candidate &candidate : context.candidates)
+        {
+            if (useFingerprints)
+            {
+                const size_t lenDiff = (candidate.size > patSize) ? candidate.size - patSize : patSize - candidate.size;
+                const FING_T fingerprint = *reinterpret_cast<const FING_T *>(candidate.entry);
+
+                if (not isAccepted(acceptBitmapsForK[lenDiff], patFingerprint ^ fingerprint))
+                {
+                    continue;
+                }
+            }
+
+            const char *word = candidate.entry + wordOffset;
+            bool isMatch;
+
+            if (useHamming)
+            {
+                isMatch = isHamAtMost<K>(patStr, word, patSize, k);
+            }
+            else if (useOsa)
+            {
+                isMatch = isOsaAtMostK(context, patStr, patSize, word, candidate.size, k);
+            }
+            else
+            {
+                isMatch = isLevAtMost<K>(context, patStr, patSize, word, candidate.size, k);
+            }
+
+            if (isMatch)
+            {
+                // Make sure that the number of results is returned in order to
+                // prevent the compiler from overoptimizing unused results.
+                nMatches += 1;
+            }
+        }
+
+        if (useOsa)
+        {
+            clearOsaPattern(context, patStr, patSize);
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+int64_t Fingerprints<FING_T>::probeExactHash(const char *str, size_t size, size_t &nCompared,
+    vector<string> *comparedWords) const
+{
+    if (size == 0 or size > maxWordSize)
+    {
+        return -1;
+    }
+
+    // Empty brackets have no slots.
+    if (exactHashStarts[size + 1] == exactHashStarts[size])
+    {
+        return -1;
+    }
+
+    const size_t mask = exactHashStarts[size + 1] - exactHashStarts[size] - 1;
+
+    const uint32_t *slots = exactHash + exactHashStarts[size];
+    const char *bucket = fingArrayEntries[size] + (useFingerprints ? sizeof(FING_T) : 0);
+    const size_t entryStride = calcEntryStride(size);
+
+    for (size_t iSlot = calcExactHash(str, size) & mask; slots[iSlot] != 0; iSlot = (iSlot + 1) & mask)
+    {
+        const size_t iEntry = slots[iSlot] - 1;
+        nCompared += 1;
+
+        if (comparedWords != nullptr)
+        {
+            comparedWords->push_back(string(bucket + iEntry * entryStride, size));
+        }
+
+        if (memcmp(bucket + iEntry * entryStride, str, size) == 0)
+        {
+            return iEntry;
+        }
+    }
+
+    return -1;
+}
+
+template<typename FING_T>
+uint64_t Fingerprints<FING_T>::calcExactHash(const char *str, size_t size)
+{
+    // 64-bit FNV-1a followed by a final mix, since only the low bits are used for indexing.
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash ^ (hash >> 29);
+}
+
+template<typename FING_T>
+size_t Fingerprints<FING_T>::calcPrefetchDistance(size_t entrySize)
+{
+    // Short entries are packed densely enough for the hardware prefetcher to keep up.
+    if (entrySize < cacheLineSize)
+    {
+        return 0;
+    }
+
+    const size_t distance = prefetchAheadBytes / entrySize;
+
+    if (distance < minPrefetchDistance)
+    {
+        return minPrefetchDistance;
+    }
+    if (distance > maxPrefetchDistance)
+    {
+        return maxPrefetchDistance;
+    }
+
+    return distance;
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::prefetchEntries(const char *curEntry, const char *nextEntry,
+    FING_T patFingerprint, const uint64_t *acceptBitmap, size_t entrySize, size_t prefetchOffset) const
+{
+    const size_t nBytesLeft = nextEntry - curEntry;
+
+    // The first stage fetches only the line holding the fingerprint of an entry twice the distance ahead.
+    if (nBytesLeft > 2 * prefetchOffset)
+    {
+        __builtin_prefetch(curEntry + 2 * prefetchOffset);
+    }
+
+    // The second stage looks at the fingerprint fetched by the first stage, and if the entry is
+    // likely to be verified, it also fetches the remaining lines of its word.
+    if (nBytesLeft > prefetchOffset)
+    {
+        const char *entry = curEntry + prefetchOffset;
+
+        if (isAccepted(acceptBitmap, patFingerprint ^ *(reinterpret_cast<const FING_T *>(entry))))
+        {
+            const uintptr_t entryLine = reinterpret_cast<uintptr_t>(entry) & ~(cacheLineSize - 1);
+            const uintptr_t entryEnd = reinterpret_cast<uintptr_t>(entry) + entrySize;
+
+            for (uintptr_t line = entryLine + cacheLineSize; line < entryEnd; line += cacheLineSize)
+            {
+                __builtin_prefetch(reinterpret_cast<const char *>(line));
+            }
+        }
+    }
+}
+
+template<typename FING_T>
+template<int K>
+int Fingerprints<FING_T>::testWordsHamming(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    int nMatches = 0;
+   
+    for (const string &pattern : patterns) 
+    {
+        size_t curSize;
+        const char *patStr = normalizePattern(context, pattern, curSize);
+
+        char *curEntry = fingArrayEntries[curSize];
+        char *nextEntry = fingArrayEntries[curSize + 1];
+
+        const size_t entryStride = calcEntryStride(curSize);
+        const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+        while (curEntry != nextEntry)
+        {
+            if (isHamAtMost<K>(patStr, curEntry + wordOffset, curSize, k))
+            {
+                // Make sure that the number of results is returned in order to
+                // prevent the compiler from overoptimizing unused results.
+                nMatches += 1;
+            }
+
+            curEntry += entryStride;
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+template<size_t Bits>
+int Fingerprints<FING_T>::testPackedHamming(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    int nMatches = 0;
+    const size_t maxMismatches = k;
+
+    for (const string &pattern : patterns)
+    {
+        size_t curSize;
+        const char *patStr = normalizePattern(context, pattern, curSize);
+
+        uint64_t *packedPattern = context.packedPattern.data();
+        packWord<Bits>(patStr, curSize, packedPattern);
+
+        const size_t nLanes = calcPackedLanesCount(curSize);
+        const uint64_t *curLanes = packedLanes.data() + packedStarts[curSize];
+        const uint64_t *lanesEnd = packedLanes.data() + packedStarts[curSize + 1];
+
+        if (nLanes == 1)
+        {
+            const uint64_t patLane = packedPattern[0];
+
+            for (; curLanes != lanesEnd; ++curLanes)
+            {
+                if (countPackedMismatches<Bits>(patLane ^ *curLanes) <= maxMismatches)
+                {
+                    // Make sure that the number of results is returned in order to
+                    // prevent the compiler from overoptimizing unused results.
+                    nMatches += 1;
+                }
+            }
+
+            continue;
+        }
+
+        for (; curLanes != lanesEnd; curLanes += nLanes)
+        {
+            size_t nMismatches = 0;
+
+            for (size_t iLane = 0; iLane < nLanes and nMismatches <= maxMismatches; ++iLane)
+            {
+                nMismatches += countPackedMismatches<Bits>(packedPattern[iLane] ^ curLanes[iLane]);
+            }
+
+            if (nMismatches <= maxMismatches)
+            {
+                // Make sure that the number of results is returned in order to
+                // prevent the compiler from overoptimizing unused results.
+                nMatches += 1;
+            }
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+template<bool UseFingerprints>
+int Fingerprints<FING_T>::testFrontCodedLeven(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    int nMatches = 0;
+
+    const size_t fingSize = useFingerprints ? sizeof(FING_T) : 0;
+    constexpr size_t noDepth = numeric_limits<size_t>::max();
+
+    // Values are capped at k + 1, which also serves as infinity outside of the 2k + 1 strip.
+    const int overBound = k + 1;
+
+    vector<int> &frontCodedRows = context.frontCodedRows;
+    vector<char> &frontCodedWord = context.frontCodedWord;
+
+    for (const string &pattern : patterns)
+    {
+        size_t patSize;
+        const char *patStr = normalizePattern(context, pattern, patSize);
+        const FING_T patFingerprint = UseFingerprints ? calcFingerprintFun(patStr, patSize) : 0;
+
+        const int size = patSize;
+        const size_t rowSize = patSize + 1;
+
+        // We omit sizes which differ by more than k.
+        int left = static_cast<int>(patSize) - k;
+        size_t right = patSize + k;
+
+        const size_t start = (left < 1) ? 1u : left;
+        const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+
+        if (frontCodedRows.size() < (stop + 1) * rowSize)
+        {
+            frontCodedRows.resize((stop + 1) * rowSize);
+        }
+
+        for (int j = 0; j <= size; ++j)
+        {
+            frontCodedRows[j] = min(j, overBound);
+        }
+
+        for (size_t curSize = start; curSize <= stop; ++curSize)
+        {
+            const char *curEntry = frontCodedWords.data() + frontCodedStarts[curSize];
+            const char *entriesEnd = frontCodedWords.data() + frontCodedStarts[curSize + 1];
+
+            const size_t lenDiff = (curSize > patSize) ? curSize - patSize : patSize - curSize;
+            const uint64_t *acceptBitmap = UseFingerprints ? getAcceptBitmap(k, lenDiff) : nullptr;
+
+            // Rows are valid for the prefixes of frontCodedWord up to validDepth, and the row at deadDepth
+            // exceeds k everywhere, hence so do all the rows below it.
+            size_t validDepth = 0;
+            size_t deadDepth = noDepth;
+
+            while (curEntry != entriesEnd)
+            {
+                const FING_T fingerprint = UseFingerprints ? *reinterpret_cast<const FING_T *>(curEntry) : 0;
+                const size_t prefixSize = static_cast<unsigned char>(curEntry[fingSize]);
+
+                const char *suffix = curEntry + fingSize + 1;
+
+                curEntry = suffix + curSize - prefixSize;
+                validDepth = min(validDepth, prefixSize);
+
+                // The chars after the dead prefix are not needed, the following words either share the dead prefix
+                // as well or they replace these chars.
+                if (deadDepth <= prefixSize)
+                {
+                    continue;
+                }
+
+                deadDepth = noDepth;
+                copy(suffix, suffix + curSize - prefixSize, frontCodedWord.begin() + prefixSize);
+
+                // A rejected word still calculates the rows for the prefix shared with the next word, since
+                // the next word would calculate them anyway, and they might show that the prefix is dead.
+                const bool isCandidate = not UseFingerprints or isAccepted(acceptBitmap, patFingerprint ^ fingerprint);
+                const size_t nextPrefixSize = (curEntry != entriesEnd) ? static_cast<unsigned char>(curEntry[fingSize]) : 0;
+                const size_t targetDepth = isCandidate ? curSize : min(nextPrefixSize, curSize);
+
+                for (size_t depth = validDepth + 1; depth <= targetDepth; ++depth)
+                {
+                    const int *prev = frontCodedRows.data() + (depth - 1) * rowSize;
+                    int *cur = frontCodedRows.data() + depth * rowSize;
+
+                    const int rowLeft = max(1, static_cast<int>(depth) - k);
+                    const int rowRight = min(size, static_cast<int>(depth) + k);
+
+                    cur[rowLeft - 1] = (rowLeft == 1) ? min(static_cast<int>(depth), overBound) : overBound;
+                    int rowMin = cur[rowLeft - 1];
+
+                    const char c = frontCodedWord[depth - 1];
+
+                    for (int j = rowLeft; j <= rowRight; ++j)
+                    {
+                        int val = prev[j - 1] + (patStr[j - 1] != c);
+                        val = min(val, min(prev[j], cur[j - 1]) + 1);
+
+                        cur[j] = min(val, overBound);
+                        rowMin = min(rowMin, cur[j]);
+                    }
+
+                    // The cell just right of the strip is read as the upper neighbor in the next row.
+                    if (rowRight < size)
+                    {
+                        cur[rowRight + 1] = overBound;
+                    }
+
+                    validDepth = depth;
+
+                    if (rowMin > k)
+                    {
+                        deadDepth = depth;
+                        break;
+                    }
+                }
+
+                if (isCandidate and deadDepth == noDepth and frontCodedRows[curSize * rowSize + patSize] <= k)
+                {
+                    // Make sure that the number of results is returned in order to
+                    // prevent the compiler from overoptimizing unused results.
+                    nMatches += 1;
+                }
+            }
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+template<int K, bool Osa>
+int Fingerprints<FING_T>::testWordsLeven(QueryContext &context, const vector<string> &patterns, int k) const
+{
+    int nMatches = 0;
+
+    for (const string &pattern : patterns) 
+    {
+        size_t patSize;
+        const char *patStr = normalizePattern(context, pattern, patSize);
+
+        if (Osa)
+        {
+            setOsaPattern(context, patStr, patSize);
+        }
+
+        // We omit sizes which differ by more than k.
+        int left = static_cast<int>(patSize) - k;
+        size_t right = patSize + k;
+
+        const size_t start = (left < 1) ? 1u : left;
+        const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+
+        for (size_t curSize = start; curSize <= stop; ++curSize)
+        {
+            char *curEntry = fingArrayEntries[curSize];
+            char *nextEntry = fingArrayEntries[curSize + 1];
+
+            const size_t entryStride = calcEntryStride(curSize);
+            const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+            while (curEntry != nextEntry)
+            {
+                const char *word = curEntry + wordOffset;
+
+                if (Osa ? isOsaAtMostK(context, patStr, patSize, word, curSize, k)
+                    : isLevAtMost<K>(context, patStr, patSize, word, curSize, k))
+                {
+                    // Make sure that the number of results is returned in order to
+                    // prevent the compiler from overoptimizing unused results.
+                    nMatches += 1;
+                }
+
+                curEntry += entryStride;
+            }
+        }
+
+        if (Osa)
+        {
+            clearOsaPattern(context, patStr, patSize);
+        }
+    }
+
+    return nMatches;
+}
+
+template<typename FING_T>
+float Fingerprints<FING_T>::testRejectionHamming(const vector<string> &patterns, int k)
+{
+    int nRejected = 0, nTested = 0;
+    const uint64_t *acceptBitmap = getAcceptBitmap(k);
+
+    for (const string &pattern : patterns) 
+    {
+        size_t curSize;
+        const char *patStr = normalizePattern(defaultContext, pattern, curSize);
+        const FING_T patFingerprint = calcFingerprintFun(patStr, curSize);
+
+        char *curEntry = fingArrayEntries[curSize];
+        char *nextEntry = fingArrayEntries[curSize + 1];
+
+        const size_t entryStride = calcEntryStride(curSize);
+
+        while (curEntry != nextEntry)
+        {
+            if (not isAccepted(acceptBitmap, patFingerprint ^ *(reinterpret_cast<FING_T *>(curEntry))))
+            {
+                nRejected += 1;
+            }
+
+            curEntry += entryStride;
+        
+            nTested += 1;
+        }
+    }
+
+    if (nTested == 0)
+    {
+        return 0.0f;
+    }
+
+    return static_cast<float>(nRejected) / nTested;
+}
+
+template<typename FING_T>
+float Fingerprints<FING_T>::testRejectionLeven(const vector<string> &patterns, int k)
+{
+    int nRejected = 0, nTested = 0;
+
+    for (const string &pattern : patterns) 
+    {
+        size_t patSize;
+        const char *patStr = normalizePattern(defaultContext, pattern, patSize);
+        const FING_T patFingerprint = calcFingerprintFun(patStr, patSize);
+
+        int left = static_cast<int>(patSize) - k;
+        size_t right = patSize + k;
+
+        const size_t start = (left < 1) ? 1u : left;
+        const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+
+        for (size_t curSize = start; curSize <= stop; ++curSize)
+        {
+            const size_t lenDiff = (curSize > patSize) ? curSize - patSize : patSize - curSize;
+            const uint64_t *acceptBitmap = getAcceptBitmap(k, lenDiff);
+
+            if (frontCodedOnly)
+            {
+                forEachFrontCodedWord(curSize, defaultContext.frontCodedWord.data(), [&](FING_T fingerprint, const char *) {
+                    nRejected += not isAccepted(acceptBitmap, patFingerprint ^ fingerprint);
+                    nTested += 1;
+                });
+
+                continue;
+            }
+
+            char *curEntry = fingArrayEntries[curSize];
+            char *nextEntry = fingArrayEntries[curSize + 1];
+
+            const size_t entryStride = calcEntryStride(curSize);
+
+            while (curEntry != nextEntry)
+            {
+                if (not isAccepted(acceptBitmap, patFingerprint ^ *(reinterpret_cast<FING_T *>(curEntry))))
+                {
+                    nRejected += 1;
+                }
+
+                curEntry += entryStride;
+            
+                nTested += 1;
+            }
+        }
+    }
+
+    if (nTested == 0)
+    {
+        return 0.0f;
+    }
+
+    return static_cast<float>(nRejected) / nTested;
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::setProcessedWords(QueryContext &context, const vector<string> &patterns, int k, Plan plan) const
+{
+    if (plan == Plan::ExactHash)
+    {
+        size_t nCompared = 0;
+
+        for (const string &pattern : patterns)
+        {
+            size_t patSize;
+            const char *patStr = normalizePattern(context, pattern, patSize);
+
+            probeExactHash(patStr, patSize, nCompared, &context.processedWords);
+        }
+    }
+    else if (plan == Plan::DeletionIndex or plan == Plan::PartitionIndex)
+    {
+        const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+        for (const string &pattern : patterns)
+        {
+            size_t patSize;
+            const char *patStr = normalizePattern(context, pattern, patSize);
+
+            collectCandidates(context, patStr, patSize, k, plan);
+
+            for (const Candidate &candidate : context.candidates)
+            {
+                context.processedWords.push_back(string(candidate.entry + wordOffset, candidate.size));
+            }
+        }
+    }
+    else if (useHamming)
+    {
+        for (const string &pattern : patterns) 
+        {
+            size_t curSize;
+            normalizePattern(context, pattern, curSize);
+
+            char *curEntry = fingArrayEntries[curSize];
+            char *nextEntry = fingArrayEntries[curSize + 1];
+
+            const size_t entryStride = calcEntryStride(curSize);
+            const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+            while (curEntry != nextEntry)
+            {
+                context.processedWords.push_back(string(curEntry + wordOffset, curSize));
+                curEntry += entryStride;
+            }
+        }
+    }
+    else
+    {
+        for (const string &pattern : patterns) 
+        {
+            size_t patSize;
+            normalizePattern(context, pattern, patSize);
+
+            // We omit sizes which differ by more than k.
+            int left = static_cast<int>(patSize) - k;
+            size_t right = patSize + k;
+
+            const size_t start = (left < 1) ? 1u : left;
+            const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+
+            for (size_t curSize = start; curSize <= stop; ++curSize)
+            {
+                if (frontCodedOnly)
+                {
+                    forEachFrontCodedWord(curSize, context.frontCodedWord.data(), [&](FING_T, const char *word) {
+                        context.processedWords.push_back(string(word, curSize));
+                    });
+
+                    continue;
+                }
+
+                char *curEntry = fingArrayEntries[curSize];
+                char *nextEntry = fingArrayEntries[curSize + 1];
+
+                const size_t entryStride = calcEntryStride(curSize);
+                const size_t wordOffset = useFingerprints ? sizeof(FING_T) : 0;
+
+                while (curEntry != nextEntry)
+                {
+                    context.processedWords.push_back(string(curEntry + wordOffset, curSize));
+                    curEntry += entryStride;
+                }
+            }   
+        }
+    }
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::setProcessedWordsCount(QueryContext &context, const vector<string> &patterns, int k, Plan plan) const
+{
+    if (plan == Plan::ExactHash)
+    {
+        for (const string &pattern : patterns)
+        {
+            size_t patSize;
+            const char *patStr = normalizePattern(context, pattern, patSize);
+
+            probeExactHash(patStr, patSize, context.processedWordsCount);
+        }
+    }
+    else if (plan == Plan::DeletionIndex or plan == Plan::PartitionIndex)
+    {
+        for (const string &pattern : patterns)
+        {
+            size_t patSize;
+            const char *patStr = normalizePattern(context, pattern, patSize);
+
+            collectCandidates(context, patStr, patSize, k, plan);
+            context.processedWordsCount += context.candidates.size();
+        }
+    }
+    else if (useHamming)
+    {
+        for (const string &pattern : patterns) 
+        {
+            size_t curSize;
+            normalizePattern(context, pattern, curSize);
+
+            context.processedWordsCount += getBucketSize(curSize);
+        }
+    }
+    else
+    {
+        for (const string &pattern : patterns) 
+        {
+            size_t patSize;
+            normalizePattern(context, pattern, patSize);
+
+            // We omit sizes which differ by more than k.
+            int left = static_cast<int>(patSize) - k;
+            size_t right = patSize + k;
+
+            const size_t start = (left < 1) ? 1u : left;
+            const size_t stop = (right > maxWordSize) ? maxWordSize : right;
+
+            for (size_t curSize = start; curSize <= stop; ++curSize)
+            {
+                context.processedWordsCount += getBucketSize(curSize);
+            }   
+        }
+    }
+}
+
+template<typename FING_T>
+FING_T Fingerprints<FING_T>::calcFingerprintOcc(const char *str, size_t size) const
+{
+    assert(charsMap != nullptr);
+
+    FING_T fing = 0x0U;
+    FING_T mask = 0x1U;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        unsigned char index = charsMap[static_cast<unsigned char>(str[i])];
+        assert(index < sizeof(FING_T) * 8 or index == noCharIndex);
+
+        if (index != noCharIndex)
+        {
+            fing |= (mask << index);
+        }
+    }
+
+    return fing;
+}
+
+template<typename FING_T>
+FING_T Fingerprints<FING_T>::calcFingerprintCount(const char *str, size_t size) const
+{
+    assert(charsMap != nullptr);
+    
+    // 2 byte == 16 bit fingerprints, 2 bits per count -> counts for 8 letters.
+    assert(sizeof(FING_T) == 2);
+
+    FING_T fing = 0x0U;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        FING_T mask = 0x1U;
+        unsigned char index = charsMap[static_cast<unsigned char>(str[i])];
 
         // Index < size of fingerprint in bits / 2 (count fingerprint -> 2 bits per character).
         assert(index < sizeof(FING_T) * 4 or index == noCharIndex);
 
-        if (index != noCharIndex)
+        if (index != noCharIndex)
+        {
+            // In a count fingerprint we use two bits per index, hence we shift the mask twice in order
+            // to set it to the relevant position.
+            mask <<= index;
+            mask <<= index;
+
+            // If right bit is 0, we set it to 1 (0->1 or 2->3).
+            if (not (fing & mask))
+            {
+                fing |= mask;
+            }
+            else // Otherwise either 1->2 or 2->3.
+            {
+                mask <<= 1;
+
+                if (fing & mask) // 2 -> 3 or 3 -> 3 (no change)
+                {
+                    fing |= (mask >> 1);
+                }
+                else // 1 -> 2
+                {
+                    fing |= mask;
+                    fing &= ~(mask >> 1);
+                }
+            }
+        }
+    }
+
+    return fing;
+}
+
+template<typename FING_T>
+FING_T Fingerprints<FING_T>::calcFingerprintPos(const char *str, size_t size) const
+{
+    assert(charList != nullptr);
+
+    // 2 byte == 16 bit fingerprints, 3 bits per position -> positions for 5 letters.
+    // 1 bit (the last one) is unused for positions and it is used for storing the occurrence of one additional letter.
+    assert(sizeof(FING_T) == 2);
+
+    FING_T fing = 0x0U;
+
+    // We iterate excluding the last occurrence letter.
+    for (size_t i = 0; i < 5; ++i)
+    {
+        // 0-based index == position of the first (leftmost) occurrence, 
+        // 0b111 indicates position >= 6 or no match.
+        size_t index = 0b111U;
+        size_t stop = min(size, index);
+
+        // We look for the first position at the defined index.
+        for (size_t iC = 0; iC < stop; ++iC)
+        {
+            if (str[iC] == charList[i])
+            {
+                index = iC;
+                break;
+            }
+        }
+        
+        // We encode this position in the fingerprint.
+        fing |= (static_cast<FING_T>(index) << (i * nBitsPerPos));
+    }
+
+    // Finally we encode the last occurrence bit.
+    const char occChar = charList[5];
+
+    for (size_t iC = 0; iC < size; ++iC)
+    {
+        if (str[iC] == occChar)
+        {
+            fing |= (0x1U << 15);
+            return fing;
+        }
+    }
+
+    return fing;
+}
+
+template<typename FING_T>
+FING_T Fingerprints<FING_T>::calcFingerprintOccHalved(const char *str, size_t size) const
+{
+    assert(charsMap != nullptr);
+
+    FING_T fing = 0x0U;
+    FING_T mask = 0x1U;
+
+    const size_t mid = size / 2;
+
+    for (size_t i = 0; i < mid; ++i)
+    {
+        unsigned char index = charsMap[static_cast<unsigned char>(str[i])];
+        assert(index == noCharIndex or index < sizeof(FING_T) * 8);
+
+        if (index != noCharIndex)
+        {
+            fing |= (mask << index);
+        }
+    }
+
+    for (size_t i = mid; i < size; ++i)
+    {
+        unsigned char index = charsMap[static_cast<unsigned char>(str[i])];
+        assert(index == noCharIndex or (index + 1U) < sizeof(FING_T) * 8);
+
+        if (index != noCharIndex)
+        {
+            index += 1; // Second half
+            fing |= (mask << index);
+        }
+    }
+
+    return fing;
+}
+
+template<typename FING_T>
+FING_T Fingerprints<FING_T>::calcFingerprintQGram(const char *str, size_t size) const
+{
+    constexpr size_t fingSizeBits = sizeof(FING_T) * 8;
+
+    FING_T fing = 0x0U;
+    FING_T mask = 0x1U;
+
+    for (size_t i = 0; i + qgramSize <= size; ++i)
+    {
+        uint32_t gram = 0;
+
+        for (size_t iC = 0; iC < qgramSize; ++iC)
+        {
+            gram = (gram << 8) | static_cast<unsigned char>(str[i + iC]);
+        }
+
+        // Multiplicative hashing, the high bits are mixed best.
+        const size_t index = (static_cast<uint32_t>(gram * 2654435761U) >> 24) % fingSizeBits;
+
+        // Long strings have many more grams than there are bits, so setting bits would saturate the fingerprint.
+        // Each bit stores the parity of the number of grams hashed to it instead.
+        fing ^= (mask << index);
+    }
+
+    return fing;
+}
+
+template<typename FING_T>
+unsigned int Fingerprints<FING_T>::calcHammingWeight(unsigned int n)
+{
+    return bitset<8 * sizeof(FING_T)>(n).count();
+}
+
+template<typename FING_T>
+unsigned char Fingerprints<FING_T>::calcNErrors(FING_T f1, FING_T f2) const
+{
+    unsigned char setBits = nMismatchesLUT[f1 ^ f2];
+
+    assert(setBits >= 0 and setBits <= sizeof(FING_T) * 8);
+    return nErrorsLUT[setBits];
+}
+
+template<typename FING_T>
+unsigned char Fingerprints<FING_T>::calcLevNErrors(size_t nMismatches, size_t lenDiff) const
+{
+    // Any edit script consists of at least lenDiff insertions and deletions, and their count has the same parity
+    // as lenDiff. Each of them accounts for at most indelNMismatches mismatches and each substitution
+    // for at most subNMismatches, so we look for the cheapest script which covers all mismatches.
+    size_t nMinErrors = numeric_limits<size_t>::max();
+
+    // Swaps are counted as substitutions for the optimal string alignment distance.
+    const size_t nEditNMismatches = useOsa ? max(subNMismatches, transNMismatches) : subNMismatches;
+
+    for (size_t nIndels = lenDiff; ; nIndels += 2)
+    {
+        const size_t nCovered = nIndels * indelNMismatches;
+
+        if (nCovered >= nMismatches)
+        {
+            nMinErrors = min(nMinErrors, nIndels);
+            break;
+        }
+
+        const size_t nSubs = (nMismatches - nCovered + nEditNMismatches - 1) / nEditNMismatches;
+        nMinErrors = min(nMinErrors, nIndels + nSubs);
+    }
+
+    assert(nMinErrors <= numeric_limits<unsigned char>::max());
+    return nMinErrors;
+}
+
+template<typename FING_T>
+const uint64_t *Fingerprints<FING_T>::getAcceptBitmap(int nErrors, size_t lenDiff) const
+{
+    assert(nErrors >= 0 and lenDiff <= static_cast<size_t>(nErrors));
+    assert(lenDiff == 0 or not useHamming);
+
+    // Both bounds are at most the number of bits in a fingerprint when sizes differ by at most that many,
+    // and at most half of that when they are equal, hence a single bitmap which accepts everything
+    // is sufficient for larger numbers of errors.
+    if (static_cast<size_t>(nErrors) >= nAcceptBitmaps - 1)
+    {
+        nErrors = nAcceptBitmaps - 1;
+        lenDiff = 0;
+    }
+
+    atomic<uint64_t *> &acceptBitmap = acceptBitmaps[nErrors][lenDiff];
+    const uint64_t *bitmap = acceptBitmap.load(memory_order_acquire);
+
+    if (bitmap == nullptr)
+    {
+        lock_guard<mutex> lock(acceptMutex);
+
+        if (acceptBitmap.load(memory_order_relaxed) == nullptr)
+        {
+            acceptBitmap.store(calcAcceptBitmap(nErrors, lenDiff), memory_order_release);
+        }
+
+        bitmap = acceptBitmap.load(memory_order_relaxed);
+    }
+
+    return bitmap;
+}
+
+template<typename FING_T>
+void Fingerprints<FING_T>::prepareAcceptBitmaps(int nErrors) const
+{
+    const int maxLenDiff = useHamming ? 0 : nErrors;
+
+    for (int lenDiff = 0; lenDiff <= maxLenDiff and lenDiff < static_cast<int>(nAcceptBitmaps); ++lenDiff)
+    {
+        getAcceptBitmap(nErrors, lenDiff);
+    }
+}
+
+template<typename FING_T>
+const vector<FING_T> &Fingerprints<FING_T>::getAcceptedXors(int nErrors, size_t lenDiff) const
+{
+    // Capped as in getAcceptBitmap.
+    if (static_cast<size_t>(nErrors) >= nAcceptBitmaps - 1)
+    {
+        nErrors = nAcceptBitmaps - 1;
+        lenDiff = 0;
+    }
+
+    atomic<vector<FING_T> *> &acceptedXorsSlot = acceptedXors[nErrors][lenDiff];
+    const vector<FING_T> *xors = acceptedXorsSlot.load(memory_order_acquire);
+
+    if (xors == nullptr)
+    {
+        // The bitmap is taken before locking, since getAcceptBitmap locks as well.
+        const uint64_t *acceptBitmap = getAcceptBitmap(nErrors, lenDiff);
+        lock_guard<mutex> lock(acceptMutex);
+
+        if (acceptedXorsSlot.load(memory_order_relaxed) == nullptr)
         {
-            // In a count fingerprint we use two bits per index, hence we shift the mask twice in order
-            // to set it to the relevant position.
-            mask <<= index;
-            mask <<= index;
+            vector<FING_T> *newXors = new vector<FING_T>();
 
-            // If right bit is 0, we set it to 1 (0->1 or 2->3).
-            if (not (fing & mask))
-            {
-                fing |= mask;
-            }
-            else // Otherwise either 1->2 or 2->3.
+            for (size_t x = 0; x < nMismatchesLUTSize(); ++x)
             {
-                mask <<= 1;
-
-                if (fing & mask) // 2 -> 3 or 3 -> 3 (no change)
+                if (isAccepted(acceptBitmap, x))
                 {
-                    fing |= (mask >> 1);
-                }
-                else // 1 -> 2
-                {
-                    fing |= mask;
-                    fing &= ~(mask >> 1);
+                    newXors->push_back(x);
                 }
             }
+
+            acceptedXorsSlot.store(newXors, memory_order_release);
         }
+
+        xors = acceptedXorsSlot.load(memory_order_relaxed);
     }
 
-    return fing;
+    return *xors;
 }
 
 template<typename FING_T>
-FING_T Fingerprints<FING_T>::calcFingerprintPos(const char *str, size_t size) const
+size_t Fingerprints<FING_T>::getMaxAcceptedWeight(int nErrors, size_t lenDiff) const
 {
-    assert(charList != nullptr);
-
-    // 2 byte == 16 bit fingerprints, 3 bits per position -> positions for 5 letters.
-    // 1 bit (the last one) is unused for positions and it is used for storing the occurrence of one additional letter.
-    assert(sizeof(FING_T) == 2);
+    // Capped as in getAcceptBitmap.
+    if (static_cast<size_t>(nErrors) >= nAcceptBitmaps - 1)
+    {
+        nErrors = nAcceptBitmaps - 1;
+        lenDiff = 0;
+    }
 
-    FING_T fing = 0x0U;
+    // Concurrent first uses calculate the same value, hence it is simply stored by each of them.
+    atomic<int> &maxAcceptedWeight = maxAcceptedWeights[nErrors][lenDiff];
+    int maxWeight = maxAcceptedWeight.load(memory_order_relaxed);
 
-    // We iterate excluding the last occurrence letter.
-    for (size_t i = 0; i < 5; ++i)
+    if (maxWeight < 0)
     {
-        // 0-based index == position of the first (leftmost) occurrence, 
-        // 0b111 indicates position >= 6 or no match.
-        size_t index = 0b111U;
-        size_t stop = min(size, index);
+        const uint64_t *acceptBitmap = getAcceptBitmap(nErrors, lenDiff);
 
-        // We look for the first position at the defined index.
-        for (size_t iC = 0; iC < stop; ++iC)
+        for (size_t x = 0; x < nMismatchesLUTSize(); ++x)
         {
-            if (str[iC] == charList[i])
+            if (isAccepted(acceptBitmap, x))
             {
-                index = iC;
-                break;
+                maxWeight = max(maxWeight, static_cast<int>(calcHammingWeight(x)));
             }
         }
-        
-        // We encode this position in the fingerprint.
-        fing |= (static_cast<FING_T>(index) << (i * nBitsPerPos));
+
+        maxAcceptedWeight.store(maxWeight, memory_order_relaxed);
     }
 
-    // Finally we encode the last occurrence bit.
-    const char occChar = charList[5];
+    return maxWeight;
+}
 
-    for (size_t iC = 0; iC < size; ++iC)
+template<typename FING_T>
+uint64_t *Fingerprints<FING_T>::calcAcceptBitmap(size_t nErrors, size_t lenDiff) const
+{
+    assert(nMismatchesLUT != nullptr);
+    uint64_t *bitmap = new uint64_t[acceptBitmapSize()]();
+
+    for (size_t x = 0; x < nMismatchesLUTSize(); ++x)
     {
-        if (str[iC] == occChar)
+        const size_t nMismatches = nMismatchesLUT[x];
+        const size_t nMinErrors = useHamming ? nErrorsLUT[nMismatches] : calcLevNErrors(nMismatches, lenDiff);
+
+        if (nMinErrors <= nErrors)
         {
-            fing |= (0x1U << 15);
-            return fing;
+            bitmap[x / 64] |= (0x1ULL << (x % 64));
         }
     }
 
-    return fing;
+    return bitmap;
 }
 
 template<typename FING_T>
-FING_T Fingerprints<FING_T>::calcFingerprintOccHalved(const char *str, size_t size) const
+bool Fingerprints<FING_T>::isHamAtMostK(const char *str1, const char *str2, const size_t size, const int k)
 {
-    assert(charsMap != nullptr);
+    // With compiler optimizations, this version is faster than any bitwise/avx/sse magic (tested).
+    int nErrors = 0;
 
-    FING_T fing = 0x0U;
-    FING_T mask = 0x1U;
+    for (size_t i = 0; i < size; ++i)
+    {
+        assert(str1[i] != '\0' and str2[i] != '\0');
 
-    const size_t mid = size / 2;
+        if (str1[i] != str2[i])
+        {
+            if (++nErrors > k)
+            {
+                return false;
+            }
+        }
+    }
 
-    for (size_t i = 0; i < mid; ++i)
+    return true;
+}
+
+template<typename FING_T>
+template<int K>
+bool Fingerprints<FING_T>::isHamAtMost(const char *str1, const char *str2, const size_t size, const int k)
+{
+    assert(K == anyK or K == k);
+
+    if (K == anyK)
     {
-        unsigned char index = charsMap[static_cast<size_t>(str[i])];
-        assert(index == noCharIndex or index < sizeof(FING_T) * 8);
+        return isHamAtMostK(str1, str2, size, k);
+    }
+    // Same as isHamAtMostK, but the compiler knows the bound, for K = 0 this exits on the first mismatch.
+    // An inlined loop turned out faster than calling memcmp for dictionary words, which are short.
+    int nErrors = 0;
 
-        if (index != noCharIndex)
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (str1[i] != str2[i])
         {
-            fing |= (mask << index);
+            if (++nErrors > K)
+            {
+                return false;
+            }
         }
     }
 
-    for (size_t i = mid; i < size; ++i)
+    return true;
+}
+
+template<typename FING_T>
+template<int K>
+bool Fingerprints<FING_T>::isLevAtMost(QueryContext &context, const char *str1, const size_t size1, const char *str2,
+    const size_t size2, const int k)
+{
+    assert(K == anyK or K == k);
+
+    if (K == 0)
     {
-        unsigned char index = charsMap[static_cast<size_t>(str[i])];
-        assert(index == noCharIndex or (index + 1U) < sizeof(FING_T) * 8);
+        return size1 == size2 and isHamAtMost<0>(str1, str2, size1, 0);
+    }
+    if (K == 1)
+    {
+        return isLevAtMostOne(str1, size1, str2, size2);
+    }
+    if (K == 2 or K == 3)
+    {
+        // The template argument is clamped only to keep the other instantiations valid.
+        return isLevAtMostKBand<(K == 3) ? 3 : 2>(str1, size1, str2, size2);
+    }
 
-        if (index != noCharIndex)
+    return isLevAtMostK(context, str1, size1, str2, size2, k);
+}
+
+template<typename FING_T>
+bool Fingerprints<FING_T>::isLevAtMostOne(const char *str1, size_t size1, const char *str2, size_t size2)
+{
+    // We make sure that str1 is the longer one.
+    if (size1 < size2)
+    {
+        swap(str1, str2);
+        swap(size1, size2);
+    }
+
+    if (size1 - size2 > 1)
+    {
+        return false;
+    }
+
+    size_t prefix = 0;
+
+    while (prefix < size2 and str1[prefix] == str2[prefix])
+    {
+        prefix += 1;
+    }
+
+    // Either equal strings or a single character appended to str2.
+    if (prefix == size2)
+    {
+        return true;
+    }
+
+    // The common suffix may not overlap with the common prefix.
+    size_t suffix = 0;
+
+    while (suffix < size2 - prefix and str1[size1 - 1 - suffix] == str2[size2 - 1 - suffix])
+    {
+        suffix += 1;
+    }
+
+    // For equal sizes, everything but a single substitution has to match.
+    // Otherwise, str2 has to be str1 with a single character deleted.
+    if (size1 == size2)
+    {
+        return prefix + suffix + 1 == size2;
+    }
+
+    return prefix + suffix == size2;
+}
+
+// Calculates the 2K + 1 band diagonal-wise with the band width known at compile time,
+// cells holding values greater than K are capped at K + 1.
+template<typename FING_T>
+template<int K>
+bool Fingerprints<FING_T>::isLevAtMostKBand(const char *str1, const size_t size1, const char *str2, const size_t size2)
+{
+    static_assert(K >= 1, "band kernels are used only for K >= 1");
+
+    constexpr int width = 2 * K + 1;
+    constexpr int capVal = K + 1;
+
+    const int size1s = size1;
+    const int size2s = size2;
+
+    if (abs(size1s - size2s) > K)
+    {
+        return false;
+    }
+
+    // Band index d corresponds to column j = i + d - K in row i.
+    int prevRow[width], curRow[width];
+
+    for (int d = 0; d < width; ++d)
+    {
+        const int j = d - K;
+        prevRow[d] = (j < 0 or j > size1s) ? capVal : j;
+    }
+
+    for (int i = 1; i <= size2s; ++i)
+    {
+        const char c = str2[i - 1];
+        int rowMin = capVal;
+
+        for (int d = 0; d < width; ++d)
         {
-            index += 1; // Second half
-            fing |= (mask << index);
+            const int j = i + d - K;
+            int val;
+
+            if (j < 0 or j > size1s)
+            {
+                val = capVal;
+            }
+            else if (j == 0)
+            {
+                val = min(i, capVal);
+            }
+            else
+            {
+                val = prevRow[d] + (str1[j - 1] != c);
+
+                if (d + 1 < width)
+                {
+                    val = min(val, prevRow[d + 1] + 1);
+                }
+                if (d > 0)
+                {
+                    val = min(val, curRow[d - 1] + 1);
+                }
+
+                val = min(val, capVal);
+            }
+
+            curRow[d] = val;
+            rowMin = min(rowMin, val);
+        }
+
+        if (rowMin > K)
+        {
+            return false;
+        }
+
+        for (int d = 0; d < width; ++d)
+        {
+            prevRow[d] = curRow[d];
         }
     }
 
-    return fing;
+    return prevRow[size1s - size2s + K] <= K;
 }
 
 template<typename FING_T>
-unsigned int Fingerprints<FING_T>::calcHammingWeight(unsigned int n)
+void Fingerprints<FING_T>::setOsaPattern(QueryContext &context, const char *pattern, size_t size)
 {
-    return bitset<8 * sizeof(FING_T)>(n).count();
+    const size_t stop = (size > maxOsaPatternSize) ? maxOsaPatternSize : size;
+
+    for (size_t i = 0; i < stop; ++i)
+    {
+        context.osaPeq[static_cast<unsigned char>(pattern[i])] |= (0x1ULL << i);
+    }
 }
 
 template<typename FING_T>
-unsigned char Fingerprints<FING_T>::calcNErrors(FING_T f1, FING_T f2) const
+void Fingerprints<FING_T>::clearOsaPattern(QueryContext &context, const char *pattern, size_t size)
 {
-    unsigned char setBits = nMismatchesLUT[f1 ^ f2];
+    const size_t stop = (size > maxOsaPatternSize) ? maxOsaPatternSize : size;
 
-    assert(setBits >= 0 and setBits <= sizeof(FING_T) * 8);
-    return nErrorsLUT[setBits];
+    for (size_t i = 0; i < stop; ++i)
+    {
+        context.osaPeq[static_cast<unsigned char>(pattern[i])] = 0;
+    }
 }
 
+// Myers' bit-parallel algorithm extended with transpositions (H. Hyyro, "A bit-vector algorithm for computing
+// Levenshtein and Damerau edit distances", 2003). Bit i of the vertical deltas corresponds to pattern position i,
+// and the last row of the DP matrix (the full pattern) is tracked in score.
 template<typename FING_T>
-bool Fingerprints<FING_T>::isHamAtMostK(const char *str1, const char *str2, const size_t size, const int k)
+bool Fingerprints<FING_T>::isOsaAtMostK(QueryContext &context, const char *pattern, const size_t patSize, const char *str,
+    const size_t size, const int k)
 {
-    // With compiler optimizations, this version is faster than any bitwise/avx/sse magic (tested).
-    int nErrors = 0;
+    if (patSize > maxOsaPatternSize)
+    {
+        return isOsaAtMostKDP(context, pattern, patSize, str, size, k);
+    }
+    if (patSize == 0)
+    {
+        return static_cast<int>(size) <= k;
+    }
+
+    const uint64_t lastBit = 0x1ULL << (patSize - 1);
+
+    uint64_t vp = (patSize == maxOsaPatternSize) ? ~0x0ULL : (lastBit << 1) - 1;
+    uint64_t vn = 0x0ULL;
+    uint64_t d0 = 0x0ULL;
+    uint64_t pmPrev = 0x0ULL;
+
+    int score = patSize;
+    int nLeft = size;
 
     for (size_t i = 0; i < size; ++i)
     {
-        assert(str1[i] != '\0' and str2[i] != '\0');
+        const uint64_t pm = context.osaPeq[static_cast<unsigned char>(str[i])];
 
-        if (str1[i] != str2[i])
+        // Diagonal zero deltas resulting from swapping the current and the previous character.
+        const uint64_t tr = (((~d0) & pm) << 1) & pmPrev;
+
+        d0 = (((pm & vp) + vp) ^ vp) | pm | vn | tr;
+
+        uint64_t hp = vn | ~(d0 | vp);
+        uint64_t hn = d0 & vp;
+
+        if (hp & lastBit)
         {
-            if (++nErrors > k)
+            score += 1;
+        }
+        else if (hn & lastBit)
+        {
+            score -= 1;
+        }
+
+        // The first row of the matrix is 0, 1, 2, ..., hence the positive horizontal delta shifted in.
+        hp = (hp << 1) | 0x1ULL;
+        hn <<= 1;
+
+        vp = hn | ~(d0 | hp);
+        vn = hp & d0;
+
+        pmPrev = pm;
+        nLeft -= 1;
+
+        // Each remaining character can decrease the score by at most 1.
+        if (score - nLeft > k)
+        {
+            return false;
+        }
+    }
+
+    return score <= k;
+}
+
+template<typename FING_T>
+bool Fingerprints<FING_T>::isOsaAtMostKDP(QueryContext &context, const char *str1, const size_t size1, const char *str2,
+    const size_t size2, const int k)
+{
+    const int size1s = size1;
+    const int size2s = size2;
+
+    int *&levV0 = context.levV0;
+    int *&levV1 = context.levV1;
+    int *&levV2 = context.levV2;
+
+    if (abs(size1s - size2s) > k)
+    {
+        return false;
+    }
+
+    // levV2 holds row i - 2, levV0 row i - 1, and levV1 the current row i.
+    for (int iCur = 0; iCur <= size1s; ++iCur)
+    {
+        levV0[iCur] = iCur;
+    }
+
+    int prevMin = 0;
+
+    for (int i = 1; i <= size2s; ++i)
+    {
+        const char c = str2[i - 1];
+
+        levV1[0] = i;
+        int curMin = i;
+
+        for (int iCur = 1; iCur <= size1s; ++iCur)
+        {
+            const char curC = str1[iCur - 1];
+            int val = min(min(levV0[iCur], levV1[iCur - 1]) + 1, levV0[iCur - 1] + (curC != c));
+
+            if (i > 1 and iCur > 1 and curC == str2[i - 2] and str1[iCur - 2] == c)
             {
-                return false;
+                val = min(val, levV2[iCur - 2] + 1);
             }
+
+            levV1[iCur] = val;
+            curMin = min(curMin, val);
+        }
+
+        // Any path crosses one of two consecutive rows, since a swap skips a single row.
+        if (curMin > k and prevMin > k)
+        {
+            return false;
         }
+
+        prevMin = curMin;
+
+        int *temp = levV2;
+        levV2 = levV0;
+        levV0 = levV1;
+        levV1 = temp;
     }
 
-    return true;
+    return levV0[size1s] <= k;
 }
 
 // Calculates only the 2k + 1 strip since we are only interested in distance <= k.
 // Attribution: based on: https://commons.apache.org/sandbox/commons-text/jacoco/org.apache.commons.text.similarity/LevenshteinDistance.java.html
 template<typename FING_T>
-bool Fingerprints<FING_T>::isLevAtMostK(const char *str1, const size_t size1, const char *str2, const size_t size2, const int k)
+bool Fingerprints<FING_T>::isLevAtMostK(QueryContext &context, const char *str1, const size_t size1, const char *str2,
+    const size_t size2, const int k)
 {
     const int size1s = size1;
     const int size2s = size2;
 
+    int *&levV0 = context.levV0;
+    int *&levV1 = context.levV1;
+
     if (size1s == 0)
     {
         return size2s <= k;
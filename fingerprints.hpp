@@ -1,10 +1,20 @@
 #ifndef FINGERPRINTS_HPP
 #define FINGERPRINTS_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "hash_postings.hpp"
+#include "index_memory.hpp"
+#include "normalization.hpp"
+#include "utf8.hpp"
+
 #ifndef FINGERPRINTS_WHITEBOX
 #define FINGERPRINTS_WHITEBOX
 #endif
@@ -12,17 +22,180 @@
 namespace fingerprints
 {
 
+/** Options controlling the layout of the index built by Fingerprints::preprocess. */
+struct IndexOptions
+{
+    /** Each dictionary entry (fingerprint and word) is padded to a multiple of this many bytes,
+     * so that all entries in a word size bracket have the same aligned stride. Must be a power of 2 up to 16, 1 = packed. */
+    size_t entryAlignment = 1;
+
+    /** Memory used for the dictionary array, huge pages fall back to the heap. */
+    IndexMemory::Type memoryType = IndexMemory::Type::Default;
+    /** If true, the dictionary array, the mismatches lookup table, and the arrays of all other indexes built
+     * (e.g. the exact hash and the deletion postings) are locked in RAM after construction, and the accept bitmaps
+     * for small k are calculated and locked before the first query. */
+    bool lockMemory = false;
+
+    /** Number of characters in a gram for q-gram fingerprints, 2 (bigrams) or 3 (trigrams). */
+    size_t qgramSize = 2;
+
+    /** If true, an open addressing hash table over the words in each word size bracket is built,
+     * it is used instead of scanning for k = 0 and by Fingerprints::findExact. Queries for k > 0 do not probe it,
+     * since an exact hit is one of the matches which the approximate search finds anyway. */
+    bool exactHash = false;
+
+    /** If not empty, a table of 256 bytes (see Normalization) which maps each byte of the dictionary words when
+     * they are copied into the index and each byte of the patterns before they are fingerprinted and verified. */
+    std::vector<unsigned char> normalizationTable;
+
+    /** If true, the dictionary words and the patterns are treated as UTF-8. Words are decoded once when they are
+     * copied into the index, each code point is stored as a single code unit, hence word sizes, fingerprints,
+     * and distances are all calculated over code points. The normalization table applies to code points below 256.
+     * There are 127 code units for non-ASCII code points, if the dictionary has more distinct ones, the most frequent
+     * keep their own code units and the rest share one (see Fingerprints::getSharedCodePointsCount), hence results
+     * for words with the latter are approximate. */
+    bool utf8 = false;
+
+    /** If non-negative, a symmetric deletion index (as in FastSS and SymSpell) is built, which maps each string
+     * obtained from a dictionary word by deleting at most this many characters back to the word. It is used instead
+     * of scanning for k up to this value (except for k = 0 with the exact hash), so that only the words sharing
+     * a deletion variant with the pattern are verified. At most 4, the index size grows as size^k per word. */
+    int deletionIndexK = -1;
+
+    /** If non-negative, a pigeonhole partition index is built, which splits each dictionary word into k + 1 segments
+     * (2k + 1 for the optimal string alignment distance, where a transposition can break two of them) and maps
+     * each segment to the words having it at its position. A match within k errors leaves at least one segment
+     * intact, shifted by at most k positions for the Levenshtein distances, hence only the words sharing a segment
+     * with the pattern are verified. It is used instead of scanning for k up to this value unless the exact hash
+     * or the deletion index is used, and pays off for long words. At most 8. */
+    int partitionIndexK = -1;
+
+    /** If true, the query planner is calibrated during preprocessing: for each k up to 3, each available plan
+     * (the scans, the exact hash, and the candidate indexes) is timed on a sample of queries made from dictionary words,
+     * which gives its cost per unit of work (a scanned entry, a probed hash or segment). Each query is then answered
+     * with the plan having the lowest estimated cost, larger k always use the plan selected without the planner.
+     * The exact hash is a plan for k = 0 only, callers wanting the exact hits first call Fingerprints::findExact. */
+    bool planner = false;
+
+    /** If true, the entries in each word size bracket are sorted by fingerprint, and runs of entries sharing
+     * a fingerprint are stored as groups. Fingerprint scans then compare each distinct fingerprint once and skip
+     * rejected groups without touching their words. Requires fingerprints. */
+    bool fingerprintGroups = false;
+
+    /** If true, a directory of the distinct fingerprints is built for each large word size bracket, mapping each
+     * fingerprint value to its group. Fingerprint scans then enumerate the fingerprint values which pass
+     * the comparison with the pattern fingerprint and look them up directly, rather than testing every group,
+     * whenever there are fewer such values than groups. Requires fingerprint groups. */
+    bool fingerprintNeighborhood = false;
+
+    /** If true, the entries in each word size bracket are sorted by the popcount of their fingerprints
+     * (and by fingerprint within a popcount, so that fingerprint groups can be built too). Since the popcounts
+     * of two fingerprints differ by at most the popcount of their xor, fingerprint scans skip whole sub-buckets
+     * whose popcount lies too far from the popcount of the pattern fingerprint for any accepted xor.
+     * Requires fingerprints, cannot be combined with the fingerprint neighborhood. */
+    bool popcountBuckets = false;
+
+    /** If true, the words are also stored with the dictionary alphabet mapped to 4-bit codes (at most 15 distinct
+     * chars) or 5-bit codes (at most 31 distinct chars) packed into 64-bit lanes, and scans without fingerprints
+     * compare whole lanes, counting mismatching codes with a few bitwise operations. Hamming distance only. */
+    bool packedWords = false;
+
+    /** If true, the words of each bracket are also stored sorted lexicographically and front coded (each word
+     * stores the size of the prefix shared with the previous word and the rest of its chars). Scans for Levenshtein
+     * distance then walk these words and keep the dynamic programming rows between consecutive words, so that only
+     * the rows after the shared prefix are calculated. Levenshtein distance only, cannot be combined with
+     * fingerprint groups. Unless the exact hash, a candidate index, or popcount buckets are built (they address
+     * the entries of the dictionary array), the dictionary array is released and only the front coded words
+     * are kept, which also takes less memory. */
+    bool frontCoding = false;
+};
+
 template<typename FING_T>
 class Fingerprints
 {
 public:
-    enum class DistanceType { Ham, Lev };
-    enum class FingerprintType { None, Occ, OccHalved, Count, Pos };
+    enum class DistanceType { Ham, Lev, Osa };
+    enum class FingerprintType { None, Occ, OccHalved, Count, Pos, QGram };
     enum class LettersType { Common, Mixed, Rare };
 
-    /** Constructs a fingerprints object for [distanceType], [fingerprintType], and [lettersType].
-     * Consult params.hpp for more information regarding the parameters. */
-    Fingerprints(DistanceType distanceType, FingerprintType fingerprintType, LettersType lettersType);
+    /** Ways of answering a query, a single one is used for all queries unless the planner is used. */
+    enum class Plan { ExactHash, DeletionIndex, PartitionIndex, FingerprintScan, WordScan };
+    static constexpr size_t nPlans = 5;
+
+    /** Scratch space and stats of queries. Queries do not modify the index (after preprocess), hence threads can share
+     * a single index as long as each of them passes its own context. Buffers are allocated when the context is first used
+     * with an index and they are reused by subsequent queries. */
+    class QueryContext
+    {
+    public:
+        QueryContext() = default;
+        QueryContext(const QueryContext &) = delete;
+        QueryContext &operator=(const QueryContext &) = delete;
+        QueryContext(QueryContext &&) = default;
+        QueryContext &operator=(QueryContext &&) = default;
+
+        /** Returns elapsed time during the last test in microseconds. */
+        float getElapsedUs() const { return elapsedUs; }
+        /** Returns a collection of all words processed during a single iteration of the last test. */
+        const std::vector<std::string> &getProcessedWords() const { return processedWords; }
+        /** Returns count of all words processed during a single iteration of the last test. */
+        size_t getProcessedWordsCount() const { return processedWordsCount; }
+        /** Returns the number of patterns answered with [plan] during the last test. */
+        size_t getPlanCount(Plan plan) const { return planCounts[static_cast<size_t>(plan)]; }
+
+    private:
+        friend class Fingerprints<FING_T>;
+
+        /** A word collected from a candidate index for the current pattern, the entry starts as in getEntry. */
+        struct Candidate
+        {
+            const char *entry;
+            size_t size;
+        };
+
+        float elapsedUs = 0.0f;
+        std::vector<std::string> processedWords;
+        size_t processedWordsCount = 0;
+        size_t planCounts[nPlans] = {};
+
+        /** Patterns grouped by the plans chosen for them, and a batch holding the pattern of testPattern. */
+        std::vector<std::string> plannedPatterns[nPlans];
+        std::vector<std::string> singlePattern;
+
+        /** The current pattern mapped through the normalization table or decoded from UTF-8. */
+        std::string normalizedPattern;
+
+        /** Rows of Levenshtein and optimal string alignment distance calculation (the previous, current,
+         * and the one before previous), pointing into levRows. */
+        std::vector<int> levRows;
+        int *levV0 = nullptr;
+        int *levV1 = nullptr;
+        int *levV2 = nullptr;
+
+        /** For each character, a bitmask of its positions in the current pattern, used by isOsaAtMostK. */
+        uint64_t osaPeq[256] = {};
+
+        /** Lanes of the current pattern for packed words. */
+        std::vector<uint64_t> packedPattern;
+        /** Rows of the dynamic programming for front coded words (one for each prefix size) and the current word. */
+        std::vector<int> frontCodedRows;
+        std::vector<char> frontCodedWord;
+
+        /** Word ids are marked with the current stamp when they become candidates for a pattern,
+         * so that each of them is verified once. */
+        std::vector<uint32_t> candidateStamps;
+        uint32_t candidateStamp = 0;
+
+        /** Candidates, variant hashes of the current pattern, and a buffer for each deletion level. */
+        std::vector<Candidate> candidates;
+        std::vector<uint32_t> patternVariantHashes;
+        std::vector<char> deletionBuffers;
+    };
+
+    /** Constructs a fingerprints object for [distanceType], [fingerprintType], and [lettersType],
+     * with index layout set by [indexOptions]. Consult params.hpp for more information regarding the parameters. */
+    Fingerprints(DistanceType distanceType, FingerprintType fingerprintType, LettersType lettersType,
+        const IndexOptions &indexOptions = IndexOptions());
     ~Fingerprints();
 
     /** Constructs an array which stores [words].
@@ -35,6 +208,13 @@ public:
      * Returns the total number of matches. Sets elapsedUs to time elapsed during this matching. */
     int test(const std::vector<std::string> &patterns, int k, int nIter = 1, 
         bool setProcessedWordsCollection = false);
+    /** Same as above, but the scratch space and the stats of the test are kept in [context] instead of this object,
+     * which is only read, so that concurrent tests with separate contexts are safe. */
+    int test(QueryContext &context, const std::vector<std::string> &patterns, int k, int nIter = 1,
+        bool setProcessedWordsCollection = false) const;
+    /** Performs approximate matching for a single [pattern] of [size] chars and [k] errors using [context], without
+     * setting its stats. Returns the number of matches, patterns longer than the longest storable word have none. */
+    int testPattern(QueryContext &context, const char *pattern, size_t size, int k) const;
 
     /** Tests [patterns] for [k] errors using fingerprints.
      * Returns the fraction of words which were rejected by fingerprints. */
@@ -44,9 +224,68 @@ public:
     float getElapsedUs() const { return elapsedUs; }
     
     /** Returns a collection of all words processed during a single test iteration. */
-    std::vector<std::string> getProcessedWords() const { return processedWords; }
+    std::vector<std::string> getProcessedWords() const { return defaultContext.processedWords; }
     /** Returns count of all words processed during a single test iteration. */
-    size_t getProcessedWordsCount() const { return processedWordsCount; }
+    size_t getProcessedWordsCount() const { return defaultContext.processedWordsCount; }
+
+    /** Returns the number of bytes between consecutive entries in the bracket for words of [wordSize]. */
+    size_t calcEntryStride(size_t wordSize) const;
+    /** Returns the number of words stored in the bracket for words of [wordSize]. */
+    size_t getBucketSize(size_t wordSize) const;
+    /** Returns a pointer to entry [iEntry] in the bracket for words of [wordSize], the entry starts with
+     * the fingerprint if fingerprints are used and with the word otherwise. */
+    const char *getEntry(size_t wordSize, size_t iEntry) const;
+
+    /** Returns a pointer to the word in the dictionary array which is equal to [pattern], nullptr if there is none.
+     * Uses the exact hash table if it was built, otherwise scans the bracket for the pattern size.
+     * Useful as a first step before approximate search when most queries are expected to match exactly.
+     * Throws logic_error if only the front coded words are stored (see IndexOptions::frontCoding). */
+    const char *findExact(const std::string &pattern) const;
+    /** Returns the size of the exact hash table in bytes, 0 if it was not built. */
+    size_t getExactHashSizeB() const { return exactHashSize * sizeof(uint32_t); }
+
+    /** Returns the size of the deletion index in bytes, 0 if it was not built. */
+    size_t getDeletionIndexSizeB() const;
+    /** Returns the number of (deletion variant, word) pairs stored in the deletion index. */
+    size_t getDeletionPostingsCount() const { return deletionPostings.getSize(); }
+    /** Returns the size of the partition index in bytes, 0 if it was not built. */
+    size_t getPartitionIndexSizeB() const;
+    /** Returns the number of (segment, word) pairs stored in the partition index. */
+    size_t getPartitionPostingsCount() const { return partitionPostings.getSize(); }
+    /** Returns the number of fingerprint groups over all brackets, 0 if they were not built. */
+    size_t getFingerprintGroupsCount() const { return fingerprintGroups.size(); }
+    /** Returns the size of the fingerprint groups in bytes, 0 if they were not built. */
+    size_t getFingerprintGroupsSizeB() const;
+    /** Returns the size of the fingerprint neighborhood directories in bytes, 0 if they were not built. */
+    size_t getFingerprintNeighborhoodSizeB() const;
+    /** Returns the size of the popcount sub-bucket starts in bytes, 0 if they were not built. */
+    size_t getPopcountBucketsSizeB() const { return popcountStarts.size() * sizeof(uint32_t); }
+    /** Returns the number of bits per char of the packed words, 0 if they were not built. */
+    size_t getPackedBits() const { return packedBits; }
+    /** Returns the size of the packed words in bytes, 0 if they were not built. */
+    size_t getPackedWordsSizeB() const { return packedLanes.size() * sizeof(uint64_t); }
+    /** Returns the size of the front coded words in bytes, 0 if they were not built. */
+    size_t getFrontCodedSizeB() const { return frontCodedWords.size(); }
+    /** Returns true if the dictionary array was released and only the front coded words are stored. */
+    bool isFrontCodedOnly() const { return frontCodedOnly; }
+
+    /** Returns the number of patterns answered with [plan] during the last test. */
+    size_t getPlanCount(Plan plan) const { return defaultContext.getPlanCount(plan); }
+    /** Returns the calibrated cost of a unit of work of [plan] for [k] errors in nanoseconds,
+     * or a negative value if the plan is not available or was not calibrated for [k]. */
+    float getPlanUnitCostNs(Plan plan, int k) const;
+    /** Returns the name of [plan] used in stats output. */
+    static std::string getPlanName(Plan plan);
+
+    /** Returns the size of the dictionary array (fingerprints and words) in bytes. */
+    size_t getFingArraySizeB() const { return fingArraySize; }
+
+    /** Returns how the dictionary array was allocated. */
+    IndexMemory::Backing getFingArrayBacking() const { return fingArrayBacking; }
+    /** Returns true if memory locking was requested and succeeded for all index arrays. */
+    bool isMemoryLocked() const { return memoryLocked; }
+    /** Returns the number of non-ASCII code points which share a single code unit in UTF-8 mode. */
+    size_t getSharedCodePointsCount() const { return nSharedCodePoints; }
 
 private:
     /*
@@ -58,7 +297,21 @@ private:
     /** Constructs an array which stores only [words]. */
     void preprocessWords(std::vector<std::string> words);
 
-    /** Initializes a lookup table for true number of errors based on fingerprints errors. */
+    /** Returns [pattern] mapped to the representation stored in fingArray (see mapWord), or [pattern] itself
+     * if it is stored as is, and sets [size] to the size of the returned string.
+     * The mapped pattern is stored in the normalizedPattern of [context], which is reused by subsequent calls. */
+    const char *normalizePattern(QueryContext &context, const std::string &pattern, size_t &size) const;
+    /** Maps [str] of [size] bytes through normalizationTable and in UTF-8 mode decodes it into code units,
+     * stores the result in [out] (which must hold at least [size] bytes) and returns its size. */
+    size_t mapWord(const char *str, size_t size, char *out) const;
+    /** Returns the code unit for [codePoint], unknownCodeUnit for code points which do not occur in the dictionary. */
+    char getCodeUnit(uint32_t codePoint) const;
+    /** Assigns code units to all non-ASCII code points from [words], the most frequent ones first, the code points
+     * which do not get their own code unit share sharedCodeUnit. Throws invalid_argument if a word is not valid UTF-8. */
+    void assignCodeUnits(const std::vector<std::string> &words);
+
+    /** Initializes a lookup table for true number of errors based on fingerprints errors,
+     * with each error accounting for at most subNMismatches mismatches. */
     void initNErrorsLUT();
     
     /** Initializes the character map for [fingerprintType] (occurrence, occurrence halved, count) 
@@ -81,29 +334,257 @@ private:
      * Calculates a count for each word size and stores it in [wordCountsBySize]
      * (passed array must be of size maxWordSize + 1). */
     static size_t calcTotalSize(const std::vector<std::string> &words, size_t *wordCountsBySize);
+    /** Returns the size of fingArray including entry padding for [wordCountsBySize] words of each size. */
+    size_t calcArraySize(const size_t *wordCountsBySize) const;
 
     /** Set to false if the user selected the mode without fingeprints (where only the words are stored). */
     bool useFingerprints = true;
-    /** Set to false if the user selected the Levenshtein distance. */
+    /** Set to false if the user selected the Levenshtein or the optimal string alignment distance. */
     bool useHamming = true;
+    /** Set to true if the user selected the optimal string alignment distance, i.e. Levenshtein distance
+     * where swapping two adjacent characters counts as a single edit (but no substring is edited twice). */
+    bool useOsa = false;
+
+    /** Entries in fingArray are padded to a multiple of this many bytes. */
+    const size_t entryAlignment;
+
+    /** Memory type used for fingArray, and locking of all index arrays. */
+    const IndexMemory::Type memoryType;
+    const bool lockMemory;
+    bool memoryLocked = false;
+
+    /** Locks fingArray, nMismatchesLUT, exactHash, and the arrays of the other indexes in RAM, calculates and locks
+     * the accept bitmaps for k up to maxPrebuiltK, and sets memoryLocked accordingly. */
+    void lockIndexMemory();
+    /** Accept bitmaps for larger k are still calculated on first use when memory is locked. */
+    static constexpr int maxPrebuiltK = 3;
+
+    /** Number of characters in a gram for q-gram fingerprints. */
+    const size_t qgramSize;
+
+    /** Set if the exact hash table should be built during preprocessing. */
+    const bool useExactHash;
+
+    /** Set if the entries in each bracket are sorted by fingerprint and grouped during preprocessing. */
+    const bool useFingerprintGroups;
+    /** Set if the fingerprint neighborhood directories should be built during preprocessing. */
+    const bool useFingerprintNeighborhood;
+    /** Set if the entries in each bracket are sorted by fingerprint popcount during preprocessing. */
+    const bool usePopcountBuckets;
+    /** Set if the packed words should be built during preprocessing. */
+    const bool usePackedWords;
+    /** Set if the front coded words should be built during preprocessing. */
+    const bool useFrontCoding;
+    /** Set if fingArray was released after building the front coded words. */
+    bool frontCodedOnly = false;
+
+    /** Builds fingerprintGroups for the entries which are already stored in fingArray sorted by fingerprint. */
+    void buildFingerprintGroups();
+    /** Builds the neighborhood directories for the brackets having at least minNeighborhoodGroups groups. */
+    void buildFingerprintNeighborhood();
+    /** Builds popcountStarts for the entries which are already stored in fingArray sorted by fingerprint popcount. */
+    void buildPopcountBuckets();
+
+    /** Sets [iBegin] and [iEnd] to the range of entries of [wordSize] whose fingerprint popcount differs
+     * from [patWeight] by at most [maxWeightDiff]. */
+    void getPopcountWindow(size_t wordSize, size_t patWeight, size_t maxWeightDiff, size_t &iBegin, size_t &iEnd) const;
+
+    /** Builds the packed codes, packedLanes and packedStarts for the words which are already stored in fingArray.
+     * Throws invalid_argument if the alphabet of the words is too large. */
+    void buildPackedWords();
+    /** Writes the codes of [str] having [size] chars packed into lanes of [Bits]-bit codes to [lanes]. */
+    template<size_t Bits>
+    void packWord(const char *str, size_t size, uint64_t *lanes) const;
+    /** Returns the number of codes which differ in lanes xored as [x] for [Bits]-bit codes. */
+    template<size_t Bits>
+    static size_t countPackedMismatches(uint64_t x);
+
+    /** Builds frontCodedWords and frontCodedStarts for the words which are already stored in fingArray. */
+    void buildFrontCodedWords();
+    /** Releases fingArray once the front coded words are built, if nothing else addresses its entries. */
+    void releaseFingArray();
+    /** Calls [fun] with the fingerprint (0 without fingerprints) and the word of each front coded entry
+     * of [wordSize] in their order. Words are decoded into [word], which must hold [wordSize] chars. */
+    template<typename Fun>
+    void forEachFrontCodedWord(size_t wordSize, char *word, Fun fun) const;
+
+    /** Calls [fun] with each group of words of [wordSize] whose fingerprint passes the comparison with
+     * [patFingerprint] according to [acceptBitmap]. If the bracket has a neighborhood directory and [acceptedXors]
+     * (the xors set in [acceptBitmap]) are fewer than its groups, the passing fingerprints are looked up,
+     * otherwise all groups are tested. [acceptedXors] are read only in the former case. With popcount buckets,
+     * only the groups in the window of [maxWeightDiff] (see getMaxAcceptedWeight) are tested. */
+    template<typename Fun>
+    void forEachAcceptedGroup(size_t wordSize, FING_T patFingerprint, const uint64_t *acceptBitmap,
+        const std::vector<FING_T> *acceptedXors, size_t maxWeightDiff, Fun fun) const;
+
+    /** Builds the exact hash table for the words which are already stored in fingArray. */
+    void buildExactHash();
+
+    /** Maximum number of errors covered by the deletion index, -1 if it should not be built. */
+    const int deletionIndexK;
+
+    /** Builds the deletion index for the words which are already stored in fingArray. */
+    void buildDeletionIndex();
+    /** Appends to [hashes] the hashes of [str] of [size] and of all strings obtained from it by deleting at most
+     * [nDeletions] characters at positions [start] or later. Deleting any character of a run gives the same string,
+     * hence only the first one is deleted, but some variants can still be repeated. Level [depth] and higher
+     * of [buffers] (deletionBuffersSize bytes) are overwritten. */
+    static void addDeletionVariants(const char *str, size_t size, size_t start, int nDeletions, size_t depth,
+        char *buffers, std::vector<uint32_t> &hashes);
+    /** Returns the hash of a deletion variant [str] of [size] chars. */
+    static uint32_t calcDeletionHash(const char *str, size_t size);
+    /** Returns true if the deletion index is built and used for [k] errors. */
+    bool usesDeletionIndex(int k) const;
+    /** Sets the candidates of [context] to the words which share a deletion variant with [pattern] of [size]
+     * for [k] errors and whose size can be within the distance, each word is listed once. */
+    void collectDeletionCandidates(QueryContext &context, const char *pattern, size_t size, int k) const;
+
+    /** Maximum number of errors covered by the partition index, -1 if it should not be built. */
+    const int partitionIndexK;
+
+    /** Builds the partition index for the words which are already stored in fingArray. */
+    void buildPartitionIndex();
+    /** Sets [start] and [size] to the position and size of segment [iSegment] of words of [wordSize],
+     * segments are as even as possible and empty for words shorter than nPartitionSegments. */
+    void getPartitionSegment(size_t wordSize, size_t iSegment, size_t &start, size_t &size) const;
+    /** Returns the hash of [str] of [size] chars as segment [iSegment] of words of [wordSize]. */
+    static uint32_t calcPartitionHash(size_t wordSize, size_t iSegment, const char *str, size_t size);
+    /** Returns true if the partition index is built and used for [k] errors. */
+    bool usesPartitionIndex(int k) const;
+    /** Sets the candidates of [context] to the words whose size can be within the distance from [pattern] of [size]
+     * for [k] errors and which share a segment with the pattern, or which are too short to be split,
+     * each word is listed once. */
+    void collectPartitionCandidates(QueryContext &context, const char *pattern, size_t size, int k) const;
+
+    /** Sets wordIdStarts for the words which are already stored in fingArray. */
+    void initWordIds();
+    /** Sets the candidates of [context] for [pattern] of [size] and [k] errors using the index of [plan]. */
+    void collectCandidates(QueryContext &context, const char *pattern, size_t size, int k, Plan plan) const;
+    /** Clears the candidates of [context] and advances its stamp before collecting them for a new pattern. */
+    static void startCandidates(QueryContext &context);
+    /** Adds the word having [id] and [wordSize] to the candidates of [context] unless it was already added
+     * for the current pattern. */
+    void addCandidate(QueryContext &context, uint32_t id, size_t wordSize) const;
+
+    /** Allocates the buffers of [context] which are missing or too small for this index. */
+    void prepareContext(QueryContext &context) const;
+    /** Context used by the methods which do not take one, i.e. the non-const test methods and calibration. */
+    QueryContext defaultContext;
 
     /*
      *** TESTING
      */
 
+    /** Indicates a kernel which takes k only at runtime. */
+    static constexpr int anyK = -1;
+
+    using TestFun = int (Fingerprints<FING_T>::*)(QueryContext &, const std::vector<std::string> &, int) const;
+    using Candidate = typename QueryContext::Candidate;
+
+    /** Returns the plan used for all queries with [k] errors without the planner. */
+    Plan getDefaultPlan(int k) const;
+    /** Returns true if [plan] can answer queries with [k] errors. */
+    bool isPlanAvailable(Plan plan, int k) const;
+    /** Returns the test function for [plan] and the current settings, specialized for [k] if k <= 3. */
+    TestFun getTestFun(int k, Plan plan) const;
+    /** Returns the scan test function for the current settings and K errors known at compile time (or anyK),
+     * fingerprints are compared only if [plan] is the fingerprint scan. */
+    template<int K>
+    TestFun getTestFunForK(Plan plan) const;
+    /** Returns the test function of the candidate index of P, specialized for [k] if k <= 3. */
+    template<Plan P>
+    TestFun getCandidateIndexTestFun(int k) const;
+
+    /*
+     *** PLANNING
+     */
+
+    /** Maximum number of errors for which the planner is calibrated. */
+    static constexpr int maxPlannerK = 3;
+    /** Number of sample queries used for calibrating each plan. */
+    static constexpr size_t nPlannerSamples = 16;
+
+    /** Times each available plan for each k up to maxPlannerK on samples made from [words] (as passed to preprocess)
+     * and sets planUnitCostsNs. */
+    void calibratePlanner(const std::vector<std::string> &words);
+    /** Returns at most nPlannerSamples sample queries for calibrating the planner, each of them is one of [words]
+     * with its middle char (code point in UTF-8 mode) substituted. */
+    std::vector<std::string> makePlannerSamples(const std::vector<std::string> &words);
+    /** Returns the number of work units of [plan] for a pattern of [size] and [k] errors, i.e. scanned entries
+     * for the scans, probed variants for the deletion index, probed segments and their expected hits for the partition
+     * index, and a single probe for the exact hash. */
+    size_t calcPlanUnits(Plan plan, size_t size, int k) const;
+    /** Returns the plan with the lowest estimated cost for a pattern of [size] and [k] errors. */
+    Plan choosePlan(size_t size, int k) const;
+
+    /** Set if the planner was calibrated. */
+    const bool usePlanner;
+    /** Cost of a work unit of each plan in nanoseconds for each k, negative for plans which are not available. */
+    float planUnitCostsNs[maxPlannerK + 1][nPlans];
+
     /** Performs approximate matching for [patterns] and [k] errors using fingerprints for Hamming distance.
      * Returns the total number of matches. Sets elapsedUs to time elapsed during this matching. */
-    int testFingerprintsHamming(const std::vector<std::string> &patterns, int k);
-    /** Performs approximate matching for [patterns] and [k] errors using fingerprints for Levenshtein distance.
-     * Returns the total number of matches. Sets elapsedUs to time elapsed during this matching. */
-    int testFingerprintsLeven(const std::vector<std::string> &patterns, int k);
-
-    /** Performs approximate matching for [patterns] and [k] errors without fingerprints for Hamming distance.
+    template<int K>
+    int testFingerprintsHamming(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+    /** Performs approximate matching for [patterns] and [k] errors using fingerprints for Levenshtein distance,
+     * or for the optimal string alignment distance if Osa is true.
      * Returns the total number of matches. Sets elapsedUs to time elapsed during this matching. */
-    int testWordsHamming(const std::vector<std::string> &patterns, int k);
-    /** Performs approximate matching for [patterns] and [k] errors without fingerprints for Levenshtein distance.
+    template<int K, bool Osa = false>
+    int testFingerprintsLeven(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+
+    /** Performs approximate matching for [patterns] and [k] errors using fingerprint groups for Hamming distance.
+     * Returns the total number of matches. */
+    template<int K>
+    int testGroupsHamming(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+    /** Performs approximate matching for [patterns] and [k] errors using fingerprint groups for Levenshtein distance,
+     * or for the optimal string alignment distance if Osa is true. Returns the total number of matches. */
+    template<int K, bool Osa = false>
+    int testGroupsLeven(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+
+    /** Performs exact matching for [patterns] using the exact hash table, [k] must be 0.
+     * Returns the total number of matches. */
+    int testExactHash(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+
+    /** Performs approximate matching for [patterns] and [k] errors using the candidate index of P (the deletion
+     * or the partition index), candidates are filtered by fingerprints if they are used and verified for the current
+     * distance. Returns the total number of matches. */
+    template<int K, Plan P>
+    int testCandidateIndex(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+
+    /** Returns the index of the entry holding [str] of [size] in the bracket for words of [size] using
+     * the exact hash table, or -1 if not found. Adds the number of compared words to [nCompared],
+     * and the compared words themselves to [comparedWords] unless it is nullptr. */
+    int64_t probeExactHash(const char *str, size_t size, size_t &nCompared,
+        std::vector<std::string> *comparedWords = nullptr) const;
+    /** Returns the hash of [str] having [size] chars used by the exact hash table. */
+    static uint64_t calcExactHash(const char *str, size_t size);
+
+    /** Returns the number of entries of [entrySize] bytes to prefetch ahead during fingerprint scans,
+     * 0 if prefetching should not be used for such entries. */
+    static size_t calcPrefetchDistance(size_t entrySize);
+    /** Issues prefetches for a scan located at [curEntry] and ending at [nextEntry], for entries of [entrySize] bytes
+     * and prefetch distance of [prefetchOffset] bytes. Word bytes are prefetched only for entries which pass
+     * the fingerprint comparison with [patFingerprint] according to [acceptBitmap]. */
+    void prefetchEntries(const char *curEntry, const char *nextEntry,
+        FING_T patFingerprint, const uint64_t *acceptBitmap, size_t entrySize, size_t prefetchOffset) const;
+
+    /** Performs approximate matching for [patterns] and [k] errors without fingerprints for Hamming distance,
+     * fingerprints are skipped if they are stored. Returns the total number of matches. Sets elapsedUs to time elapsed during this matching. */
+    template<int K>
+    int testWordsHamming(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+    /** Performs approximate matching for [patterns] and [k] errors for Hamming distance using packed words
+     * of [Bits]-bit codes. Returns the total number of matches. */
+    template<size_t Bits>
+    int testPackedHamming(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+    /** Performs approximate matching for [patterns] and [k] errors for Levenshtein distance using front coded words,
+     * comparing fingerprints first if UseFingerprints is true. Returns the total number of matches. */
+    template<bool UseFingerprints>
+    int testFrontCodedLeven(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
+    /** Performs approximate matching for [patterns] and [k] errors without fingerprints for Levenshtein distance,
+     * or for the optimal string alignment distance if Osa is true, fingerprints are skipped if they are stored.
      * Returns the total number of matches. Sets elapsedUs to time elapsed during this matching. */
-    int testWordsLeven(const std::vector<std::string> &patterns, int k);
+    template<int K, bool Osa = false>
+    int testWordsLeven(QueryContext &context, const std::vector<std::string> &patterns, int k) const;
 
     /** Tests [patterns] for [k] errors using fingerprints for Hamming distance.
      * Returns the fraction of words which were rejected by fingerprints. */
@@ -113,18 +594,14 @@ private:
      * Returns the fraction of words which were rejected by fingerprints. */
     float testRejectionLeven(const std::vector<std::string> &patterns, int k);
 
-    void setProcessedWords(const std::vector<std::string> &patterns, int k);
-    void setProcessedWordsCount(const std::vector<std::string> &patterns, int k);
+    /** Adds the words processed for [patterns] and [k] errors with [plan] to the processed words of [context]. */
+    void setProcessedWords(QueryContext &context, const std::vector<std::string> &patterns, int k, Plan plan) const;
+    /** Adds the number of words processed for [patterns] and [k] errors with [plan] to the count in [context]. */
+    void setProcessedWordsCount(QueryContext &context, const std::vector<std::string> &patterns, int k, Plan plan) const;
 
     /** Elapsed (during construction or testing) time in microseconds. */
     float elapsedUs = 0.0f;
 
-    /** A collection of all words processed during a single test iteration. */
-    std::vector<std::string> processedWords;
-
-    /** Count of all words processed during a single test iteration. */
-    size_t processedWordsCount;
-
     /*
      *** FINGERPRINT CALCULATION
      */
@@ -141,12 +618,43 @@ private:
     FING_T calcFingerprintPos(const char *str, size_t size) const;
     /** Returns an occurrence halved fingerprint for string [str] having [size] chars. */
     FING_T calcFingerprintOccHalved(const char *str, size_t size) const;
+    /** Returns a q-gram fingerprint for string [str] having [size] chars, where each of its q-grams toggles
+     * a single bit selected by hashing. Strings shorter than q have an empty fingerprint. */
+    FING_T calcFingerprintQGram(const char *str, size_t size) const;
 
     /** Returns the Hamming weight for number [n]. */
     static unsigned int calcHammingWeight(unsigned int n);
     /** Returns the number of errors resulting from comparing fingerprints [f1] and [f2]. */
     unsigned char calcNErrors(FING_T f1, FING_T f2) const;
 
+    /** Returns the minimum Levenshtein distance between words whose sizes differ by [lenDiff]
+     * and whose fingerprint comparison yields [nMismatches] mismatches. */
+    unsigned char calcLevNErrors(size_t nMismatches, size_t lenDiff) const;
+
+    /** Returns the accept bitmap for [nErrors] and words whose size differs from the pattern size by [lenDiff]
+     * (which must be 0 for Hamming distance), calculating it on first use. */
+    const uint64_t *getAcceptBitmap(int nErrors, size_t lenDiff = 0) const;
+    /** Calculates the accept bitmaps for [nErrors] and all size differences up to [nErrors], so that
+     * they are not calculated while timing or on the first query. */
+    void prepareAcceptBitmaps(int nErrors) const;
+    /** Returns a new accept bitmap, the bit for x is set iff the lower bound on the number of errors for
+     * fingerprint xor x and size difference [lenDiff] is at most [nErrors]. The bound is calcNErrors for
+     * Hamming distance and calcLevNErrors for Levenshtein distance. */
+    uint64_t *calcAcceptBitmap(size_t nErrors, size_t lenDiff) const;
+    /** Returns the fingerprint xors which are set in the accept bitmap for [nErrors] and [lenDiff],
+     * calculating them on first use. */
+    const std::vector<FING_T> &getAcceptedXors(int nErrors, size_t lenDiff = 0) const;
+    /** Returns the largest popcount of the xors set in the accept bitmap for [nErrors] and [lenDiff],
+     * calculating it on first use. */
+    size_t getMaxAcceptedWeight(int nErrors, size_t lenDiff = 0) const;
+
+    /** Returns true if [fingXor] (pattern fingerprint xored with word fingerprint) is set in [acceptBitmap]. */
+    static bool isAccepted(const uint64_t *acceptBitmap, FING_T fingXor)
+    {
+        const size_t x = fingXor;
+        return (acceptBitmap[x / 64] >> (x % 64)) & 0x1U;
+    }
+
     /*
      *** DISTANCE CALCULATION
      */
@@ -155,21 +663,72 @@ private:
     static bool isHamAtMostK(const char *str1, const char *str2, const size_t size, const int k);
 
     /** Returns true if Levenshtein distance between [str1] of [size1] and [str2] of [size2] is at most [k] (i.e. <= k).
-     * Uses the 2k + 1 strip. */
-    bool isLevAtMostK(const char *str1, size_t size1, const char *str2, const size_t size2, const int k);
+     * Uses the 2k + 1 strip stored in the rows of [context]. */
+    static bool isLevAtMostK(QueryContext &context, const char *str1, size_t size1, const char *str2, const size_t size2,
+        const int k);
+
+    /** Returns true if Hamming distance between [str1] and [str2] both of [size] is at most K,
+     * or at most [k] if K == anyK. */
+    template<int K>
+    static bool isHamAtMost(const char *str1, const char *str2, const size_t size, const int k);
+
+    /** Returns true if Levenshtein distance between [str1] of [size1] and [str2] of [size2] is at most K,
+     * or at most [k] if K == anyK. Uses exact comparison for K = 0, prefix and suffix matching for K = 1,
+     * a band of width fixed at compile time for K = 2 and 3, and isLevAtMostK otherwise. */
+    template<int K>
+    static bool isLevAtMost(QueryContext &context, const char *str1, const size_t size1, const char *str2, const size_t size2,
+        const int k);
+
+    /** Sets the osaPeq of [context] for [pattern] having [size] chars, it is used by isOsaAtMostK
+     * until clearOsaPattern is called. */
+    static void setOsaPattern(QueryContext &context, const char *pattern, size_t size);
+    /** Resets the osaPeq of [context] which was set for [pattern] having [size] chars. */
+    static void clearOsaPattern(QueryContext &context, const char *pattern, size_t size);
+
+    /** Returns true if the optimal string alignment distance between [pattern] of [patSize], which must have been
+     * passed to setOsaPattern, and [str] of [size] is at most [k]. Uses the bit-parallel algorithm by Hyyro
+     * for patterns of up to 64 characters and isOsaAtMostKDP otherwise. */
+    static bool isOsaAtMostK(QueryContext &context, const char *pattern, const size_t patSize, const char *str,
+        const size_t size, const int k);
+    /** Returns true if the optimal string alignment distance between [str1] of [size1] and [str2] of [size2]
+     * is at most [k]. Uses dynamic programming over full rows stored in [context]. */
+    static bool isOsaAtMostKDP(QueryContext &context, const char *str1, const size_t size1, const char *str2,
+        const size_t size2, const int k);
+
+    /** Returns true if Levenshtein distance between [str1] of [size1] and [str2] of [size2] is at most 1. */
+    static bool isLevAtMostOne(const char *str1, size_t size1, const char *str2, size_t size2);
+    /** Returns true if Levenshtein distance between [str1] of [size1] and [str2] of [size2] is at most K.
+     * Uses the 2K + 1 band stored in registers. */
+    template<int K>
+    static bool isLevAtMostKBand(const char *str1, const size_t size1, const char *str2, const size_t size2);
 
     /*
      *** CONSTANTS
      */
 
     static constexpr size_t maxWordSize = 2048;
-    static constexpr size_t charsMapSize = 255;
+    static constexpr size_t charsMapSize = 256;
+
+    /** Maximum entry alignment, matching the alignment guaranteed by the new[] operator. */
+    static constexpr size_t maxEntryAlignment = 16;
 
     /** Indicates that a character is not stored in a fingerprint. */
     static constexpr unsigned char noCharIndex = 255;
 
     /** Number of bits per position in a position fingerprint. */
     static constexpr size_t nBitsPerPos = 3;
+
+    /** Allowed gram sizes for q-gram fingerprints. */
+    static constexpr size_t minQGramSize = 2;
+    static constexpr size_t maxQGramSize = 3;
+
+    static constexpr size_t cacheLineSize = 64;
+
+    /** Number of bytes which are prefetched ahead of the current entry during fingerprint scans. */
+    static constexpr size_t prefetchAheadBytes = 2048;
+    /** Bounds for the prefetch distance expressed in entries. */
+    static constexpr size_t minPrefetchDistance = 4;
+    static constexpr size_t maxPrefetchDistance = 32;
     
     /*
      *** ARRAYS, MAPS, AND LOOKUP TABLES
@@ -177,12 +736,36 @@ private:
 
     /** Stores contiguously pairs (fingerprint, word) sorted by word size. */
     char *fingArray = nullptr;
-    /** Points to the beginning of each word size bracket in fingArray. */
+    size_t fingArraySize = 0;
+    IndexMemory::Backing fingArrayBacking = IndexMemory::Backing::Heap;
+
+    /** Points to the beginning of each word size bracket in fingArray, nullptr if it was released. */
     char *fingArrayEntries[maxWordSize + 2];
+    /** Number of words in each word size bracket, kept when fingArray is released. */
+    size_t bucketSizes[maxWordSize + 1];
 
     /** Maps chars to their positions in fingerprints, used for occurrence and count fingerprints. */
     unsigned char *charsMap = nullptr;
 
+    /** Maps each byte of the dictionary words and patterns, used only if useNormalization is true. */
+    unsigned char normalizationTable[Normalization::tableSize];
+    bool useNormalization = false;
+
+    /** Set to true for UTF-8 mode, where code points are stored as single byte code units. ASCII code points are
+     * their own code units, and the remaining ones are assigned consecutive code units in order of decreasing
+     * frequency in the dictionary, which is enough for the alphabet of a single language or script.
+     * Mixed scripts and CJK dictionaries have more, the least frequent code points then share a code unit. */
+    bool useUtf8 = false;
+    std::unordered_map<uint32_t, unsigned char> codePointUnits;
+    size_t nSharedCodePoints = 0;
+
+    /** The first code unit assigned to a non-ASCII code point. */
+    static constexpr unsigned int firstCodeUnit = 0x80;
+    /** The last code unit, shared by the least frequent code points if there are more of them than code units. */
+    static constexpr unsigned int sharedCodeUnit = 0xFE;
+    /** Code unit for code points which do not occur in the dictionary (and for invalid sequences in patterns). */
+    static constexpr unsigned int unknownCodeUnit = 0xFF;
+
     /** Character list, used for position fingerprints. */
     unsigned char *charList = nullptr;
 
@@ -191,10 +774,130 @@ private:
     /** Stores the number of fingerprint mismatches resulting from fingerprint comparison. */
     unsigned char *nMismatchesLUT = nullptr;
 
-    /** Stores intermediate results of Levenshtein distance calculation (previous array). */
-    int *levV0 = nullptr;
-    /** Stores intermediate results of Levenshtein distance calculation (current array). */
-    int *levV1 = nullptr;
+    /** Allocates nMismatchesLUT having an entry for each possible fingerprint value. */
+    void allocNMismatchesLUT();
+    /** Returns the number of entries in nMismatchesLUT. */
+    static constexpr size_t nMismatchesLUTSize() { return static_cast<size_t>(std::numeric_limits<FING_T>::max()) + 1; }
+
+    /** For each number of errors t and size difference d <= t, a bitmap having a bit for each possible
+     * fingerprint xor, which is set if comparing fingerprints with such xor for words whose sizes differ by d
+     * yields at most t errors (i.e. the word is not rejected). Replaces the nMismatchesLUT and nErrorsLUT chain
+     * in scans, 8 KB for 16-bit fingerprints. Calculated on first use for a given t and d,
+     * acceptBitmaps[nAcceptBitmaps - 1][0] accepts everything and covers all t >= number of fingerprint bits. */
+    static constexpr size_t nAcceptBitmaps = sizeof(FING_T) * 8 + 1;
+    mutable std::atomic<uint64_t *> acceptBitmaps[nAcceptBitmaps][nAcceptBitmaps];
+    /** Xors set in acceptBitmaps, in increasing order, nullptr until first use. */
+    mutable std::atomic<std::vector<FING_T> *> acceptedXors[nAcceptBitmaps][nAcceptBitmaps];
+    /** Largest popcounts of the xors set in acceptBitmaps, -1 until first use. */
+    mutable std::atomic<int> maxAcceptedWeights[nAcceptBitmaps][nAcceptBitmaps];
+    /** Held while calculating any of the above, they are never changed once set, so readers do not take it. */
+    mutable std::mutex acceptMutex;
+
+    /** The maximum number of fingerprint mismatches which can be caused by a single substitution and by
+     * a single insertion or deletion, used for calculating nErrorsLUT and Levenshtein bounds. An insertion or deletion
+     * moves the middle of the word for occurrence halved fingerprints and shifts the positions for position fingerprints,
+     * and each edit affects up to q grams for q-gram fingerprints. */
+    size_t subNMismatches = 2;
+    size_t indelNMismatches = 1;
+    /** The maximum number of fingerprint mismatches which can be caused by swapping two adjacent characters,
+     * used for the optimal string alignment distance. A swap does not change the letter multiset, but it can move
+     * letters across the middle of the word or shift their positions. */
+    size_t transNMismatches = 0;
+
+    /** Returns the number of 64-bit words in a single accept bitmap. */
+    static constexpr size_t acceptBitmapSize() { return (nMismatchesLUTSize() + 63) / 64; }
+
+    /** Open addressing (linear probing) hash table over fingArray, a separate power of 2 sized range for each
+     * word size bracket. A slot stores the index of an entry in its bracket + 1, 0 marks an empty slot,
+     * the words themselves are not copied. Load factor is at most 1/2. */
+    uint32_t *exactHash = nullptr;
+    size_t exactHashSize = 0;
+
+    /** Points to the beginning of the range for each word size bracket in exactHash, the range for size s
+     * ends at exactHashStarts[s + 1]. */
+    size_t exactHashStarts[maxWordSize + 2];
+
+    /** A run of consecutive entries in a word size bracket which share a fingerprint, starting at entry iEntry. */
+    struct FingerprintGroup
+    {
+        FING_T fingerprint;
+        uint32_t iEntry;
+        uint32_t nEntries;
+    };
+
+    /** Groups for all brackets sorted by size and by fingerprint within each bracket (by popcount first with
+     * popcount buckets), the groups for size s
+     * start at fingerprintGroupStarts[s] and end at fingerprintGroupStarts[s + 1]. */
+    std::vector<FingerprintGroup> fingerprintGroups;
+    size_t fingerprintGroupStarts[maxWordSize + 2];
+
+    /** Brackets having fewer groups are always scanned, since a directory would not be smaller than the groups. */
+    static constexpr size_t minNeighborhoodGroups = 64;
+    static constexpr size_t noNeighborhood = std::numeric_limits<size_t>::max();
+
+    /** Neighborhood directory for each bracket, starting at neighborhoodStarts[s] (noNeighborhood if there is none)
+     * and having acceptBitmapSize() words. The bit for fingerprint f is set if a group has f, and the index of the group
+     * in its bracket is neighborhoodRanks at the word of f plus the number of set bits preceding f in that word. */
+    std::vector<uint64_t> neighborhoodBits;
+    std::vector<uint32_t> neighborhoodRanks;
+    size_t neighborhoodStarts[maxWordSize + 2];
+
+    /** Number of possible fingerprint popcounts, and one more for the end of the last sub-bucket. */
+    static constexpr size_t nPopcountStarts = sizeof(FING_T) * 8 + 2;
+
+    /** Popcount sub-buckets, the entries of size s having popcount p start at index
+     * popcountStarts[s * nPopcountStarts + p] within their bracket. */
+    std::vector<uint32_t> popcountStarts;
+
+    /** Bits per char of the packed words (4 or 5, 0 if they were not built), and codes for chars, starting from 1.
+     * Code 0 is reserved for pattern chars which do not occur in the dictionary and for the unused tail of lanes. */
+    size_t packedBits = 0;
+    unsigned char packedCodes[256];
+
+    /** Packed words in the order of their entries in fingArray, each word of size s takes calcPackedLanesCount(s)
+     * lanes and the words of size s start at lane packedStarts[s]. Codes do not cross lanes. */
+    std::vector<uint64_t> packedLanes;
+    size_t packedStarts[maxWordSize + 2];
+
+    /** Returns the number of lanes taken by a word having [size] chars. */
+    size_t calcPackedLanesCount(size_t size) const
+    {
+        const size_t charsPerLane = 64 / packedBits;
+        return (size + charsPerLane - 1) / charsPerLane;
+    }
+
+    /** Front coded words of each bracket sorted lexicographically, the words of size s start at byte
+     * frontCodedStarts[s]. An entry consists of the fingerprint (if fingerprints are used), the size of the prefix
+     * shared with the previous entry (a single byte, longer prefixes are truncated), and the remaining chars. */
+    std::vector<char> frontCodedWords;
+    size_t frontCodedStarts[maxWordSize + 2];
+
+    /** Maximum number of errors for which the deletion index can be built. */
+    static constexpr int maxDeletionIndexK = 4;
+    /** Size of the buffers for deletion variants, a level for each deletion. */
+    static constexpr size_t deletionBuffersSize = maxDeletionIndexK * (maxWordSize + maxDeletionIndexK);
+
+    /** Deletion index, maps variant hashes to word ids. Words are not copied, hash collisions only add candidates
+     * which are rejected by verification. */
+    HashPostings deletionPostings;
+
+    /** Maximum number of errors for which the partition index can be built. */
+    static constexpr int maxPartitionIndexK = 8;
+
+    /** Partition index, maps segment hashes (which include the word size and the segment number) to word ids. */
+    HashPostings partitionPostings;
+    /** Number of segments each word is split into, 0 if the partition index was not built. */
+    size_t nPartitionSegments = 0;
+    /** For each word size, the expected number of words found by probing each of its segments once,
+     * used by the planner. */
+    std::vector<float> partitionHitsPerProbes;
+
+    /** Ids of words in the candidate indexes are consecutive within each word size bracket,
+     * the first id for size s is wordIdStarts[s], and the ids for size s end at wordIdStarts[s + 1]. */
+    uint32_t wordIdStarts[maxWordSize + 2];
+
+    /** Number of characters which can be encoded in osaPeq. */
+    static constexpr size_t maxOsaPatternSize = 64;
 
     /*
      *** FINGERPRINT LETTER COLLECTIONS
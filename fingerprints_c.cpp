@@ -0,0 +1,247 @@
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fingerprints_c.h"
+#include "matcher.hpp"
+
+#include "helpers.hpp"
+
+using namespace fingerprints;
+using namespace std;
+
+struct fp_index
+{
+    fp_index(Matcher::DistanceType distanceType, Matcher::FingerprintType fingerprintType, Matcher::LettersType lettersType,
+        const IndexOptions &indexOptions)
+        :matcher(distanceType, fingerprintType, lettersType, indexOptions) { }
+
+    Matcher matcher;
+};
+
+struct fp_context
+{
+    Matcher::QueryContext context;
+
+    /** Patterns of the current batch, kept between batches in order to avoid reallocation. */
+    vector<StringRef> patternRefs;
+};
+
+namespace
+{
+
+thread_local string lastError;
+
+fp_status fail(fp_status status, const string &message)
+{
+    lastError = message;
+    return status;
+}
+
+/** Calls [fun] and converts the exceptions thrown by it into status codes, since they cannot cross the C interface. */
+template<typename Fun>
+fp_status guard(Fun fun)
+{
+    try
+    {
+        fun();
+        return FP_OK;
+    }
+    catch (const invalid_argument &e)
+    {
+        return fail(FP_ERROR_INVALID_ARGUMENT, e.what());
+    }
+    catch (const bad_alloc &e)
+    {
+        return fail(FP_ERROR_OUT_OF_MEMORY, e.what());
+    }
+    catch (const exception &e)
+    {
+        return fail(FP_ERROR_INTERNAL, e.what());
+    }
+    catch (...)
+    {
+        return fail(FP_ERROR_INTERNAL, "unknown error");
+    }
+}
+
+}
+
+extern "C"
+{
+
+void fp_options_init(fp_options *options)
+{
+    if (options == nullptr)
+    {
+        return;
+    }
+
+    const IndexOptions defaults;
+
+    *options = fp_options();
+    options->distance_type = FP_DISTANCE_HAM;
+    options->fingerprint_type = FP_FINGERPRINT_OCC;
+    options->letters_type = FP_LETTERS_COMMON;
+
+    options->entry_alignment = defaults.entryAlignment;
+    options->qgram_size = defaults.qgramSize;
+
+    options->exact_hash = defaults.exactHash;
+    options->deletion_index_k = defaults.deletionIndexK;
+    options->partition_index_k = defaults.partitionIndexK;
+    options->planner = defaults.planner;
+
+    options->fingerprint_groups = defaults.fingerprintGroups;
+    options->fingerprint_neighborhood = defaults.fingerprintNeighborhood;
+    options->popcount_buckets = defaults.popcountBuckets;
+    options->packed_words = defaults.packedWords;
+    options->front_coding = defaults.frontCoding;
+
+    options->normalization_table = nullptr;
+    options->utf8 = defaults.utf8;
+}
+
+fp_status fp_index_create(const fp_options *options, fp_index **index)
+{
+    if (options == nullptr or index == nullptr)
+    {
+        return fail(FP_ERROR_INVALID_ARGUMENT, "null options or index");
+    }
+    if (options->distance_type < FP_DISTANCE_HAM or options->distance_type > FP_DISTANCE_OSA
+        or options->fingerprint_type < FP_FINGERPRINT_NONE or options->fingerprint_type > FP_FINGERPRINT_QGRAM
+        or options->letters_type < FP_LETTERS_COMMON or options->letters_type > FP_LETTERS_RARE)
+    {
+        return fail(FP_ERROR_INVALID_ARGUMENT, "bad distance, fingerprint, or letters type");
+    }
+
+    *index = nullptr;
+
+    return guard([&]
+    {
+        IndexOptions indexOptions;
+
+        indexOptions.entryAlignment = options->entry_alignment;
+        indexOptions.qgramSize = options->qgram_size;
+
+        indexOptions.exactHash = options->exact_hash != 0;
+        indexOptions.deletionIndexK = options->deletion_index_k;
+        indexOptions.partitionIndexK = options->partition_index_k;
+        indexOptions.planner = options->planner != 0;
+
+        indexOptions.fingerprintGroups = options->fingerprint_groups != 0;
+        indexOptions.fingerprintNeighborhood = options->fingerprint_neighborhood != 0;
+        indexOptions.popcountBuckets = options->popcount_buckets != 0;
+        indexOptions.packedWords = options->packed_words != 0;
+        indexOptions.frontCoding = options->front_coding != 0;
+
+        if (options->normalization_table != nullptr)
+        {
+            indexOptions.normalizationTable.assign(options->normalization_table, options->normalization_table + 256);
+        }
+
+        indexOptions.utf8 = options->utf8 != 0;
+
+        // The enumerations of the C interface follow the order of the enumerations of the engine.
+        *index = new fp_index(static_cast<Matcher::DistanceType>(options->distance_type),
+            static_cast<Matcher::FingerprintType>(options->fingerprint_type),
+            static_cast<Matcher::LettersType>(options->letters_type), indexOptions);
+    });
+}
+
+void fp_index_free(fp_index *index)
+{
+    delete index;
+}
+
+fp_status fp_index_build(fp_index *index, const char *const *words, const size_t *word_sizes, size_t n_words)
+{
+    if (index == nullptr or (n_words > 0 and (words == nullptr or word_sizes == nullptr)))
+    {
+        return fail(FP_ERROR_INVALID_ARGUMENT, "null index or words");
+    }
+
+    return guard([&]
+    {
+        vector<StringRef> wordRefs(n_words);
+
+        for (size_t i = 0; i < n_words; ++i)
+        {
+            wordRefs[i] = { words[i], word_sizes[i] };
+        }
+
+        index->matcher.build(wordRefs.data(), wordRefs.size());
+    });
+}
+
+fp_status fp_index_load(fp_index *index, const char *dict_path)
+{
+    if (index == nullptr or dict_path == nullptr)
+    {
+        return fail(FP_ERROR_INVALID_ARGUMENT, "null index or dictionary path");
+    }
+    if (not Helpers::isFileReadable(dict_path))
+    {
+        return fail(FP_ERROR_IO, "failed to read file: " + string(dict_path));
+    }
+
+    return guard([&]
+    {
+        index->matcher.load(dict_path);
+    });
+}
+
+fp_status fp_context_create(fp_context **context)
+{
+    if (context == nullptr)
+    {
+        return fail(FP_ERROR_INVALID_ARGUMENT, "null context");
+    }
+
+    *context = nullptr;
+
+    return guard([&]
+    {
+        *context = new fp_context();
+    });
+}
+
+void fp_context_free(fp_context *context)
+{
+    delete context;
+}
+
+fp_status fp_query(const fp_index *index, fp_context *context, const char *const *patterns, const size_t *pattern_sizes,
+    size_t n_patterns, int k, uint32_t *n_matches, size_t *n_all_matches)
+{
+    if (index == nullptr or context == nullptr or (n_patterns > 0 and (patterns == nullptr or pattern_sizes == nullptr)))
+    {
+        return fail(FP_ERROR_INVALID_ARGUMENT, "null index, context, or patterns");
+    }
+
+    return guard([&]
+    {
+        context->patternRefs.resize(n_patterns);
+
+        for (size_t i = 0; i < n_patterns; ++i)
+        {
+            context->patternRefs[i] = { patterns[i], pattern_sizes[i] };
+        }
+
+        const size_t nAllMatches = index->matcher.query(context->context, context->patternRefs.data(), n_patterns, k, n_matches);
+
+        if (n_all_matches != nullptr)
+        {
+            *n_all_matches = nAllMatches;
+        }
+    });
+}
+
+const char *fp_get_last_error(void)
+{
+    return lastError.c_str();
+}
+
+}
@@ -0,0 +1,97 @@
+#ifndef FINGERPRINTS_C_H
+#define FINGERPRINTS_C_H
+
+/* The C interface of the fingerprints library (libfingerprints.a and libfingerprints.so built with "make lib"),
+ * a thin layer over the Matcher class for callers which cannot use C++. Indexes and query contexts are opaque handles.
+ * Each function returns a status code, and the message of the last error in the calling thread is kept
+ * by fp_get_last_error. Queries do not modify an index, hence threads can share one as long as each of them
+ * passes its own context. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    FP_OK = 0,
+    /** A null handle or buffer, or an argument rejected by the index (e.g. negative k or bad options). */
+    FP_ERROR_INVALID_ARGUMENT,
+    /** The dictionary file could not be read. */
+    FP_ERROR_IO,
+    FP_ERROR_OUT_OF_MEMORY,
+    FP_ERROR_INTERNAL
+} fp_status;
+
+typedef enum { FP_DISTANCE_HAM, FP_DISTANCE_LEV, FP_DISTANCE_OSA } fp_distance_type;
+typedef enum { FP_FINGERPRINT_NONE, FP_FINGERPRINT_OCC, FP_FINGERPRINT_OCC_HALVED, FP_FINGERPRINT_COUNT,
+    FP_FINGERPRINT_POS, FP_FINGERPRINT_QGRAM } fp_fingerprint_type;
+typedef enum { FP_LETTERS_COMMON, FP_LETTERS_MIXED, FP_LETTERS_RARE } fp_letters_type;
+
+/** Parameters of an index, consult params.hpp and IndexOptions in fingerprints.hpp for more information.
+ * Boolean options are enabled by non-zero values. */
+typedef struct
+{
+    fp_distance_type distance_type;
+    fp_fingerprint_type fingerprint_type;
+    fp_letters_type letters_type;
+
+    size_t entry_alignment;
+    size_t qgram_size;
+
+    int exact_hash;
+    int deletion_index_k;
+    int partition_index_k;
+    int planner;
+
+    int fingerprint_groups;
+    int fingerprint_neighborhood;
+    int popcount_buckets;
+    int packed_words;
+    int front_coding;
+
+    /** If not null, a table of 256 bytes which maps the bytes of the words and the patterns, it is copied. */
+    const unsigned char *normalization_table;
+    int utf8;
+} fp_options;
+
+typedef struct fp_index fp_index;
+typedef struct fp_context fp_context;
+
+/** Sets [options] to the defaults: Hamming distance, occurrence fingerprints over common letters, no additional indexes. */
+void fp_options_init(fp_options *options);
+
+/** Creates an index without any words with [options] and stores its handle in [index]. */
+fp_status fp_index_create(const fp_options *options, fp_index **index);
+/** Frees [index], null is ignored. */
+void fp_index_free(fp_index *index);
+
+/** Builds [index] over [n_words] words, word i has [word_sizes][i] chars starting at [words][i].
+ * On failure the previous words are kept. */
+fp_status fp_index_build(fp_index *index, const char *const *words, const size_t *word_sizes, size_t n_words);
+/** Builds [index] over the words read from the file with [dict_path], separated with newlines.
+ * On failure the previous words are kept. */
+fp_status fp_index_load(fp_index *index, const char *dict_path);
+
+/** Creates a query context (reusable scratch space of a thread) and stores its handle in [context]. */
+fp_status fp_context_create(fp_context **context);
+/** Frees [context], null is ignored. */
+void fp_context_free(fp_context *context);
+
+/** Performs approximate matching for [n_patterns] patterns and [k] errors using [context], pattern i has
+ * [pattern_sizes][i] chars starting at [patterns][i]. Writes the number of matches for pattern i into [n_matches][i]
+ * if [n_matches] is not null, and the total number of matches into [n_all_matches] if it is not null. */
+fp_status fp_query(const fp_index *index, fp_context *context, const char *const *patterns, const size_t *pattern_sizes,
+    size_t n_patterns, int k, uint32_t *n_matches, size_t *n_all_matches);
+
+/** Returns the message of the last error in the calling thread, an empty string if there was none.
+ * The message is valid until the next failing call in this thread. */
+const char *fp_get_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FINGERPRINTS_C_H */
@@ -0,0 +1,122 @@
+#ifndef HASH_POSTINGS_HPP
+#define HASH_POSTINGS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "index_memory.hpp"
+
+namespace fingerprints
+{
+
+/** A static multimap from 32-bit hashes to 32-bit ids, used by the candidate indexes of Fingerprints.
+ * Pairs (hash, id) are sorted by hash and stored as two arrays, with a directory indexed by the top bits
+ * of a hash on top of them. Keys are not stored, hence hash collisions only add ids which must be verified. */
+class HashPostings
+{
+public:
+    /** Builds the postings from [pairs], each of them holding a hash in the high half and an id in the low half,
+     * [pairs] are sorted in place. Throws invalid_argument if there are too many pairs. */
+    inline void build(std::vector<uint64_t> &pairs);
+    /** Removes all postings. */
+    inline void clear();
+    /** Locks the postings in RAM, returns true on success (see IndexMemory::lock). */
+    inline bool lock() const;
+
+    /** Calls [fun] with each id stored for [hash], in increasing order. */
+    template<typename Fun>
+    void forEachId(uint32_t hash, Fun fun) const;
+
+    /** Returns true if the postings were built (possibly from no pairs). */
+    bool isBuilt() const { return not directory.empty(); }
+    /** Returns the number of stored pairs. */
+    size_t getSize() const { return hashes.size(); }
+    /** Returns the number of bytes used by the postings. */
+    size_t getSizeB() const { return (hashes.size() + ids.size() + directory.size()) * sizeof(uint32_t); }
+
+private:
+    std::vector<uint32_t> hashes;
+    std::vector<uint32_t> ids;
+
+    /** Indexed by the top directoryBits bits of a hash, points to the first pair having these bits,
+     * the range ends at the next element. */
+    std::vector<uint32_t> directory;
+    size_t directoryBits = 0;
+};
+
+void HashPostings::build(std::vector<uint64_t> &pairs)
+{
+    if (pairs.size() >= std::numeric_limits<uint32_t>::max())
+    {
+        throw std::invalid_argument("too many postings: " + std::to_string(pairs.size()));
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+
+    // Between 2 and 4 pairs per directory slot.
+    directoryBits = 1;
+
+    while (directoryBits < 31 and (size_t(1) << (directoryBits + 2)) <= pairs.size())
+    {
+        directoryBits += 1;
+    }
+
+    const size_t nDirectorySlots = size_t(1) << directoryBits;
+
+    hashes.resize(pairs.size());
+    ids.resize(pairs.size());
+    directory.assign(nDirectorySlots + 1, 0);
+
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+        hashes[i] = pairs[i] >> 32;
+        ids[i] = static_cast<uint32_t>(pairs[i]);
+
+        directory[(hashes[i] >> (32 - directoryBits)) + 1] += 1;
+    }
+
+    for (size_t iSlot = 0; iSlot < nDirectorySlots; ++iSlot)
+    {
+        directory[iSlot + 1] += directory[iSlot];
+    }
+}
+
+void HashPostings::clear()
+{
+    std::vector<uint32_t>().swap(hashes);
+    std::vector<uint32_t>().swap(ids);
+    std::vector<uint32_t>().swap(directory);
+
+    directoryBits = 0;
+}
+
+bool HashPostings::lock() const
+{
+    const bool hashesLocked = IndexMemory::lock(hashes);
+    const bool idsLocked = IndexMemory::lock(ids);
+
+    return IndexMemory::lock(directory) and hashesLocked and idsLocked;
+}
+
+template<typename Fun>
+void HashPostings::forEachId(uint32_t hash, Fun fun) const
+{
+    const size_t iSlot = hash >> (32 - directoryBits);
+
+    for (size_t i = directory[iSlot]; i < directory[iSlot + 1] and hashes[i] <= hash; ++i)
+    {
+        if (hashes[i] == hash)
+        {
+            fun(ids[i]);
+        }
+    }
+}
+
+} // namespace fingerprints
+
+#endif // HASH_POSTINGS_HPP
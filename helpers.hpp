@@ -3,6 +3,7 @@
 
 #include <boost/algorithm/string.hpp>
 #include <fstream>
+#include <random>
 #include <set>
 #include <sstream>
 #include <stdexcept>
@@ -0,0 +1,142 @@
+#ifndef INDEX_MEMORY_HPP
+#define INDEX_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace fingerprints
+{
+
+/** Allocates the large arrays of the index, optionally backed by huge pages. */
+class IndexMemory
+{
+public:
+    IndexMemory() = delete;
+
+    enum class Type { Default, HugePages };
+    /** Describes how a given block was actually allocated, which is needed in order to release it. */
+    enum class Backing { Heap, HugeTLB, TransparentHugePages };
+
+    /** Returns [size] zeroed bytes allocated according to [type] and sets [backing] accordingly.
+     * For huge pages, tries explicit huge pages (MAP_HUGETLB) first, then transparent huge pages (MADV_HUGEPAGE),
+     * and falls back to the heap if neither is available. Throws bad_alloc on failure. */
+    inline static char *allocate(size_t size, Type type, Backing &backing);
+    /** Releases [ptr] of [size] bytes previously returned from allocate with [backing]. */
+    inline static void release(char *ptr, size_t size, Backing backing);
+
+    /** Faults in and locks in RAM [size] bytes starting at [ptr], returns true on success.
+     * May fail when exceeding RLIMIT_MEMLOCK, in which case the memory stays usable but unlocked. */
+    inline static bool lock(const char *ptr, size_t size);
+    /** Locks the elements of [vec] in RAM as above, for the index arrays which are not allocated here. */
+    template<typename T>
+    static bool lock(const std::vector<T> &vec);
+
+    /** Size of a single huge page, huge page allocations are rounded up to a multiple of this size. */
+    static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+private:
+    /** Returns [size] rounded up to the huge page size. */
+    inline static size_t roundToHugePages(size_t size);
+};
+
+char *IndexMemory::allocate(size_t size, Type type, Backing &backing)
+{
+    if (size == 0)
+    {
+        size = 1;
+    }
+
+#ifdef __linux__
+    if (type == Type::HugePages)
+    {
+        const size_t mappedSize = roundToHugePages(size);
+
+        // Explicit huge pages must be reserved by the administrator (vm.nr_hugepages), otherwise this fails immediately.
+        // Anonymous mappings are zeroed and MAP_POPULATE faults in all pages up front.
+        void *ptr = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+
+        if (ptr != MAP_FAILED)
+        {
+            backing = Backing::HugeTLB;
+            return static_cast<char *>(ptr);
+        }
+
+        // Transparent huge pages require a huge page aligned region, the advice is only a hint.
+        void *alignedPtr = nullptr;
+
+        if (posix_memalign(&alignedPtr, hugePageSize, mappedSize) == 0)
+        {
+            madvise(alignedPtr, mappedSize, MADV_HUGEPAGE);
+            memset(alignedPtr, 0, mappedSize);
+
+            backing = Backing::TransparentHugePages;
+            return static_cast<char *>(alignedPtr);
+        }
+    }
+#endif
+
+    backing = Backing::Heap;
+    return new char[size]();
+}
+
+void IndexMemory::release(char *ptr, size_t size, Backing backing)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    switch (backing)
+    {
+        case Backing::Heap:
+            delete[] ptr;
+            break;
+#ifdef __linux__
+        case Backing::HugeTLB:
+            munmap(ptr, roundToHugePages(size == 0 ? 1 : size));
+            break;
+#endif
+        case Backing::TransparentHugePages:
+            free(ptr);
+            break;
+        default:
+            break;
+    }
+}
+
+bool IndexMemory::lock(const char *ptr, size_t size)
+{
+#ifdef __linux__
+    if (ptr == nullptr or size == 0)
+    {
+        return true;
+    }
+
+    return mlock(ptr, size) == 0;
+#else
+    return false;
+#endif
+}
+
+template<typename T>
+bool IndexMemory::lock(const std::vector<T> &vec)
+{
+    return lock(reinterpret_cast<const char *>(vec.data()), vec.size() * sizeof(T));
+}
+
+size_t IndexMemory::roundToHugePages(size_t size)
+{
+    return (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+}
+
+} // namespace fingerprints
+
+#endif // INDEX_MEMORY_HPP
@@ -14,6 +14,11 @@
 #include "fingerprints.hpp"
 #include "fingerprints.cpp"
 
+#include "bk_tree.hpp"
+#include "bk_tree.cpp"
+#include "dawg.hpp"
+#include "dawg.cpp"
+
 #include "helpers.hpp"
 #include "params.hpp"
 
@@ -46,11 +51,21 @@ int run();
 void filterInput(vector<string> &dict, vector<string> &patterns);
 
 void runFingerprints(const vector<string> &words, const vector<string> &patterns);
+void runBKTree(const vector<string> &words, const vector<string> &patterns);
+void runDawg(const vector<string> &words, const vector<string> &patterns);
 void initFingerprintParams(Fingerprints<FING_T>::DistanceType &distanceType,
     Fingerprints<FING_T>::FingerprintType &fingerprintType,
     Fingerprints<FING_T>::LettersType &lettersType);
+void initIndexOptions(IndexOptions &indexOptions);
+
+/** Returns a human-readable description of [backing]. */
+string memoryBackingToString(IndexMemory::Backing backing);
 
 void dumpParamInfoToStdout(int fingSizeB);
+/** Prints the calibrated planner costs for the current k if [dumpCosts] is true,
+ * and the number of queries answered with each plan during the last test otherwise. */
+void dumpPlanInfo(const Fingerprints<FING_T> &fingerprints, bool dumpCosts);
+void dumpConstructionInfo(float elapsedTotalUs, const vector<string> &words);
 void dumpRunInfo(float elapsedUs, const vector<string> &words, size_t processedWordsCount);
 
 }
@@ -78,22 +93,36 @@ int handleParams(int argc, const char **argv)
 {
     po::options_description options("Parameters");
     options.add_options()
+       ("align", po::value<int>(&params.entryAlignment)->default_value(1), "pad dictionary entries to a multiple of this many bytes: 1 (packed), 2, 4, 8, 16")
        ("calc-rejection", "calculate percentages of rejected words instead of measuring time")
        ("dump,d", "dump input files and params info with elapsed time and throughput to output file (useful for testing)")
        ("dump-construction", "dump fingerprint construction time")
-       ("distance,D", po::value<string>(&params.distanceType)->default_value("ham"), "distance metric: ham (Hamming), lev (Levenshtein)")
-       ("fingerprint-type,f", po::value<string>(&params.fingerprintType)->default_value("occ"), "fingerprint type: none, occ (occurrence), occhalved (occurrence halved), count, pos (position)")
+       ("distance,D", po::value<string>(&params.distanceType)->default_value("ham"), "distance metric: ham (Hamming), lev (Levenshtein), osa (optimal string alignment, i.e. Levenshtein with adjacent swaps)")
+       ("engine", po::value<string>(&params.engine)->default_value("fingerprints"), "search engine: fingerprints (fingerprint scan), bktree (BK-tree, Levenshtein distance only), deletion (deletion index for k <= 4 verified as the scan), partition (pigeonhole partition index for k <= 8 verified as the scan, for long words), planner (scans, exact hash, and the indexes chosen per query by a cost model calibrated during construction), dawg (Levenshtein automaton over a DAWG, Levenshtein distance only)")
+       ("exact-hash", "build a hash table over the dictionary, used instead of scanning for k = 0")
+       ("fingerprint-groups", "sort each size bucket by fingerprint and test each distinct fingerprint once, requires fingerprints")
+       ("fingerprint-neighborhood", "enumerate the fingerprints passing the comparison with the pattern fingerprint and look them up, implies --fingerprint-groups")
+       ("fingerprint-type,f", po::value<string>(&params.fingerprintType)->default_value("occ"), "fingerprint type: none, occ (occurrence), occhalved (occurrence halved), count, pos (position), qgram (hashed q-grams)")
+       ("front-coding", "store the words of each size bucket sorted and front coded, and reuse the rows calculated for shared prefixes, the dictionary array is dropped unless --exact-hash or another index needs it, Levenshtein distance only")
        ("help,h", "display help message")
+       ("huge-pages", "allocate the dictionary array using huge pages (the arrays of the additional indexes use regular pages), falls back to regular pages if unavailable")
        ("in-dict-file,i", po::value<string>(&params.inDictFile)->required(), "input dictionary file path (positional arg 1)")
        ("in-pattern-file,I", po::value<string>(&params.inPatternFile)->required(), "input pattern file path (positional arg 2)")
        ("iter", po::value<int>(&params.nIter)->default_value(1), "number of iterations per pattern lookup")
        ("approx,k", po::value<int>(&params.kApprox)->required(), "perform approximate search (Hamming or Levenshtein) for k errors")
        ("letters-type,l", po::value<string>(&params.lettersType)->default_value("common"), "letters type: common, mixed, rare")
+       ("lock-memory", "lock the index (the dictionary array and the arrays of all additional indexes) in RAM after construction in order to avoid page faults during queries")
+       ("normalize", po::value<string>(&params.normalization)->default_value("none"), "normalize the dictionary and the patterns: none, case (ASCII case folding), latin1 (case folding and stripping diacritics from ISO 8859-1 letters)")
+       ("normalize-map", po::value<string>(&params.normalizationMap), "additional normalization given as pairs of bytes, each pair maps its first byte to the second one, e.g. \"-_\" maps hyphens to underscores")
        ("out-file,o", po::value<string>(&params.outFile)->default_value("res.txt"), "output file path")
+       ("packed-words", "store the words with the dictionary alphabet packed into 4 or 5 bits per char and compare them lane by lane in scans without fingerprints, Hamming distance only, at most 31 distinct chars")
        ("pattern-count,p", po::value<int>(&params.nPatterns), "maximum number of patterns read from top of the pattern file (non-positive values are ignored)")
        ("pattern-size", po::value<int>(&params.patternSize), "if set, only patterns of this size (letter count) will be read from the pattern file (non-positive values are ignored)")
+       ("popcount-buckets", "split each size bucket by fingerprint popcount and skip the sub-buckets which cannot pass the fingerprint comparison, requires fingerprints")
+       ("qgram-size", po::value<int>(&params.qgramSize)->default_value(2), "number of characters in a gram for qgram fingerprints: 2, 3")
        // Not using a default value from Boost for separator because it literally prints a newline.
        ("separator,s", po::value<string>(&params.separator), "input data (dictionary and patterns) separator (default = newline)")
+       ("utf8", "treat the dictionary and the patterns as UTF-8, word sizes and distances are calculated over code points")
        ("version,v", "display version info")
        ("word-count,w", po::value<int>(&params.nWords), "maximum number of words read from top of the dictionary file (non-positive values are ignored)");
 
@@ -146,6 +175,43 @@ int handleParams(int argc, const char **argv)
     {
         params.dumpToFile = true;
     }
+    if (vm.count("exact-hash"))
+    {
+        params.exactHash = true;
+    }
+    if (vm.count("fingerprint-groups"))
+    {
+        params.fingerprintGroups = true;
+    }
+    if (vm.count("fingerprint-neighborhood"))
+    {
+        params.fingerprintGroups = true;
+        params.fingerprintNeighborhood = true;
+    }
+    if (vm.count("front-coding"))
+    {
+        params.frontCoding = true;
+    }
+    if (vm.count("huge-pages"))
+    {
+        params.hugePages = true;
+    }
+    if (vm.count("lock-memory"))
+    {
+        params.lockMemory = true;
+    }
+    if (vm.count("packed-words"))
+    {
+        params.packedWords = true;
+    }
+    if (vm.count("popcount-buckets"))
+    {
+        params.popcountBuckets = true;
+    }
+    if (vm.count("utf8"))
+    {
+        params.utf8 = true;
+    }
 
     return paramsResContinue;
 }
@@ -183,7 +249,23 @@ int run()
         cout << "=====" << endl;
         cout << boost::format("Read #words = %1%, #queries = %2%") % dict.size() % patterns.size() << endl;
      
-        runFingerprints(dict, patterns);
+        if (params.engine == "fingerprints" or params.engine == "deletion" or params.engine == "partition"
+            or params.engine == "planner")
+        {
+            runFingerprints(dict, patterns);
+        }
+        else if (params.engine == "bktree")
+        {
+            runBKTree(dict, patterns);
+        }
+        else if (params.engine == "dawg")
+        {
+            runDawg(dict, patterns);
+        }
+        else
+        {
+            throw invalid_argument("bad engine: " + params.engine);
+        }
     }
     catch (const exception &e)
     {
@@ -222,22 +304,74 @@ void runFingerprints(const vector<string> &words, const vector<string> &patterns
 
     initFingerprintParams(distanceType, fingerprintType, lettersType);
 
-    Fingerprints<FING_T> fingerprints(distanceType, fingerprintType, lettersType);
+    IndexOptions indexOptions;
+    initIndexOptions(indexOptions);
+
+    Fingerprints<FING_T> fingerprints(distanceType, fingerprintType, lettersType, indexOptions);
     fingerprints.preprocess(words);
     
     cout << "Preprocessed #words = " << words.size() << endl;
 
-    if (params.dumpConstruction)
+    if (params.hugePages)
     {
-        float elapsedTotalUs = fingerprints.getElapsedUs();
-
-        size_t dictSizeB = Helpers::getTotalSize(words);
-        float dictSizeMB = static_cast<float>(dictSizeB) / 1'000'000.0f;
-
-        float throughputMBs = dictSizeMB / (elapsedTotalUs / 1'000'000.0f);
+        cout << "Index backing: " << memoryBackingToString(fingerprints.getFingArrayBacking()) << endl;
+    }
+    if (params.exactHash)
+    {
+        cout << "Exact hash size = " << fingerprints.getExactHashSizeB() << " bytes" << endl;
+    }
+    if (params.fingerprintGroups)
+    {
+        cout << boost::format("Fingerprint groups #groups = %1%, size = %2% bytes")
+            % fingerprints.getFingerprintGroupsCount() % fingerprints.getFingerprintGroupsSizeB() << endl;
+    }
+    if (params.frontCoding)
+    {
+        cout << boost::format("Front coded words size = %1% bytes, dictionary array size = %2% bytes")
+            % fingerprints.getFrontCodedSizeB() % fingerprints.getFingArraySizeB() << endl;
+    }
+    if (params.packedWords)
+    {
+        cout << boost::format("Packed words %1% bits per char, size = %2% bytes")
+            % fingerprints.getPackedBits() % fingerprints.getPackedWordsSizeB() << endl;
+    }
+    if (params.popcountBuckets)
+    {
+        cout << "Popcount buckets size = " << fingerprints.getPopcountBucketsSizeB() << " bytes" << endl;
+    }
+    if (params.fingerprintNeighborhood)
+    {
+        cout << "Fingerprint neighborhood size = " << fingerprints.getFingerprintNeighborhoodSizeB() << " bytes" << endl;
+    }
+    if (params.engine == "deletion")
+    {
+        cout << boost::format("Deletion index size = %1% bytes, #postings = %2%, dictionary array size = %3% bytes")
+            % fingerprints.getDeletionIndexSizeB() % fingerprints.getDeletionPostingsCount()
+            % fingerprints.getFingArraySizeB() << endl;
+    }
+    if (params.engine == "partition")
+    {
+        cout << boost::format("Partition index size = %1% bytes, #postings = %2%, dictionary array size = %3% bytes")
+            % fingerprints.getPartitionIndexSizeB() % fingerprints.getPartitionPostingsCount()
+            % fingerprints.getFingArraySizeB() << endl;
+    }
+    if (params.engine == "planner")
+    {
+        dumpPlanInfo(fingerprints, true);
+    }
+    if (fingerprints.getSharedCodePointsCount() > 0)
+    {
+        cout << boost::format("UTF-8 #code points sharing a code unit = %1%, results for words having them are approximate")
+            % fingerprints.getSharedCodePointsCount() << endl;
+    }
+    if (params.lockMemory and fingerprints.isMemoryLocked() == false)
+    {
+        cout << "Failed to lock the index in RAM (check ulimit -l), continuing unlocked" << endl;
+    }
 
-         cout << boost::format("Construction: thru = %1% MB/s, elapsed = %2% us") 
-            % throughputMBs % elapsedTotalUs << endl;
+    if (params.dumpConstruction)
+    {
+        dumpConstructionInfo(fingerprints.getElapsedUs(), words);
     }
 
     cout << "Testing #queries = " << patterns.size() << endl;
@@ -258,10 +392,95 @@ void runFingerprints(const vector<string> &words, const vector<string> &patterns
         size_t processedWordsCount = fingerprints.getProcessedWordsCount();
         cout << "Total (all patterns) processed #words = " << processedWordsCount << endl;
 
+        if (params.engine == "planner")
+        {
+            dumpPlanInfo(fingerprints, false);
+        }
+
         dumpRunInfo(elapsedPerIterUs, words, processedWordsCount);
     }
 }
 
+void runBKTree(const vector<string> &words, const vector<string> &patterns)
+{
+    if (params.distanceType != "lev")
+    {
+        throw invalid_argument("bk-tree engine supports only the Levenshtein distance, got: " + params.distanceType);
+    }
+    if (params.calcRejection or params.utf8 or params.normalization != "none" or not params.normalizationMap.empty())
+    {
+        throw invalid_argument("bk-tree engine does not support rejection calculation, normalization, or UTF-8 mode");
+    }
+
+    dumpParamInfoToStdout(0);
+
+    BKTree bkTree;
+    bkTree.preprocess(words);
+
+    cout << "Preprocessed #words = " << words.size() << endl;
+    cout << boost::format("BK-tree #nodes = %1%, depth = %2%, size = %3% bytes")
+        % bkTree.getNodesCount() % bkTree.getDepth() % bkTree.getSizeB() << endl;
+
+    if (params.dumpConstruction)
+    {
+        dumpConstructionInfo(bkTree.getElapsedUs(), words);
+    }
+
+    cout << "Testing #queries = " << patterns.size() << endl;
+
+    int nMatches = bkTree.test(patterns, params.kApprox, params.nIter);
+    cout << "Got #matches = " << nMatches << endl;
+
+    float elapsedTotalUs = bkTree.getElapsedUs();
+    float elapsedPerIterUs = elapsedTotalUs / static_cast<float>(params.nIter);
+
+    // For the BK-tree, processed words are the visited nodes, i.e. the words for which the distance was calculated.
+    size_t processedWordsCount = bkTree.getProcessedWordsCount();
+    cout << "Total (all patterns) processed #words = " << processedWordsCount << endl;
+
+    dumpRunInfo(elapsedPerIterUs, words, processedWordsCount);
+}
+
+void runDawg(const vector<string> &words, const vector<string> &patterns)
+{
+    if (params.distanceType != "lev")
+    {
+        throw invalid_argument("dawg engine supports only the Levenshtein distance, got: " + params.distanceType);
+    }
+    if (params.calcRejection or params.utf8 or params.normalization != "none" or not params.normalizationMap.empty())
+    {
+        throw invalid_argument("dawg engine does not support rejection calculation, normalization, or UTF-8 mode");
+    }
+
+    dumpParamInfoToStdout(0);
+
+    Dawg dawg;
+    dawg.preprocess(words);
+
+    cout << "Preprocessed #words = " << words.size() << endl;
+    cout << boost::format("DAWG #nodes = %1%, #edges = %2%, size = %3% bytes")
+        % dawg.getNodesCount() % dawg.getEdgesCount() % dawg.getSizeB() << endl;
+
+    if (params.dumpConstruction)
+    {
+        dumpConstructionInfo(dawg.getElapsedUs(), words);
+    }
+
+    cout << "Testing #queries = " << patterns.size() << endl;
+
+    int nMatches = dawg.test(patterns, params.kApprox, params.nIter);
+    cout << "Got #matches = " << nMatches << endl;
+
+    float elapsedTotalUs = dawg.getElapsedUs();
+    float elapsedPerIterUs = elapsedTotalUs / static_cast<float>(params.nIter);
+
+    // For the DAWG, processed words are the visited nodes, i.e. the calculated rows.
+    size_t processedWordsCount = dawg.getProcessedWordsCount();
+    cout << "Total (all patterns) processed #words = " << processedWordsCount << endl;
+
+    dumpRunInfo(elapsedPerIterUs, words, processedWordsCount);
+}
+
 void initFingerprintParams(Fingerprints<FING_T>::DistanceType &distanceType,
     Fingerprints<FING_T>::FingerprintType &fingerprintType,
     Fingerprints<FING_T>::LettersType &lettersType)
@@ -274,6 +493,10 @@ void initFingerprintParams(Fingerprints<FING_T>::DistanceType &distanceType,
     {
         distanceType = Fingerprints<FING_T>::DistanceType::Lev;
     }
+    else if (params.distanceType == "osa")
+    {
+        distanceType = Fingerprints<FING_T>::DistanceType::Osa;
+    }
     else
     {
         throw invalid_argument("bad distance type: " + params.distanceType);
@@ -299,6 +522,10 @@ void initFingerprintParams(Fingerprints<FING_T>::DistanceType &distanceType,
     {
         fingerprintType = Fingerprints<FING_T>::FingerprintType::Pos;
     }
+    else if (params.fingerprintType == "qgram")
+    {
+        fingerprintType = Fingerprints<FING_T>::FingerprintType::QGram;
+    }
     else
     {
         throw invalid_argument("bad fingerprint type: " + params.fingerprintType);
@@ -322,9 +549,118 @@ void initFingerprintParams(Fingerprints<FING_T>::DistanceType &distanceType,
     }
 }
 
+void initIndexOptions(IndexOptions &indexOptions)
+{
+    if (params.entryAlignment <= 0)
+    {
+        throw invalid_argument("bad entry alignment: " + to_string(params.entryAlignment));
+    }
+
+    indexOptions.entryAlignment = params.entryAlignment;
+
+    indexOptions.memoryType = params.hugePages ? IndexMemory::Type::HugePages : IndexMemory::Type::Default;
+    indexOptions.lockMemory = params.lockMemory;
+
+    indexOptions.exactHash = params.exactHash;
+    indexOptions.fingerprintGroups = params.fingerprintGroups;
+    indexOptions.fingerprintNeighborhood = params.fingerprintNeighborhood;
+    indexOptions.popcountBuckets = params.popcountBuckets;
+    indexOptions.packedWords = params.packedWords;
+    indexOptions.frontCoding = params.frontCoding;
+
+    if (params.engine == "deletion")
+    {
+        indexOptions.deletionIndexK = params.kApprox;
+    }
+    if (params.engine == "partition")
+    {
+        indexOptions.partitionIndexK = params.kApprox;
+    }
+    if (params.engine == "planner")
+    {
+        // All the indexes which are cheap to build, the deletion index grows quickly with k.
+        indexOptions.planner = true;
+        indexOptions.exactHash = true;
+        indexOptions.partitionIndexK = (params.kApprox <= 8) ? params.kApprox : -1;
+        indexOptions.deletionIndexK = (params.kApprox <= 1) ? params.kApprox : -1;
+    }
+
+    if (params.qgramSize <= 0)
+    {
+        throw invalid_argument("bad q-gram size: " + to_string(params.qgramSize));
+    }
+
+    indexOptions.qgramSize = params.qgramSize;
+    indexOptions.utf8 = params.utf8;
+
+    if (params.normalizationMap.size() % 2 != 0)
+    {
+        throw invalid_argument("bad normalization map: " + params.normalizationMap);
+    }
+
+    if (params.normalization == "none")
+    {
+        if (params.normalizationMap.empty())
+        {
+            return;
+        }
+
+        indexOptions.normalizationTable = Normalization::makeTable(Normalization::Type::Identity);
+    }
+    else if (params.normalization == "case")
+    {
+        indexOptions.normalizationTable = Normalization::makeTable(Normalization::Type::Case);
+    }
+    else if (params.normalization == "latin1")
+    {
+        indexOptions.normalizationTable = Normalization::makeTable(Normalization::Type::Latin1);
+    }
+    else
+    {
+        throw invalid_argument("bad normalization: " + params.normalization);
+    }
+
+    string from, to;
+
+    for (size_t i = 0; i < params.normalizationMap.size(); i += 2)
+    {
+        from += params.normalizationMap[i];
+        to += params.normalizationMap[i + 1];
+    }
+
+    Normalization::addMapping(indexOptions.normalizationTable, from, to);
+}
+
+string memoryBackingToString(IndexMemory::Backing backing)
+{
+    switch (backing)
+    {
+        case IndexMemory::Backing::HugeTLB:
+            return "explicit huge pages";
+        case IndexMemory::Backing::TransparentHugePages:
+            return "transparent huge pages";
+        default:
+            return "regular pages";
+    }
+}
+
 void dumpParamInfoToStdout(int fingSizeB)
 {
     cout << "Using distance: " << params.distanceType << endl;
+
+    if (params.engine != "fingerprints")
+    {
+        cout << "Using engine: " << params.engine << endl;
+    }
+
+    if (params.engine == "bktree" or params.engine == "dawg")
+    {
+        cout << "Using k = " << params.kApprox << endl;
+        cout << "#iterations = " << params.nIter << endl << endl;
+
+        return;
+    }
+
     cout << boost::format("Using fingerprint type: %1%, size = %2% bytes") % params.fingerprintType % fingSizeB << endl; 
 
     if (params.patternSize != Params::noValue)
@@ -333,10 +669,69 @@ void dumpParamInfoToStdout(int fingSizeB)
     }
 
     cout << "Using letters type: " << params.lettersType << endl;
+
+    if (params.fingerprintType == "qgram")
+    {
+        cout << "Using q-gram size = " << params.qgramSize << endl;
+    }
+
+    if (params.entryAlignment != 1)
+    {
+        cout << "Using entry alignment = " << params.entryAlignment << endl;
+    }
+
     cout << "Using k = " << params.kApprox << endl;
     cout << "#iterations = " << params.nIter << endl << endl;
 }
 
+void dumpPlanInfo(const Fingerprints<FING_T> &fingerprints, bool dumpCosts)
+{
+    using Plan = Fingerprints<FING_T>::Plan;
+
+    string info;
+
+    for (size_t iPlan = 0; iPlan < Fingerprints<FING_T>::nPlans; ++iPlan)
+    {
+        const Plan plan = static_cast<Plan>(iPlan);
+
+        if (dumpCosts)
+        {
+            const float unitCostNs = fingerprints.getPlanUnitCostNs(plan, params.kApprox);
+
+            if (unitCostNs >= 0.0f)
+            {
+                info += (boost::format("%1%%2% = %3% ns") % (info.empty() ? "" : ", ")
+                    % Fingerprints<FING_T>::getPlanName(plan) % unitCostNs).str();
+            }
+        }
+        else
+        {
+            info += (boost::format("%1%%2% = %3%") % (info.empty() ? "" : ", ")
+                % Fingerprints<FING_T>::getPlanName(plan) % fingerprints.getPlanCount(plan)).str();
+        }
+    }
+
+    if (dumpCosts)
+    {
+        cout << "Planner unit costs: " << (info.empty() ? "not calibrated for this k" : info) << endl;
+    }
+    else
+    {
+        cout << "Planned #queries: " << info << endl;
+    }
+}
+
+void dumpConstructionInfo(float elapsedTotalUs, const vector<string> &words)
+{
+    size_t dictSizeB = Helpers::getTotalSize(words);
+    float dictSizeMB = static_cast<float>(dictSizeB) / 1'000'000.0f;
+
+    float throughputMBs = dictSizeMB / (elapsedTotalUs / 1'000'000.0f);
+
+    cout << boost::format("Construction: thru = %1% MB/s, elapsed = %2% us") 
+        % throughputMBs % elapsedTotalUs << endl;
+}
+
 void dumpRunInfo(float elapsedUs, const vector<string> &words, size_t processedWordsCount)
 {
     size_t dictSizeB = Helpers::getTotalSize(words);
@@ -348,7 +743,8 @@ void dumpRunInfo(float elapsedUs, const vector<string> &words, size_t processedW
     if (params.dumpToFile)
     {
         string outStr = (boost::format("%1% %2% %3% %4% %5% %6% %7%") % params.inDictFile % params.inPatternFile % dictSizeMB
-            % params.distanceType % params.fingerprintType % params.lettersType % elapsedPerWordNs).str();
+            % params.distanceType % (params.engine == "fingerprints" ? params.fingerprintType : params.engine)
+            % params.lettersType % elapsedPerWordNs).str();
 
         Helpers::dumpToFile(outStr, params.outFile, true);
         cout << "Dumped info to: " << params.outFile << endl << endl;
@@ -0,0 +1,81 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "matcher.hpp"
+#include "fingerprints.cpp"
+
+#include "helpers.hpp"
+
+using namespace std;
+
+namespace fingerprints
+{
+
+// The library exposes a single fingerprint width, the engine is compiled once here.
+template class Fingerprints<uint16_t>;
+
+Matcher::Matcher(DistanceType distanceType, FingerprintType fingerprintType, LettersType lettersType,
+    const IndexOptions &indexOptions)
+    :distanceType(distanceType), fingerprintType(fingerprintType), lettersType(lettersType), indexOptions(indexOptions)
+{
+    build(nullptr, 0);
+}
+
+Matcher::~Matcher() = default;
+
+void Matcher::build(const StringRef *words, size_t nWords)
+{
+    vector<string> wordsVec;
+    wordsVec.reserve(nWords);
+
+    for (size_t i = 0; i < nWords; ++i)
+    {
+        wordsVec.emplace_back(words[i].data, words[i].size);
+    }
+
+    // A fresh engine is constructed, so that a failed build leaves the previous index intact.
+    unique_ptr<Engine> newEngine(new Engine(distanceType, fingerprintType, lettersType, indexOptions));
+    newEngine->preprocess(wordsVec);
+
+    engine = move(newEngine);
+}
+
+void Matcher::load(const string &dictPath, const string &separator)
+{
+    const vector<string> words = Helpers::readWords(dictPath, separator);
+    vector<StringRef> wordRefs;
+    wordRefs.reserve(words.size());
+
+    for (const string &word : words)
+    {
+        wordRefs.push_back({ word.data(), word.size() });
+    }
+
+    build(wordRefs.data(), wordRefs.size());
+}
+
+size_t Matcher::query(QueryContext &context, const StringRef *patterns, size_t nPatterns, int k, uint32_t *nMatches) const
+{
+    if (k < 0)
+    {
+        throw invalid_argument("bad k: " + to_string(k));
+    }
+
+    size_t nAllMatches = 0;
+
+    for (size_t i = 0; i < nPatterns; ++i)
+    {
+        const int nCurMatches = engine->testPattern(context, patterns[i].data, patterns[i].size, k);
+        nAllMatches += nCurMatches;
+
+        if (nMatches != nullptr)
+        {
+            nMatches[i] = nCurMatches;
+        }
+    }
+
+    return nAllMatches;
+}
+
+} // namespace fingerprints
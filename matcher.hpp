@@ -0,0 +1,64 @@
+#ifndef MATCHER_HPP
+#define MATCHER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "fingerprints.hpp"
+
+namespace fingerprints
+{
+
+/** A non-owning view of [size] chars starting at [data], which need not be null terminated. */
+struct StringRef
+{
+    const char *data;
+    size_t size;
+};
+
+/** The interface of the fingerprints library (libfingerprints.a and libfingerprints.so built with "make lib"),
+ * which wraps an index over a dictionary with 16-bit fingerprints. Words and patterns are passed as arrays
+ * of StringRef and results are written into buffers owned by the caller, so that no containers cross the interface.
+ * Queries do not modify the index, hence threads can share a matcher as long as each of them passes its own context. */
+class Matcher
+{
+public:
+    using Engine = Fingerprints<uint16_t>;
+    using DistanceType = Engine::DistanceType;
+    using FingerprintType = Engine::FingerprintType;
+    using LettersType = Engine::LettersType;
+    using QueryContext = Engine::QueryContext;
+
+    /** Constructs a matcher without any words for [distanceType], [fingerprintType], and [lettersType],
+     * with index layout set by [indexOptions]. Consult params.hpp for more information regarding the parameters. */
+    Matcher(DistanceType distanceType, FingerprintType fingerprintType, LettersType lettersType,
+        const IndexOptions &indexOptions = IndexOptions());
+    ~Matcher();
+
+    /** Builds the index over [nWords] [words], replacing the previous one. Throws invalid_argument for words
+     * which cannot be stored. */
+    void build(const StringRef *words, size_t nWords);
+    /** Builds the index over the words read from the file with [dictPath], separated with [separator].
+     * Throws runtime_error if the file cannot be read. */
+    void load(const std::string &dictPath, const std::string &separator = "\n");
+
+    /** Performs approximate matching for [nPatterns] [patterns] and [k] errors using [context],
+     * and writes the number of matches for each pattern into [nMatches] (which must hold [nPatterns] counts)
+     * if it is not nullptr. Returns the total number of matches. Throws invalid_argument for negative [k]. */
+    size_t query(QueryContext &context, const StringRef *patterns, size_t nPatterns, int k,
+        uint32_t *nMatches = nullptr) const;
+
+private:
+    const DistanceType distanceType;
+    const FingerprintType fingerprintType;
+    const LettersType lettersType;
+    const IndexOptions indexOptions;
+
+    std::unique_ptr<Engine> engine;
+};
+
+} // namespace fingerprints
+
+#endif // MATCHER_HPP
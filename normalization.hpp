@@ -0,0 +1,116 @@
+#ifndef NORMALIZATION_HPP
+#define NORMALIZATION_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fingerprints
+{
+
+/** Builds byte normalization tables, which map each of the 256 byte values to another byte.
+ * Such a table is applied to the dictionary and to the patterns, so that e.g. matching is case insensitive. */
+class Normalization
+{
+public:
+    Normalization() = delete;
+
+    /** Identity leaves all bytes unchanged, Case folds ASCII letters to lowercase,
+     * and Latin1 additionally folds ISO 8859-1 letters to lowercase and strips their diacritics (e.g. 0xC9 -> 'e'). */
+    enum class Type { Identity, Case, Latin1 };
+
+    /** Number of entries in a normalization table. */
+    static constexpr size_t tableSize = 256;
+
+    /** Returns a normalization table for [type]. */
+    inline static std::vector<unsigned char> makeTable(Type type);
+    /** Sets [table] so that each byte from [from] is mapped to the byte at the same position in [to].
+     * Throws invalid_argument if [table] is not a normalization table or if [from] and [to] have different sizes. */
+    inline static void addMapping(std::vector<unsigned char> &table, const std::string &from, const std::string &to);
+
+    /** Returns [str] with each byte mapped through [table]. */
+    inline static std::string apply(const std::vector<unsigned char> &table, const std::string &str);
+};
+
+std::vector<unsigned char> Normalization::makeTable(Type type)
+{
+    std::vector<unsigned char> table(tableSize);
+
+    for (size_t i = 0; i < tableSize; ++i)
+    {
+        table[i] = static_cast<unsigned char>(i);
+    }
+
+    if (type == Type::Identity)
+    {
+        return table;
+    }
+
+    for (size_t c = 'A'; c <= 'Z'; ++c)
+    {
+        table[c] = static_cast<unsigned char>(c - 'A' + 'a');
+    }
+
+    if (type == Type::Case)
+    {
+        return table;
+    }
+
+    // Uppercase Latin-1 letters 0xC0 - 0xDE are 0x20 below their lowercase counterparts, except for 0xD7 (multiplication sign).
+    for (size_t c = 0xC0; c <= 0xDE; ++c)
+    {
+        if (c != 0xD7)
+        {
+            table[c] = static_cast<unsigned char>(c + 0x20);
+        }
+    }
+
+    // Folded counterparts of the lowercase Latin-1 letters 0xE0 - 0xFF, '.' marks bytes which are left unchanged.
+    const char *latin1LowerFolded = "aaaaaa.ceeeeiiiidnooooo.ouuuuy.y";
+
+    for (size_t c = 0xC0; c < tableSize; ++c)
+    {
+        const size_t lower = table[c];
+
+        if (lower >= 0xE0 and latin1LowerFolded[lower - 0xE0] != '.')
+        {
+            table[c] = static_cast<unsigned char>(latin1LowerFolded[lower - 0xE0]);
+        }
+    }
+
+    return table;
+}
+
+void Normalization::addMapping(std::vector<unsigned char> &table, const std::string &from, const std::string &to)
+{
+    if (table.size() != tableSize)
+    {
+        throw std::invalid_argument("bad normalization table size: " + std::to_string(table.size()));
+    }
+    if (from.size() != to.size())
+    {
+        throw std::invalid_argument("bad normalization mapping: " + from + " -> " + to);
+    }
+
+    for (size_t i = 0; i < from.size(); ++i)
+    {
+        table[static_cast<unsigned char>(from[i])] = static_cast<unsigned char>(to[i]);
+    }
+}
+
+std::string Normalization::apply(const std::vector<unsigned char> &table, const std::string &str)
+{
+    std::string res(str.size(), '\0');
+
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        res[i] = static_cast<char>(table[static_cast<unsigned char>(str[i])]);
+    }
+
+    return res;
+}
+
+} // namespace fingerprints
+
+#endif // NORMALIZATION_HPP
@@ -24,12 +24,21 @@ struct Params
     /** Dump input files and params info with elapsed and throughput to output file. Cmd arg -d. */
     bool dumpToFile = false;
 
-    /** Distance type: ham (Hamming), lev (Levenshtein). Cmd arg -D. */
+    /** Dictionary entries are padded to a multiple of this many bytes: 1 (packed), 2, 4, 8, 16. */
+    int entryAlignment;
+
+    /** Distance type: ham (Hamming), lev (Levenshtein), osa (optimal string alignment). Cmd arg -D. */
     std::string distanceType;
 
-    /** Fingerprint type: none, occ (occurrence), occhalved (occurrence halved), count, pos (position). Cmd arg -f. */
+    /** Search engine: fingerprints (fingerprint scan), bktree (BK-tree), deletion (deletion index), partition (partition index), planner (query planner), dawg (DAWG). */
+    std::string engine;
+
+    /** Fingerprint type: none, occ (occurrence), occhalved (occurrence halved), count, pos (position), qgram (hashed q-grams). Cmd arg -f. */
     std::string fingerprintType;
 
+    /** Number of characters in a gram for qgram fingerprints: 2, 3. */
+    int qgramSize;
+
     /** Letters type: common, mixed, rare. Cmd arg -l. */
     std::string lettersType;
 
@@ -46,6 +55,32 @@ struct Params
     /** Maximum number of words read from top of the dictionary file. Cmd arg -w. */
     int nWords = noValue;
 
+    /** Allocate the index using huge pages (falls back to regular pages if unavailable). */
+    bool hugePages = false;
+    /** Lock the index in RAM after construction. */
+    bool lockMemory = false;
+
+    /** Build a hash table over the dictionary which is used instead of scanning for k = 0. */
+    bool exactHash = false;
+    /** Sort each size bucket by fingerprint and test each distinct fingerprint once. */
+    bool fingerprintGroups = false;
+    /** Enumerate the fingerprints which pass the comparison with the pattern fingerprint and look up their groups. */
+    bool fingerprintNeighborhood = false;
+    /** Split each size bucket by fingerprint popcount and skip the sub-buckets which cannot pass. */
+    bool popcountBuckets = false;
+    /** Store the words packed into 4 or 5 bits per char and compare them lane by lane in scans without fingerprints. */
+    bool packedWords = false;
+    /** Store the words of each bucket sorted and front coded, and reuse the rows calculated for shared prefixes. */
+    bool frontCoding = false;
+
+    /** Normalization applied to the dictionary and the patterns: none, case, latin1. */
+    std::string normalization;
+    /** Additional normalization given as pairs of bytes, each pair maps its first byte to the second one. */
+    std::string normalizationMap;
+
+    /** Treat the dictionary and the patterns as UTF-8, so that word sizes and distances are calculated over code points. */
+    bool utf8 = false;
+
     /** Input data (dictionary and patterns) separator. */
     std::string separator = "\n";
 
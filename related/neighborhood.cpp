@@ -3,12 +3,14 @@
  *** Compile as follows: g++ -Wall -pedantic -std=c++14 -DNDEBUG -O3 -I$(BOOST_DIR)$ neighborhood.cpp -o neighborhood
  */
 
+#include <algorithm>
 #include <boost/format.hpp>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <set>
 #include <stdexcept>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include "../helpers.hpp"
@@ -22,37 +24,173 @@ namespace
 const string pSeparator = "\n";
 constexpr int pNIter = 100;
 
-}
+/** A part of a candidate string, candidates are probed as a sequence of such pieces without being copied. */
+struct Piece
+{
+    const char *str;
+    size_t size;
+};
+
+/** Polynomial hash of a string s: sum of (s[j] + 1) * base^j modulo 2^64. The base is odd, hence invertible,
+ * which allows updating the hash in constant time after a substitution, a deletion, or an insertion. */
+class RollingHash
+{
+public:
+    /** Prepares powers of the base for strings of up to [maxSize] chars. */
+    explicit RollingHash(size_t maxSize);
+
+    /** Returns the weight of [c] in the hash. */
+    static uint64_t getValue(char c) { return static_cast<unsigned char>(c) + 1; }
+
+    /** Sets [prefixHashes] so that prefixHashes[i] is the hash of the first i chars of [str] of [size],
+     * prefixHashes[size] is the hash of the whole string. */
+    void calcPrefixHashes(const char *str, size_t size, uint64_t *prefixHashes) const;
+
+    /** Return the hash of a string having [hash], [prefixHashes], and char [old] at [pos] after substituting [c]
+     * for [old], after deleting the char at [pos], and after inserting [c] before [pos], respectively. */
+    uint64_t substitute(uint64_t hash, size_t pos, char old, char c) const
+    {
+        return hash + (getValue(c) - getValue(old)) * powers[pos];
+    }
+    uint64_t erase(uint64_t hash, const uint64_t *prefixHashes, size_t pos) const
+    {
+        return prefixHashes[pos] + (hash - prefixHashes[pos + 1]) * baseInverse;
+    }
+    uint64_t insert(uint64_t hash, const uint64_t *prefixHashes, size_t pos, char c) const
+    {
+        return prefixHashes[pos] + getValue(c) * powers[pos] + (hash - prefixHashes[pos]) * base;
+    }
+
+private:
+    static constexpr uint64_t base = 0x100000001B3ULL;
+
+    uint64_t baseInverse;
+    vector<uint64_t> powers;
+};
+
+/** Open addressing (linear probing) set of the dictionary words keyed by their rolling hashes.
+ * The words are stored contiguously and each slot keeps the full hash, so that most probes
+ * for absent candidates are rejected without comparing any chars. Load factor is at most 1/2. */
+class WordSet
+{
+public:
+    WordSet(const vector<string> &words, const RollingHash &rollingHash);
+
+    /** Returns the slot of the word made of [nPieces] [pieces] having [size] chars in total and [hash],
+     * or -1 if it is not in the set. */
+    int64_t find(uint64_t hash, const Piece *pieces, size_t nPieces, size_t size) const;
+
+    size_t getWordsCount() const { return nWords; }
+    size_t getSlotsCount() const { return slots.size(); }
+    /** Returns the longest word size. */
+    size_t getMaxWordSize() const { return maxWordSize; }
+    /** Returns all distinct chars occurring in the words. */
+    const string &getAlphabet() const { return alphabet; }
+
+private:
+    struct Slot
+    {
+        uint64_t hash;
+        /** Position and size of the word in words, size == emptySize marks an empty slot. */
+        uint32_t wordStart;
+        uint32_t wordSize;
+    };
+
+    static constexpr uint32_t emptySize = UINT32_MAX;
+
+    /** Returns the first slot to probe for [hash]. */
+    size_t getSlot(uint64_t hash) const { return (hash * 0x9E3779B97F4A7C15ULL) >> (64 - nSlotBits); }
+
+    /** Returns true if the word in [slot] is made of [nPieces] [pieces]. */
+    bool isEqual(const Slot &slot, const Piece *pieces, size_t nPieces) const;
+
+    string words;
+    vector<Slot> slots;
+    size_t nSlotBits = 1;
+
+    size_t nWords = 0;
+    size_t maxWordSize = 0;
+    string alphabet;
+};
+
+/** Generates the neighborhood of a pattern, i.e. all strings within k edits, and looks them up in a WordSet.
+ * Edits are applied left to right, each at or after the position of the previous one, which avoids generating most
+ * strings more than once. Hashes of the candidates are updated in constant time, a candidate is copied only if
+ * it has to be edited further. */
+class NeighborhoodSearch
+{
+public:
+    NeighborhoodSearch(const WordSet &wordSet, const RollingHash &rollingHash, bool useLeven, int k, size_t maxPatternSize);
+
+    /** Returns the number of distinct dictionary words within k edits of [pattern]. */
+    int search(const string &pattern);
+
+private:
+    /** Looks up all strings obtained from [cur] of [size] having [hash] by at most [nErrors] edits
+     * at positions [start] or later, [depth] is the number of edits applied so far. */
+    void expand(const char *cur, size_t size, uint64_t hash, size_t start, int nErrors, size_t depth);
 
-float runHammingK1(const unordered_set<string> &wordSet, const vector<string> &patterns, int nIter = 1);
-float runLevenK1(const unordered_set<string> &wordSet, const vector<string> &patterns, int nIter = 1);
+    /** Looks up the candidate made of [nPieces] [pieces] having [size] chars and [hash], counts it if it is a word
+     * which was not found for the current pattern yet. */
+    void probe(uint64_t hash, const Piece *pieces, size_t nPieces, size_t size);
 
-string getAlphabet(const unordered_set<string> &wordSet);
+    const WordSet &wordSet;
+    const RollingHash &rollingHash;
+
+    const bool useLeven;
+    const int k;
+    const string alphabet;
+
+    /** Candidates and prefix hashes at each depth, reused by subsequent patterns. */
+    vector<string> buffers;
+    vector<vector<uint64_t>> prefixHashes;
+
+    /** Slots are marked with the current stamp when their words are found, so that each of them is counted once. */
+    vector<uint32_t> slotStamps;
+    uint32_t stamp = 0;
+
+    int nMatches = 0;
+};
+
+}
+
+float runHamming(const vector<string> &words, const vector<string> &patterns, int k, int nIter = 1);
+float runLeven(const vector<string> &words, const vector<string> &patterns, int k, int nIter = 1);
+/** Searches for [patterns] in [words] within [k] errors for Levenshtein distance if [useLeven] is true and
+ * Hamming distance otherwise, iterates [nIter] times. Returns time elapsed during searching in microseconds. */
+float runNeighborhood(const vector<string> &words, const vector<string> &patterns, int k, bool useLeven, int nIter);
 
 int main(int argc, const char **argv)
 {
-    if (argc != 4)
+    if (argc != 4 and argc != 5)
     {
-        throw runtime_error("usage: ./neighborhood [dictionary path] [patterns path] [ham/lev]");
+        throw runtime_error("usage: ./neighborhood [dictionary path] [patterns path] [ham/lev] [k (default = 1)]");
     }
 
     vector<string> dict = Helpers::readWords(argv[1], pSeparator);
     vector<string> patterns = Helpers::readWords(argv[2], pSeparator);
 
+    const int k = (argc == 5) ? stoi(argv[4]) : 1;
+
+    if (k < 0)
+    {
+        throw runtime_error("bad k: " + to_string(k));
+    }
+
     cout << boost::format("Read #words = %1%, #patterns = %2%") % dict.size() % patterns.size() << endl;
-    unordered_set<string> wordSet(dict.begin(), dict.end());
+    cout << "Using k = " << k << endl;
 
     float elapsedUs;
 
     if (strcmp(argv[3], "ham") == 0)
     {
         cout << "Calculating for the Hamming distance" << endl;
-        elapsedUs = runHammingK1(wordSet, patterns, pNIter);
+        elapsedUs = runHamming(dict, patterns, k, pNIter);
     }
     else if (strcmp(argv[3], "lev") == 0)
     {
         cout << "Calculating for the Levenshtein distance" << endl;
-        elapsedUs = runLevenK1(wordSet, patterns, pNIter);
+        elapsedUs = runLeven(dict, patterns, k, pNIter);
     }
     else
     {
@@ -64,17 +202,47 @@ int main(int argc, const char **argv)
     float elapsedPerWordNs = (1'000.0f * elapsedUs) / static_cast<float>(nProcessedWords);
     elapsedPerWordNs /= pNIter;
 
-    cout << boost::format("Elapsed = %1%us, per word = %2%ns (#iterations = %3%)") 
+    cout << boost::format("Elapsed = %1%us, per word = %2%ns (#iterations = %3%)")
         % elapsedUs % elapsedPerWordNs % pNIter << endl;
 }
 
-float runHammingK1(const unordered_set<string> &wordSet, const vector<string> &patterns, int nIter)
+float runHamming(const vector<string> &words, const vector<string> &patterns, int k, int nIter)
+{
+    return runNeighborhood(words, patterns, k, false, nIter);
+}
+
+float runLeven(const vector<string> &words, const vector<string> &patterns, int k, int nIter)
+{
+    return runNeighborhood(words, patterns, k, true, nIter);
+}
+
+float runNeighborhood(const vector<string> &words, const vector<string> &patterns, int k, bool useLeven, int nIter)
 {
     clock_t start, end;
     int nMatches = 0;
 
-    string alphabet = getAlphabet(wordSet);
-    cout << "Alphabet size = " << alphabet.size() << endl;
+    size_t maxPatternSize = 0;
+
+    for (const string &pattern : patterns)
+    {
+        maxPatternSize = max(maxPatternSize, pattern.size());
+    }
+
+    size_t maxWordSize = 0;
+
+    for (const string &word : words)
+    {
+        maxWordSize = max(maxWordSize, word.size());
+    }
+
+    // Candidates are at most k chars longer than the patterns.
+    const RollingHash rollingHash(max(maxWordSize, maxPatternSize + k) + 1);
+    const WordSet wordSet(words, rollingHash);
+
+    cout << "Alphabet size = " << wordSet.getAlphabet().size() << endl;
+    cout << boost::format("Unique #words = %1%, #slots = %2%") % wordSet.getWordsCount() % wordSet.getSlotsCount() << endl;
+
+    NeighborhoodSearch search(wordSet, rollingHash, useLeven, k, maxPatternSize);
 
     start = std::clock();
 
@@ -82,35 +250,10 @@ float runHammingK1(const unordered_set<string> &wordSet, const vector<string> &p
     {
         nMatches = 0;
 
-        for (const string &pattern : patterns) 
+        for (const string &pattern : patterns)
         {
-            // Checking for an exact match.
-            if (wordSet.find(pattern) != wordSet.end())
-            {
-                nMatches += 1;
-            }
-
-            // This search assumes k = 1.
-            for (size_t i = 0; i < pattern.size(); ++i)
-            {
-                string candidate = pattern;
-
-                for (const char c : alphabet)
-                {
-                    if (pattern[i] == c)
-                    {
-                        continue;
-                    }
-
-                    candidate[i] = c;
-
-                    if (wordSet.find(candidate) != wordSet.end())
-                    {
-                        nMatches += 1;
-                    }
-                }
-            }
-        }    
+            nMatches += search.search(pattern);
+        }
     }
 
     end = std::clock();
@@ -121,130 +264,261 @@ float runHammingK1(const unordered_set<string> &wordSet, const vector<string> &p
     return elapsedS * 1'000'000.0f;
 }
 
-float runLevenK1(const unordered_set<string> &wordSet, const vector<string> &patterns, int nIter)
+namespace
 {
-    clock_t start, end;
-    int nMatches = 0;
 
-    string alphabet = getAlphabet(wordSet);
-    cout << "Alphabet size = " << alphabet.size() << endl;
+RollingHash::RollingHash(size_t maxSize)
+    : powers(maxSize + 1)
+{
+    // Newton's iteration doubles the number of correct low bits of the inverse of an odd number,
+    // base is its own inverse modulo 8.
+    baseInverse = base;
 
-    start = std::clock();
+    for (int i = 0; i < 5; ++i)
+    {
+        baseInverse *= 2 - base * baseInverse;
+    }
 
-    for (int i = 0; i < nIter; ++i)
+    powers[0] = 1;
+
+    for (size_t i = 1; i <= maxSize; ++i)
     {
-        nMatches = 0;
+        powers[i] = powers[i - 1] * base;
+    }
+}
 
-        for (const string &pattern : patterns)
-        {
-            // Checking for an exact match.
-            if (wordSet.find(pattern) != wordSet.end())
-            {
-                nMatches += 1;
-            }
+void RollingHash::calcPrefixHashes(const char *str, size_t size, uint64_t *prefixHashes) const
+{
+    prefixHashes[0] = 0;
 
-            // Substitutions for k = 1.
-            for (size_t i = 0; i < pattern.size(); ++i)
-            {
-                string candidate = pattern;
-
-                for (const char c : alphabet)
-                {
-                    if (pattern[i] == c)
-                    {
-                        continue;
-                    }
-
-                    candidate[i] = c;
-
-                    if (wordSet.find(candidate) != wordSet.end())
-                    {
-                        nMatches += 1;
-                    }
-                }
-            }
+    for (size_t i = 0; i < size; ++i)
+    {
+        prefixHashes[i + 1] = prefixHashes[i] + getValue(str[i]) * powers[i];
+    }
+}
 
-            // Stores already checked words.
-            // Prevents duplicate checks which might happen with insertions and deletions.
-            unordered_set<string> checked;
+WordSet::WordSet(const vector<string> &wordsIn, const RollingHash &rollingHash)
+{
+    // We remove the duplicates, so that each word is counted once.
+    vector<string> wordsUnique(wordsIn.begin(), wordsIn.end());
+    sort(wordsUnique.begin(), wordsUnique.end());
+    wordsUnique.erase(unique(wordsUnique.begin(), wordsUnique.end()), wordsUnique.end());
 
-            // Deletions for k = 1.
-            for (size_t i = 0; i < pattern.size(); ++i)
-            {
-                const size_t prefixSize = i + 1;
-                string candidate(pattern.size() - 1, 0);
+    nWords = wordsUnique.size();
+
+    while ((size_t(1) << nSlotBits) < 2 * nWords)
+    {
+        nSlotBits += 1;
+    }
 
-                char *src = const_cast<char *>(candidate.c_str());
+    slots.assign(size_t(1) << nSlotBits, { 0, 0, emptySize });
 
-                memcpy(src, pattern.c_str(), i);
-                memcpy(src + i, pattern.c_str() + prefixSize, pattern.size() - prefixSize);
+    const size_t mask = slots.size() - 1;
+    set<char> alph;
+    vector<uint64_t> prefixHashes;
 
-                if (checked.find(candidate) == checked.end())
-                {
-                    if (wordSet.find(candidate) != wordSet.end())
-                    {
-                        nMatches += 1;
-                    }
+    for (const string &word : wordsUnique)
+    {
+        prefixHashes.resize(word.size() + 1);
+        rollingHash.calcPrefixHashes(word.c_str(), word.size(), prefixHashes.data());
 
-                    checked.insert(candidate);
-                }
-            }
+        const uint64_t hash = prefixHashes[word.size()];
+        size_t iSlot = getSlot(hash);
 
-            // Insertions for k = 1.
-            for (size_t i = 0; i < pattern.size() + 1; ++i)
-            {
-                string candidate(pattern.size() + 1, 0);
-                const size_t prefixSize = i + 1;
+        // Words are unique at this point, so we only look for an empty slot.
+        while (slots[iSlot].wordSize != emptySize)
+        {
+            iSlot = (iSlot + 1) & mask;
+        }
 
-                char *src = const_cast<char *>(candidate.c_str());
+        slots[iSlot] = { hash, static_cast<uint32_t>(words.size()), static_cast<uint32_t>(word.size()) };
+        words += word;
 
-                memcpy(src, pattern.c_str(), i);
-                memcpy(src + prefixSize, pattern.c_str() + i, pattern.size() - i);
+        maxWordSize = max(maxWordSize, word.size());
+        alph.insert(word.begin(), word.end());
+    }
 
-                for (const char c : alphabet)
-                {
-                    candidate[i] = c;
+    alphabet.assign(alph.begin(), alph.end());
+}
 
-                    if (checked.find(candidate) == checked.end())
-                    {
-                        if (wordSet.find(candidate) != wordSet.end())
-                        {
-                            nMatches += 1;
-                        }
+int64_t WordSet::find(uint64_t hash, const Piece *pieces, size_t nPieces, size_t size) const
+{
+    const size_t mask = slots.size() - 1;
 
-                        checked.insert(candidate);
-                    }
-                }
-            }
+    for (size_t iSlot = getSlot(hash); slots[iSlot].wordSize != emptySize; iSlot = (iSlot + 1) & mask)
+    {
+        const Slot &slot = slots[iSlot];
+
+        if (slot.hash == hash and slot.wordSize == size and isEqual(slot, pieces, nPieces))
+        {
+            return iSlot;
         }
     }
 
-    end = std::clock();
+    return -1;
+}
 
-    cout << "Got #matches = " << nMatches << endl;
+bool WordSet::isEqual(const Slot &slot, const Piece *pieces, size_t nPieces) const
+{
+    const char *word = words.data() + slot.wordStart;
 
-    float elapsedS = (end - start) / static_cast<float>(CLOCKS_PER_SEC);
-    return elapsedS * 1'000'000.0f;
+    for (size_t iPiece = 0; iPiece < nPieces; ++iPiece)
+    {
+        if (memcmp(word, pieces[iPiece].str, pieces[iPiece].size) != 0)
+        {
+            return false;
+        }
+
+        word += pieces[iPiece].size;
+    }
+
+    return true;
 }
 
-string getAlphabet(const unordered_set<string> &wordSet)
+NeighborhoodSearch::NeighborhoodSearch(const WordSet &wordSet, const RollingHash &rollingHash,
+    bool useLeven, int k, size_t maxPatternSize)
+    : wordSet(wordSet), rollingHash(rollingHash), useLeven(useLeven), k(k), alphabet(wordSet.getAlphabet()),
+    buffers(k + 1, string(maxPatternSize + k, '\0')), prefixHashes(k + 1, vector<uint64_t>(maxPatternSize + k + 1)),
+    slotStamps(wordSet.getSlotsCount(), 0)
 {
-    set<char> alph;
 
-    for (const string &word : wordSet)
+}
+
+int NeighborhoodSearch::search(const string &pattern)
+{
+    nMatches = 0;
+    stamp += 1;
+
+    if (stamp == 0)
     {
-        for (const char c : word)
+        fill(slotStamps.begin(), slotStamps.end(), 0);
+        stamp = 1;
+    }
+
+    uint64_t *curPrefixHashes = prefixHashes[0].data();
+    rollingHash.calcPrefixHashes(pattern.c_str(), pattern.size(), curPrefixHashes);
+
+    const uint64_t hash = curPrefixHashes[pattern.size()];
+
+    // Checking for an exact match.
+    const Piece piece { pattern.c_str(), pattern.size() };
+    probe(hash, &piece, 1, pattern.size());
+
+    if (k > 0)
+    {
+        expand(pattern.c_str(), pattern.size(), hash, 0, k, 0);
+    }
+
+    return nMatches;
+}
+
+void NeighborhoodSearch::expand(const char *cur, size_t size, uint64_t hash, size_t start, int nErrors, size_t depth)
+{
+    const uint64_t *curPrefixHashes = prefixHashes[depth].data();
+
+    if (depth != 0)
+    {
+        rollingHash.calcPrefixHashes(cur, size, prefixHashes[depth].data());
+    }
+
+    // Only the candidates which are edited further are copied into the buffer for the next depth.
+    const bool isLastEdit = (nErrors == 1);
+    char *next = isLastEdit ? nullptr : &buffers[depth + 1][0];
+
+    // A candidate consists of the prefix, an optional new char, and the suffix.
+    char newChar;
+    Piece pieces[3];
+
+    // Substitutions.
+    for (size_t i = start; i < size; ++i)
+    {
+        for (const char c : alphabet)
         {
-            alph.insert(c);
+            if (cur[i] == c)
+            {
+                continue;
+            }
+
+            newChar = c;
+            pieces[0] = { cur, i };
+            pieces[1] = { &newChar, 1 };
+            pieces[2] = { cur + i + 1, size - i - 1 };
+
+            const uint64_t newHash = rollingHash.substitute(hash, i, cur[i], c);
+            probe(newHash, pieces, 3, size);
+
+            if (not isLastEdit)
+            {
+                memcpy(next, cur, size);
+                next[i] = c;
+
+                expand(next, size, newHash, i + 1, nErrors - 1, depth + 1);
+            }
         }
     }
 
-    string res;
+    if (not useLeven)
+    {
+        return;
+    }
 
-    for (const char c : alph)
+    // Deletions, the next edit can be applied to the char which moved into the deleted position.
+    for (size_t i = start; i < size; ++i)
     {
-        res += c;
+        pieces[0] = { cur, i };
+        pieces[1] = { cur + i + 1, size - i - 1 };
+
+        const uint64_t newHash = rollingHash.erase(hash, curPrefixHashes, i);
+        probe(newHash, pieces, 2, size - 1);
+
+        if (not isLastEdit)
+        {
+            memcpy(next, cur, i);
+            memcpy(next + i, cur + i + 1, size - i - 1);
+
+            expand(next, size - 1, newHash, i, nErrors - 1, depth + 1);
+        }
     }
 
-    return res;
+    // Insertions.
+    for (size_t i = start; i <= size; ++i)
+    {
+        for (const char c : alphabet)
+        {
+            newChar = c;
+            pieces[0] = { cur, i };
+            pieces[1] = { &newChar, 1 };
+            pieces[2] = { cur + i, size - i };
+
+            const uint64_t newHash = rollingHash.insert(hash, curPrefixHashes, i, c);
+            probe(newHash, pieces, 3, size + 1);
+
+            if (not isLastEdit)
+            {
+                memcpy(next, cur, i);
+                next[i] = c;
+                memcpy(next + i + 1, cur + i, size - i);
+
+                expand(next, size + 1, newHash, i + 1, nErrors - 1, depth + 1);
+            }
+        }
+    }
+}
+
+void NeighborhoodSearch::probe(uint64_t hash, const Piece *pieces, size_t nPieces, size_t size)
+{
+    if (size > wordSet.getMaxWordSize())
+    {
+        return;
+    }
+
+    const int64_t iSlot = wordSet.find(hash, pieces, nPieces, size);
+
+    if (iSlot >= 0 and slotStamps[iSlot] != stamp)
+    {
+        slotStamps[iSlot] = stamp;
+        nMatches += 1;
+    }
+}
+
 }
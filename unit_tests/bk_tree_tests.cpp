@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "repeat.hpp"
+
+#include "../bk_tree.hpp"
+#include "../bk_tree.cpp"
+
+#include "../fingerprints.hpp"
+#include "../fingerprints.cpp"
+
+using namespace std;
+
+namespace fingerprints
+{
+
+namespace
+{
+
+constexpr int maxK = 4;
+constexpr int nDistanceRepeats = 2000;
+constexpr int nWords = 2000;
+
+using FING_T = uint16_t;
+
+/** Returns a random string of [size] characters over a small alphabet, so that many words are close. */
+string genRandomString(size_t size)
+{
+    string str(size, 'a');
+
+    for (char &c : str)
+    {
+        c = 'a' + rand() % 4;
+    }
+
+    return str;
+}
+
+/** Returns the Levenshtein distance between [str1] and [str2] using the full DP matrix. */
+int calcLevDistance(const string &str1, const string &str2)
+{
+    vector<vector<int>> d(str1.size() + 1, vector<int>(str2.size() + 1));
+
+    for (size_t i = 0; i <= str1.size(); ++i)
+    {
+        for (size_t j = 0; j <= str2.size(); ++j)
+        {
+            if (i == 0 or j == 0)
+            {
+                d[i][j] = i + j;
+                continue;
+            }
+
+            d[i][j] = min(min(d[i - 1][j], d[i][j - 1]) + 1, d[i - 1][j - 1] + (str1[i - 1] != str2[j - 1]));
+        }
+    }
+
+    return d[str1.size()][str2.size()];
+}
+
+}
+
+TEST_CASE("is bounded Levenshtein distance calculation correct", "[bktree]")
+{
+    BKTree bkTree;
+
+    REQUIRE(bkTree.calcLevDistanceAtMost("", 0, "", 0, 0) == 0);
+    REQUIRE(bkTree.calcLevDistanceAtMost("ala", 3, "", 0, 3) == 3);
+    REQUIRE(bkTree.calcLevDistanceAtMost("ala", 3, "", 0, 2) == 3);
+    REQUIRE(bkTree.calcLevDistanceAtMost("kitten", 6, "sitting", 7, 10) == 3);
+    REQUIRE(bkTree.calcLevDistanceAtMost("kitten", 6, "sitting", 7, 2) == 3);
+
+    repeat(nDistanceRepeats, [&bkTree] {
+        const string str1 = genRandomString(rand() % 20);
+        const string str2 = genRandomString(rand() % 20);
+
+        const int distance = calcLevDistance(str1, str2);
+
+        for (int bound = 0; bound <= 20; ++bound)
+        {
+            REQUIRE(bkTree.calcLevDistanceAtMost(str1.c_str(), str1.size(), str2.c_str(), str2.size(), bound)
+                == min(distance, bound + 1));
+        }
+    });
+}
+
+TEST_CASE("is searching words with BK-tree correct", "[bktree]")
+{
+    vector<string> words, patterns;
+
+    for (int i = 0; i < nWords; ++i)
+    {
+        words.push_back(genRandomString(4 + rand() % 8));
+    }
+    for (int i = 0; i < nWords / 10; ++i)
+    {
+        patterns.push_back(genRandomString(4 + rand() % 8));
+    }
+
+    // Duplicates are stored once.
+    const vector<string> duplicates(words.begin(), words.begin() + 100);
+    words.insert(words.end(), duplicates.begin(), duplicates.end());
+
+    BKTree bkTree;
+    bkTree.preprocess(words);
+
+    Fingerprints<FING_T> fingerprints(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::None,
+        Fingerprints<FING_T>::LettersType::Common);
+    fingerprints.preprocess(words);
+
+    REQUIRE(bkTree.getNodesCount() == unordered_set<string>(words.begin(), words.end()).size());
+    REQUIRE(bkTree.getDepth() >= 2);
+
+    for (int k = 0; k <= maxK; ++k)
+    {
+        REQUIRE(bkTree.test(patterns, k) == fingerprints.test(patterns, k));
+        REQUIRE(bkTree.getProcessedWordsCount() <= bkTree.getNodesCount() * patterns.size());
+    }
+
+    REQUIRE(bkTree.test(words, 0) == static_cast<int>(words.size()));
+    REQUIRE_THROWS_AS(bkTree.test(patterns, -1), invalid_argument);
+}
+
+TEST_CASE("is searching words with empty BK-tree correct", "[bktree]")
+{
+    BKTree bkTree;
+    bkTree.preprocess({ });
+
+    REQUIRE(bkTree.getNodesCount() == 0);
+    REQUIRE(bkTree.getDepth() == 0);
+    REQUIRE(bkTree.test({ "ala", "kot" }, 2) == 0);
+
+    bkTree.preprocess({ "ala" });
+
+    REQUIRE(bkTree.getNodesCount() == 1);
+    REQUIRE(bkTree.test({ "ala", "ola", "kot" }, 1) == 2);
+}
+
+} // namespace fingerprints
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "catch.hpp"
+#include "repeat.hpp"
+
+#include "../dawg.hpp"
+#include "../dawg.cpp"
+
+#include "../fingerprints.hpp"
+#include "../fingerprints.cpp"
+
+using namespace std;
+
+namespace fingerprints
+{
+
+namespace
+{
+
+constexpr int maxK = 4;
+constexpr int nWords = 2000;
+
+using FING_T = uint16_t;
+
+/** Returns a random string of [size] characters over a small alphabet mixing fingerprint letters with other ones,
+ * so that many words are close and share prefixes and suffixes. */
+string genRandomString(size_t size)
+{
+    string str(size, 'a');
+
+    for (char &c : str)
+    {
+        c = "etbx"[rand() % 4];
+    }
+
+    return str;
+}
+
+}
+
+TEST_CASE("is searching words with DAWG correct", "[dawg]")
+{
+    vector<string> words, patterns;
+
+    for (int i = 0; i < nWords; ++i)
+    {
+        words.push_back(genRandomString(1 + rand() % 12));
+    }
+    for (int i = 0; i < nWords / 10; ++i)
+    {
+        patterns.push_back(genRandomString(rand() % 12));
+    }
+
+    // Duplicates are stored once.
+    const vector<string> duplicates(words.begin(), words.begin() + 100);
+    words.insert(words.end(), duplicates.begin(), duplicates.end());
+
+    Dawg dawg;
+    dawg.preprocess(words);
+
+    Fingerprints<FING_T> fingerprints(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::None,
+        Fingerprints<FING_T>::LettersType::Common);
+    fingerprints.preprocess(words);
+
+    const size_t nUniqueWords = unordered_set<string>(words.begin(), words.end()).size();
+
+    REQUIRE(dawg.getWordsCount() == nUniqueWords);
+    REQUIRE(dawg.getEdgesCount() >= dawg.getNodesCount() - 1);
+    REQUIRE(dawg.getSizeB() > 0);
+
+    for (int k = 0; k <= maxK; ++k)
+    {
+        REQUIRE(dawg.test(patterns, k) == fingerprints.test(patterns, k));
+    }
+
+    REQUIRE(dawg.test(words, 0) == static_cast<int>(words.size()));
+    REQUIRE_THROWS_AS(dawg.test(patterns, -1), invalid_argument);
+}
+
+TEST_CASE("is merging equal subtrees in DAWG correct", "[dawg]")
+{
+    Dawg dawg;
+
+    // A trie would have 9 nodes, the suffixes "ap", "aps", "op", "ops" share the nodes for "p" and "s".
+    dawg.preprocess({ "tap", "taps", "top", "tops" });
+
+    REQUIRE(dawg.getNodesCount() == 5);
+    REQUIRE(dawg.getEdgesCount() == 5);
+    REQUIRE(dawg.getWordsCount() == 4);
+
+    REQUIRE(dawg.test({ "tap", "tops", "top", "tip", "ta", "taps" }, 0) == 4);
+    REQUIRE(dawg.test({ "tip", "ta", "tapss", "pat" }, 1) == 2 + 1 + 1 + 0);
+    REQUIRE(dawg.test({ "tips" }, 1) == 2);
+}
+
+TEST_CASE("is searching words with empty DAWG correct", "[dawg]")
+{
+    Dawg dawg;
+    dawg.preprocess({ });
+
+    REQUIRE(dawg.getWordsCount() == 0);
+    REQUIRE(dawg.test({ "ala", "kot" }, 2) == 0);
+
+    dawg.preprocess({ "ala" });
+
+    REQUIRE(dawg.getNodesCount() == 4);
+    REQUIRE(dawg.test({ "ala", "ola", "kot", "" }, 1) == 2);
+    REQUIRE(dawg.test({ "" }, 3) == 1);
+}
+
+TEST_CASE("is calculating DAWG fingerprint correct", "[dawg]")
+{
+    Dawg dawg;
+
+    REQUIRE(dawg.calcFingerprint("", 0) == 0x0);
+    REQUIRE(dawg.calcFingerprint("e", 1) == 0x1);
+    REQUIRE(dawg.calcFingerprint("eee", 3) == 0x1);
+    REQUIRE(dawg.calcFingerprint("tex", 3) == 0x3);
+    REQUIRE(dawg.calcFingerprint("fxyzb", 5) == 0x8000);
+}
+
+} // namespace fingerprints
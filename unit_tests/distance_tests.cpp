@@ -18,9 +18,106 @@ namespace
 
 constexpr int maxK = 5;
 constexpr int nHammingRepeats = 10;
+constexpr int nKernelRepeats = 2000;
 
 using FING_T = uint16_t;
 
+/** Returns [str] with [nEdits] random substitutions, insertions and deletions over a small alphabet. */
+string randomlyEdit(string str, int nEdits)
+{
+    for (int i = 0; i < nEdits; ++i)
+    {
+        const char c = 'a' + rand() % 4;
+        const int op = str.empty() ? 1 : rand() % 3;
+        const size_t pos = str.empty() ? 0 : rand() % str.size();
+
+        if (op == 0)
+        {
+            str[pos] = c;
+        }
+        else if (op == 1)
+        {
+            str.insert(str.begin() + pos, c);
+        }
+        else
+        {
+            str.erase(pos, 1);
+        }
+    }
+
+    return str;
+}
+
+/** Returns the optimal string alignment distance between [str1] and [str2] using the full DP matrix. */
+int calcOsaDistance(const string &str1, const string &str2)
+{
+    vector<vector<int>> d(str1.size() + 1, vector<int>(str2.size() + 1));
+
+    for (size_t i = 0; i <= str1.size(); ++i)
+    {
+        for (size_t j = 0; j <= str2.size(); ++j)
+        {
+            if (i == 0 or j == 0)
+            {
+                d[i][j] = i + j;
+                continue;
+            }
+
+            d[i][j] = min(min(d[i - 1][j], d[i][j - 1]) + 1, d[i - 1][j - 1] + (str1[i - 1] != str2[j - 1]));
+
+            if (i > 1 and j > 1 and str1[i - 1] == str2[j - 2] and str1[i - 2] == str2[j - 1])
+            {
+                d[i][j] = min(d[i][j], d[i - 2][j - 2] + 1);
+            }
+        }
+    }
+
+    return d[str1.size()][str2.size()];
+}
+
+/** Returns [str] with [nSwaps] random swaps of adjacent characters. */
+string randomlySwap(string str, int nSwaps)
+{
+    for (int i = 0; i < nSwaps and str.size() >= 2; ++i)
+    {
+        const size_t pos = rand() % (str.size() - 1);
+        swap(str[pos], str[pos + 1]);
+    }
+
+    return str;
+}
+
+template<int K>
+void checkHamKernel()
+{
+    repeat(nKernelRepeats, [] {
+        string str1 = Helpers::genRandomStringAlphNum(rand() % 12);
+        string str2 = str1;
+
+        for (int i = rand() % (K + 3); i > 0 and not str2.empty(); --i)
+        {
+            str2[rand() % str2.size()] = 'a' + rand() % 4;
+        }
+
+        REQUIRE(FingerprintsWhitebox::isHamAtMost<FING_T, K>(str1.c_str(), str2.c_str(), str1.size(), K)
+            == FingerprintsWhitebox::isHamAtMostK<FING_T>(str1.c_str(), str2.c_str(), str1.size(), K));
+    });
+}
+
+template<int K>
+void checkLevKernel(Fingerprints<FING_T> &fingerprints)
+{
+    repeat(nKernelRepeats, [&fingerprints] {
+        string str1 = randomlyEdit(string(rand() % 10, 'a'), 10);
+        string str2 = randomlyEdit(str1, rand() % (K + 3));
+
+        REQUIRE(FingerprintsWhitebox::isLevAtMost<FING_T, K>(fingerprints, str1.c_str(), str1.size(), str2.c_str(), str2.size(), K)
+            == FingerprintsWhitebox::isLevAtMostK<FING_T>(fingerprints, str1.c_str(), str1.size(), str2.c_str(), str2.size(), K));
+        REQUIRE(FingerprintsWhitebox::isLevAtMost<FING_T, K>(fingerprints, str2.c_str(), str2.size(), str1.c_str(), str1.size(), K)
+            == FingerprintsWhitebox::isLevAtMostK<FING_T>(fingerprints, str2.c_str(), str2.size(), str1.c_str(), str1.size(), K));
+    });
+}
+
 }
 
 TEST_CASE("is Hamming at most k for empty calculation correct", "[distance]")
@@ -127,6 +224,14 @@ TEST_CASE("is Hamming at most k=1,2,3,4 randomized calculation correct", "[dista
     };
 }
 
+TEST_CASE("is Hamming at most k kernels specialized for k=0,1,2,3 consistent with generic", "[distance]")
+{
+    checkHamKernel<0>();
+    checkHamKernel<1>();
+    checkHamKernel<2>();
+    checkHamKernel<3>();
+}
+
 TEST_CASE("is Leven at most k for empty calculation correct", "[distance]")
 {
     // Passing distance type Levenshtein, fingerprint and letter types don't matter here.
@@ -473,4 +578,95 @@ TEST_CASE("is Leven at most k=2 calculation for various modifications correct",
     }
 }
 
+TEST_CASE("is Leven at most k kernels specialized for k=0,1,2,3 consistent with generic", "[distance]")
+{
+    // Passing distance type Levenshtein, fingerprint and letter types don't matter here.
+    Fingerprints<FING_T> fingerprints(Fingerprints<FING_T>::DistanceType::Lev, 
+        Fingerprints<FING_T>::FingerprintType::Occ, Fingerprints<FING_T>::LettersType::Common);
+
+    checkLevKernel<0>(fingerprints);
+    checkLevKernel<1>(fingerprints);
+    checkLevKernel<2>(fingerprints);
+    checkLevKernel<3>(fingerprints);
+}
+
+TEST_CASE("is Leven at most k=1 kernel calculation for selected words correct", "[distance]")
+{
+    Fingerprints<FING_T> fingerprints(Fingerprints<FING_T>::DistanceType::Lev, 
+        Fingerprints<FING_T>::FingerprintType::Occ, Fingerprints<FING_T>::LettersType::Common);
+
+    string str = "aaab";
+
+    vector<string> inStrings { "aaab", "aab", "aaaab", "aaa", "baab", "aabb", "aaaba", "aaacb" };
+    vector<string> outStrings { "ab", "ba", "abba", "bbbb", "aaaabb", "baaa" };
+
+    for (const string &inStr : inStrings)
+    {
+        REQUIRE(FingerprintsWhitebox::isLevAtMost<FING_T, 1>(fingerprints, str.c_str(), str.size(), inStr.c_str(), inStr.size(), 1) == true);
+        REQUIRE(FingerprintsWhitebox::isLevAtMost<FING_T, 1>(fingerprints, inStr.c_str(), inStr.size(), str.c_str(), str.size(), 1) == true);
+    }
+
+    for (const string &outStr : outStrings)
+    {
+        REQUIRE(FingerprintsWhitebox::isLevAtMost<FING_T, 1>(fingerprints, str.c_str(), str.size(), outStr.c_str(), outStr.size(), 1) == false);
+        REQUIRE(FingerprintsWhitebox::isLevAtMost<FING_T, 1>(fingerprints, outStr.c_str(), outStr.size(), str.c_str(), str.size(), 1) == false);
+    }
+}
+
+TEST_CASE("is OSA at most k for swaps calculation correct", "[distance]")
+{
+    Fingerprints<FING_T> fingerprints(Fingerprints<FING_T>::DistanceType::Osa, 
+        Fingerprints<FING_T>::FingerprintType::Occ, Fingerprints<FING_T>::LettersType::Common);
+
+    string str = "jarek";
+
+    vector<string> inStrings { "ajrek", "jraek", "jaerk", "jarke", "jarek" };
+    vector<string> outStrings { "ajrke", "rajek", "kerak", "jkrea" };
+
+    for (const string &inStr : inStrings)
+    {
+        REQUIRE(FingerprintsWhitebox::isOsaAtMostK<FING_T>(fingerprints, str.c_str(), str.size(), inStr.c_str(), inStr.size(), 1) == true);
+        REQUIRE(FingerprintsWhitebox::isOsaAtMostK<FING_T>(fingerprints, inStr.c_str(), inStr.size(), str.c_str(), str.size(), 1) == true);
+
+        // A swap costs 2 edits without transpositions.
+        REQUIRE(FingerprintsWhitebox::isLevAtMostK<FING_T>(fingerprints, str.c_str(), str.size(), inStr.c_str(), inStr.size(), 1) 
+            == (inStr == str));
+    }
+
+    for (const string &outStr : outStrings)
+    {
+        REQUIRE(FingerprintsWhitebox::isOsaAtMostK<FING_T>(fingerprints, str.c_str(), str.size(), outStr.c_str(), outStr.size(), 1) == false);
+        REQUIRE(FingerprintsWhitebox::isOsaAtMostK<FING_T>(fingerprints, outStr.c_str(), outStr.size(), str.c_str(), str.size(), 1) == false);
+    }
+
+    // Optimal string alignment does not edit a substring twice, hence this is 3 and not 2 (as in Damerau-Levenshtein).
+    REQUIRE(FingerprintsWhitebox::isOsaAtMostK<FING_T>(fingerprints, "ca", 2, "abc", 3, 2) == false);
+    REQUIRE(FingerprintsWhitebox::isOsaAtMostK<FING_T>(fingerprints, "ca", 2, "abc", 3, 3) == true);
+}
+
+TEST_CASE("is OSA at most k randomized calculation correct", "[distance]")
+{
+    Fingerprints<FING_T> fingerprints(Fingerprints<FING_T>::DistanceType::Osa, 
+        Fingerprints<FING_T>::FingerprintType::Occ, Fingerprints<FING_T>::LettersType::Common);
+
+    // Sizes around 64 check both the bit-parallel and the DP version.
+    for (int size : { 1, 5, 12, 63, 64, 65, 100 })
+    {
+        repeat(nKernelRepeats / 10, [&fingerprints, size] {
+            string str1 = randomlyEdit(string(size, 'a'), size);
+            string str2 = randomlySwap(randomlyEdit(str1, rand() % 3), rand() % 3);
+
+            const int dist = calcOsaDistance(str1, str2);
+
+            for (int k = 0; k <= 4; ++k)
+            {
+                REQUIRE(FingerprintsWhitebox::isOsaAtMostK<FING_T>(fingerprints, str1.c_str(), str1.size(), str2.c_str(), str2.size(), k) 
+                    == (dist <= k));
+                REQUIRE(FingerprintsWhitebox::isOsaAtMostKDP<FING_T>(fingerprints, str1.c_str(), str1.size(), str2.c_str(), str2.size(), k) 
+                    == (dist <= k));
+            }
+        });
+    }
+}
+
 } // namespace fingerprints
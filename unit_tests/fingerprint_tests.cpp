@@ -1,4 +1,5 @@
 #include <map>
+#include <thread>
 
 #include "catch.hpp"
 #include "repeat.hpp"
@@ -40,7 +41,8 @@ vector<Fingerprints<FING_T>::FingerprintType> fingerprintTypes {
     Fingerprints<FING_T>::FingerprintType::Occ,
     Fingerprints<FING_T>::FingerprintType::OccHalved,
     Fingerprints<FING_T>::FingerprintType::Count,
-    Fingerprints<FING_T>::FingerprintType::Pos
+    Fingerprints<FING_T>::FingerprintType::Pos,
+    Fingerprints<FING_T>::FingerprintType::QGram
 };
 
 vector<Fingerprints<FING_T>::LettersType> lettersTypes {
@@ -49,6 +51,109 @@ vector<Fingerprints<FING_T>::LettersType> lettersTypes {
     Fingerprints<FING_T>::LettersType::Rare
 };
 
+vector<Fingerprints<FING_T>::DistanceType> allDistanceTypes {
+    Fingerprints<FING_T>::DistanceType::Ham,
+    Fingerprints<FING_T>::DistanceType::Lev,
+    Fingerprints<FING_T>::DistanceType::Osa
+};
+
+/** Fingerprint types without FingerprintType::None, for the options which require fingerprints. */
+vector<Fingerprints<FING_T>::FingerprintType> usedFingerprintTypes(fingerprintTypes.begin() + 1, fingerprintTypes.end());
+
+/** Returns [nWords] random words having between [minSize] and [maxSize] chars, mapped onto [alphabet] unless it is empty.
+ * A small alphabet gives many close words, which share their prefixes and their fingerprints. */
+vector<string> genWords(int nWords, int minSize, int maxSize, const string &alphabet = "")
+{
+    vector<string> words;
+    repeat(nWords, [&] {
+        string word = Helpers::genRandomStringAlphNum(minSize + rand() % (maxSize - minSize + 1));
+
+        for (char &c : word)
+        {
+            c = alphabet.empty() ? c : alphabet[static_cast<unsigned char>(c) % alphabet.size()];
+        }
+
+        words.emplace_back(move(word));
+    });
+
+    return words;
+}
+
+/** Returns patterns made from every [step]-th word of [words]: the word itself, the word with a char substituted
+ * with [subChar], the latter with [insChar] inserted, and the word with two adjacent chars swapped and a char deleted. */
+vector<string> genPatterns(const vector<string> &words, size_t step, char subChar, char insChar)
+{
+    vector<string> patterns;
+
+    for (size_t iWord = 0; iWord < words.size(); iWord += step)
+    {
+        string curWord = words[iWord];
+        patterns.push_back(curWord);
+
+        curWord[rand() % curWord.size()] = subChar;
+        patterns.push_back(curWord);
+
+        curWord.insert(curWord.begin() + rand() % curWord.size(), insChar);
+        patterns.push_back(curWord);
+
+        if (words[iWord].size() > 2)
+        {
+            curWord = words[iWord];
+
+            const size_t pos = rand() % (curWord.size() - 1);
+            swap(curWord[pos], curWord[pos + 1]);
+
+            curWord.erase(curWord.begin() + rand() % curWord.size());
+            patterns.emplace_back(move(curWord));
+        }
+    }
+
+    return patterns;
+}
+
+/** Checks that searching [patterns] for k up to [maxCurK] with an index over [words] built with [indexOptions] gives
+ * the same results as a plain scan, for each of [curDistanceTypes] and [curFingerprintTypes]. The index must process
+ * as many words as the scan if [sameProcessedWords] is true and at most as many otherwise, and the processed words
+ * it collects must match their count. Calls [checkIndex] with each index and the corresponding scan. */
+template<typename CheckIndex>
+void requireSameAsScan(const vector<string> &words, const vector<string> &patterns,
+    const vector<Fingerprints<FING_T>::DistanceType> &curDistanceTypes,
+    const vector<Fingerprints<FING_T>::FingerprintType> &curFingerprintTypes,
+    const IndexOptions &indexOptions, int maxCurK, bool sameProcessedWords, CheckIndex checkIndex)
+{
+    for (auto distanceType : curDistanceTypes)
+    {
+        for (auto fingerprintType : curFingerprintTypes)
+        {
+            Fingerprints<FING_T> scanF(distanceType, fingerprintType, Fingerprints<FING_T>::LettersType::Common);
+            scanF.preprocess(words);
+
+            Fingerprints<FING_T> curF(distanceType, fingerprintType, Fingerprints<FING_T>::LettersType::Common, indexOptions);
+            curF.preprocess(words);
+
+            for (int k = 0; k <= maxCurK; ++k)
+            {
+                REQUIRE(curF.test(patterns, k) == scanF.test(patterns, k));
+
+                if (sameProcessedWords)
+                {
+                    REQUIRE(curF.getProcessedWordsCount() == scanF.getProcessedWordsCount());
+                }
+                else
+                {
+                    REQUIRE(curF.getProcessedWordsCount() <= scanF.getProcessedWordsCount());
+                }
+
+                const size_t processedWordsCount = curF.getProcessedWordsCount();
+                curF.test(patterns, k, 1, true);
+                REQUIRE(curF.getProcessedWords().size() == processedWordsCount);
+            }
+
+            checkIndex(curF, scanF);
+        }
+    }
+}
+
 }
 
 TEST_CASE("is initializing using fingerprints correct", "[fingerprints]")
@@ -396,6 +501,851 @@ TEST_CASE("is searching words for k = 2 for Levenshtein one-by-one correct", "[f
     }
 }
 
+TEST_CASE("is searching words for various entry alignments correct", "[fingerprints]")
+{
+    vector<string> words;
+    repeat(maxNStrings, [&words] {
+        words.emplace_back(Helpers::genRandomStringAlphNum(stringSize));
+        words.emplace_back(Helpers::genRandomStringAlphNum(stringSize - 1));
+        words.emplace_back(Helpers::genRandomStringAlphNum(stringSize + 2));
+    });
+
+    vector<string> patterns;
+
+    for (const string &word : words)
+    {
+        string curWord = word;
+        curWord[0] = 'N';
+
+        patterns.emplace_back(move(curWord));
+        patterns.emplace_back(word.substr(1));
+    }
+
+    for (auto distanceType : distanceTypes)
+    {
+        for (auto fingerprintType : fingerprintTypes)
+        {
+            Fingerprints<FING_T> packedF(distanceType, fingerprintType, Fingerprints<FING_T>::LettersType::Common);
+            packedF.preprocess(words);
+
+            for (size_t entryAlignment : { 2, 4, 8, 16 })
+            {
+                IndexOptions indexOptions;
+                indexOptions.entryAlignment = entryAlignment;
+
+                Fingerprints<FING_T> curF(distanceType, fingerprintType, Fingerprints<FING_T>::LettersType::Common, indexOptions);
+                curF.preprocess(words);
+
+                REQUIRE(curF.test(words, 0) == words.size());
+
+                for (int k = 1; k <= 3; ++k)
+                {
+                    REQUIRE(curF.test(patterns, k) == packedF.test(patterns, k));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("is addressing entries for various entry alignments correct", "[fingerprints]")
+{
+    vector<string> words { "ala", "ma", "kota", "a", "jarek", "ma", "psa", "ola" };
+
+    for (auto fingerprintType : fingerprintTypes)
+    {
+        for (size_t entryAlignment : { 1, 2, 4, 8, 16 })
+        {
+            IndexOptions indexOptions;
+            indexOptions.entryAlignment = entryAlignment;
+
+            Fingerprints<FING_T> curF(Fingerprints<FING_T>::DistanceType::Ham, fingerprintType,
+                Fingerprints<FING_T>::LettersType::Common, indexOptions);
+            curF.preprocess(words);
+
+            const size_t fingSize = (fingerprintType == Fingerprints<FING_T>::FingerprintType::None) ? 0 : sizeof(FING_T);
+
+            for (size_t wordSize = 1; wordSize <= 5; ++wordSize)
+            {
+                const size_t stride = curF.calcEntryStride(wordSize);
+
+                REQUIRE(stride % entryAlignment == 0);
+                REQUIRE(stride >= fingSize + wordSize);
+                REQUIRE(stride < fingSize + wordSize + entryAlignment);
+            }
+
+            REQUIRE(curF.getBucketSize(1) == 1);
+            REQUIRE(curF.getBucketSize(2) == 1);
+            REQUIRE(curF.getBucketSize(3) == 3);
+            REQUIRE(curF.getBucketSize(4) == 1);
+            REQUIRE(curF.getBucketSize(5) == 1);
+            REQUIRE(curF.getBucketSize(6) == 0);
+
+            set<string> bucket3;
+
+            for (size_t iEntry = 0; iEntry < curF.getBucketSize(3); ++iEntry)
+            {
+                const char *entry = curF.getEntry(3, iEntry);
+                REQUIRE(reinterpret_cast<uintptr_t>(entry) % entryAlignment == 0);
+
+                bucket3.insert(string(entry + fingSize, 3));
+            }
+
+            REQUIRE(bucket3 == set<string> { "ala", "psa", "ola" });
+            REQUIRE(string(curF.getEntry(5, 0) + fingSize, 5) == "jarek");
+        }
+    }
+}
+
+TEST_CASE("does initializing with bad entry alignment throw", "[fingerprints]")
+{
+    for (size_t entryAlignment : { 0, 3, 6, 12, 32 })
+    {
+        IndexOptions indexOptions;
+        indexOptions.entryAlignment = entryAlignment;
+
+        REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Ham, Fingerprints<FING_T>::FingerprintType::Occ,
+            Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+    }
+}
+
+TEST_CASE("is searching words for huge pages and locked memory correct", "[fingerprints]")
+{
+    vector<string> words { "ala", "ma", "kota", "a", "jarek", "ma", "psa", "ma" };
+    vector<string> patternsIn { "bla", "alak", "alla", "darek", "jaek", "jarrek", "ps" };
+
+    for (auto distanceType : distanceTypes)
+    {
+        for (auto fingerprintType : fingerprintTypes)
+        {
+            Fingerprints<FING_T> defaultF(distanceType, fingerprintType, Fingerprints<FING_T>::LettersType::Common);
+            defaultF.preprocess(words);
+
+            IndexOptions indexOptions;
+            indexOptions.memoryType = IndexMemory::Type::HugePages;
+            indexOptions.lockMemory = true;
+            indexOptions.deletionIndexK = 1;
+
+            Fingerprints<FING_T> curF(distanceType, fingerprintType, Fingerprints<FING_T>::LettersType::Common, indexOptions);
+            curF.preprocess(words);
+
+            // The accept bitmaps are calculated before the first query.
+            REQUIRE(FingerprintsWhitebox::isAcceptCacheEmpty(curF) == (fingerprintType == Fingerprints<FING_T>::FingerprintType::None));
+
+            REQUIRE(curF.test(words, 0) == words.size());
+
+            for (int k = 1; k <= 2; ++k)
+            {
+                REQUIRE(curF.test(patternsIn, k) == defaultF.test(patternsIn, k));
+            }
+        }
+    }
+}
+
+TEST_CASE("is searching words for exact hash correct", "[fingerprints]")
+{
+    vector<string> words = genWords(maxNStrings, stringSize, stringSize);
+    const vector<string> shorterWords = genWords(maxNStrings, stringSize - 1, stringSize - 1);
+    const vector<string> shortWords = genWords(maxNStrings, 2, 5);
+
+    words.insert(words.end(), shorterWords.begin(), shorterWords.end());
+    words.insert(words.end(), shortWords.begin(), shortWords.end());
+
+    const vector<string> patterns = genPatterns(words, 1, 'N', 'a');
+
+    for (size_t entryAlignment : { 1, 8 })
+    {
+        IndexOptions indexOptions;
+        indexOptions.entryAlignment = entryAlignment;
+        indexOptions.exactHash = true;
+
+        requireSameAsScan(words, patterns, distanceTypes, fingerprintTypes, indexOptions, 2, false,
+            [&](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &scanF) {
+                REQUIRE(curF.getExactHashSizeB() >= 2 * sizeof(uint32_t) * words.size());
+                REQUIRE(curF.test(words, 0) == words.size());
+
+                for (const string &pattern : patterns)
+                {
+                    const char *found = curF.findExact(pattern);
+                    REQUIRE((found == nullptr) == (scanF.findExact(pattern) == nullptr));
+
+                    if (found != nullptr)
+                    {
+                        REQUIRE(string(found, pattern.size()) == pattern);
+                    }
+                }
+
+                REQUIRE(curF.findExact("") == nullptr);
+                REQUIRE(curF.findExact(string(stringSize + 10, 'a')) == nullptr);
+            });
+    }
+}
+
+TEST_CASE("is searching words for Levenshtein with insertion at the front correct", "[fingerprints]")
+{
+    // Inserting at the front shifts all positions in a position fingerprint.
+    vector<string> words { "etaoin", "etaoinsh" };
+    vector<string> patterns { "xetaoin", "etaoi", "xxetaoinsh", "tetaoinsh" };
+
+    for (auto fingerprintType : fingerprintTypes)
+    {
+        Fingerprints<FING_T> curF(Fingerprints<FING_T>::DistanceType::Lev, fingerprintType, Fingerprints<FING_T>::LettersType::Common);
+        curF.preprocess(words);
+
+        REQUIRE(curF.test(patterns, 1) == 3);
+        REQUIRE(curF.test(patterns, 2) == 4);
+    }
+}
+
+TEST_CASE("is searching words for OSA correct", "[fingerprints]")
+{
+    vector<string> words;
+    repeat(maxNStrings, [&words] {
+        words.emplace_back(Helpers::genRandomStringAlphNum(stringSize));
+        words.emplace_back(Helpers::genRandomStringAlphNum(8));
+    });
+
+    vector<string> patternsSwapped, patternsEdited;
+
+    for (const string &word : words)
+    {
+        const size_t pos = rand() % (word.size() - 1);
+
+        string curWord = word;
+        swap(curWord[pos], curWord[pos + 1]);
+        patternsSwapped.push_back(curWord);
+
+        curWord.insert(curWord.begin() + pos, 'N');
+        patternsEdited.emplace_back(move(curWord));
+    }
+
+    for (auto fingerprintType : fingerprintTypes)
+    {
+        Fingerprints<FING_T> osaF(Fingerprints<FING_T>::DistanceType::Osa, fingerprintType, Fingerprints<FING_T>::LettersType::Common);
+        osaF.preprocess(words);
+
+        Fingerprints<FING_T> osaNoneF(Fingerprints<FING_T>::DistanceType::Osa, Fingerprints<FING_T>::FingerprintType::None,
+            Fingerprints<FING_T>::LettersType::Common);
+        osaNoneF.preprocess(words);
+
+        REQUIRE(osaF.test(words, 0) == words.size());
+        REQUIRE(osaF.test(patternsSwapped, 1) >= patternsSwapped.size());
+        REQUIRE(osaF.test(patternsEdited, 2) >= patternsEdited.size());
+
+        for (int k = 0; k <= 3; ++k)
+        {
+            REQUIRE(osaF.test(patternsSwapped, k) == osaNoneF.test(patternsSwapped, k));
+            REQUIRE(osaF.test(patternsEdited, k) == osaNoneF.test(patternsEdited, k));
+        }
+    }
+}
+
+TEST_CASE("is searching words with normalization correct", "[fingerprints]")
+{
+    vector<string> words { "Caf\xE9", "CAFE", "na\xEFve", "Stra\xDF" "e", "r\xE9sum\xE9", "\xC9t\xE9", "long-term" };
+    // "Caf\xE9" and "CAFE" are the same word after normalization.
+    vector<string> patterns { "cafe", "NAIVE", "stra\xDF" "e", "resume", "ete", "LONG_TERM" };
+    vector<string> patternsEdited { "cafes", "naiv", "strasse", "resumes", "etes", "lang_term" };
+
+    IndexOptions indexOptions;
+    indexOptions.normalizationTable = Normalization::makeTable(Normalization::Type::Latin1);
+    Normalization::addMapping(indexOptions.normalizationTable, "-", "_");
+
+    for (auto fingerprintType : fingerprintTypes)
+    {
+        for (auto distanceType : distanceTypes)
+        {
+            Fingerprints<FING_T> fingerprints(distanceType, fingerprintType, Fingerprints<FING_T>::LettersType::Common, indexOptions);
+            fingerprints.preprocess(words);
+
+            REQUIRE(fingerprints.test(patterns, 0) == 6);
+            REQUIRE(fingerprints.findExact("CAF\xC9") != nullptr);
+            REQUIRE(fingerprints.findExact("cafes") == nullptr);
+
+            if (distanceType == Fingerprints<FING_T>::DistanceType::Lev)
+            {
+                REQUIRE(fingerprints.test(patternsEdited, 1) == 5);
+            }
+        }
+    }
+
+    indexOptions.normalizationTable.resize(10);
+    REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Ham, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+}
+
+TEST_CASE("is searching words with bytes above 127 correct", "[fingerprints]")
+{
+    vector<string> words;
+    repeat(maxNStrings, [&words] {
+        string word = Helpers::genRandomStringAlphNum(stringSize);
+        word[rand() % word.size()] = static_cast<char>(128 + rand() % 128);
+
+        words.emplace_back(move(word));
+    });
+
+    for (auto fingerprintType : fingerprintTypes)
+    {
+        Fingerprints<FING_T> fingerprints(Fingerprints<FING_T>::DistanceType::Lev, fingerprintType,
+            Fingerprints<FING_T>::LettersType::Common);
+        fingerprints.preprocess(words);
+
+        Fingerprints<FING_T> noneF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::None,
+            Fingerprints<FING_T>::LettersType::Common);
+        noneF.preprocess(words);
+
+        REQUIRE(fingerprints.test(words, 0) == static_cast<int>(unordered_set<string>(words.begin(), words.end()).size()));
+
+        for (int k = 1; k <= 2; ++k)
+        {
+            REQUIRE(fingerprints.test(words, k) == noneF.test(words, k));
+        }
+    }
+}
+
+TEST_CASE("is searching words in UTF-8 mode correct", "[fingerprints]")
+{
+    vector<string> words { "żółw", "zolw", "łódź", "gęś", "Ärger" };
+
+    IndexOptions indexOptions;
+    indexOptions.utf8 = true;
+
+    for (auto fingerprintType : fingerprintTypes)
+    {
+        for (auto distanceType : distanceTypes)
+        {
+            Fingerprints<FING_T> fingerprints(distanceType, fingerprintType, Fingerprints<FING_T>::LettersType::Common, indexOptions);
+            fingerprints.preprocess(words);
+
+            REQUIRE(fingerprints.test(words, 0) == 5);
+            REQUIRE(fingerprints.findExact("łódź") != nullptr);
+
+            // Each of these differs from a single word by a single substituted code point (2 bytes).
+            REQUIRE(fingerprints.test({ "żólw" }, 1) == 1);
+            REQUIRE(fingerprints.test({ "zółw" }, 1) == 1);
+            REQUIRE(fingerprints.test({ "zolw" }, 3) == 2);
+
+            // Code points which are not in the dictionary and invalid sequences do not match anything.
+            REQUIRE(fingerprints.test({ "żółϖ" }, 0) == 0);
+            REQUIRE(fingerprints.test({ "żółϖ" }, 1) == 1);
+            REQUIRE(fingerprints.test({ "\xFF\xFE" }, 0) == 0);
+            REQUIRE(fingerprints.test({ "ż\xC5" "łw" }, 1) == 1);
+
+            if (distanceType == Fingerprints<FING_T>::DistanceType::Lev)
+            {
+                REQUIRE(fingerprints.test({ "gęsi" }, 1) == 0);
+                REQUIRE(fingerprints.test({ "gęsi" }, 2) == 1);
+                REQUIRE(fingerprints.test({ "łódźka" }, 2) == 1);
+            }
+        }
+
+        // The same search on bytes counts each substituted code point as 2 errors.
+        Fingerprints<FING_T> bytesF(Fingerprints<FING_T>::DistanceType::Lev, fingerprintType, Fingerprints<FING_T>::LettersType::Common);
+        bytesF.preprocess(words);
+
+        REQUIRE(bytesF.test({ "żólw" }, 1) == 0);
+        REQUIRE(bytesF.test({ "żólw" }, 2) == 1);
+    }
+
+    // Latin-1 normalization applies to the decoded code points.
+    indexOptions.normalizationTable = Normalization::makeTable(Normalization::Type::Latin1);
+
+    Fingerprints<FING_T> normalizedF(Fingerprints<FING_T>::DistanceType::Ham, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions);
+    normalizedF.preprocess(words);
+
+    REQUIRE(normalizedF.test({ "arger", "ARGER", "Ärger" }, 0) == 3);
+    REQUIRE(normalizedF.test({ "łódź", "łodź", "ŁÓDŹ" }, 0) == 2);
+
+    // Code points above U+00FF are not normalized.
+    REQUIRE(normalizedF.test({ "lodz", "lodź" }, 0) == 0);
+}
+
+TEST_CASE("is preprocessing invalid words and too many code points in UTF-8 mode correct", "[fingerprints]")
+{
+    IndexOptions indexOptions;
+    indexOptions.utf8 = true;
+
+    Fingerprints<FING_T> badWordF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions);
+    REQUIRE_THROWS_AS(badWordF.preprocess({ "ala", "ma\xC5" }), invalid_argument);
+
+    // Cyrillic U+0400 - U+047F, 128 code points which do not fit in the code units.
+    vector<string> words;
+
+    for (uint32_t codePoint = 0x400; codePoint < 0x480; ++codePoint)
+    {
+        words.push_back({ static_cast<char>(0xC0 | (codePoint >> 6)), static_cast<char>(0x80 | (codePoint & 0x3F)) });
+    }
+
+    // Repeating U+047F makes it more frequent than the others.
+    words.push_back(words.back() + words.back());
+
+    Fingerprints<FING_T> sharedF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions);
+    sharedF.preprocess(words);
+
+    // The two least frequent code points, U+047D and U+047E, share a code unit.
+    REQUIRE(sharedF.getSharedCodePointsCount() == 2);
+    REQUIRE(sharedF.test(words, 0) == static_cast<int>(words.size()));
+    REQUIRE(sharedF.test({ words[0x7D] }, 0) == 1);
+    // U+047F U+047F by a substitution, U+047F and the shared code unit by a deletion.
+    REQUIRE(sharedF.test({ words[0x7F] + words[0x7D] }, 1) == 3);
+
+    words.pop_back();
+    words.pop_back();
+
+    Fingerprints<FING_T> fullF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions);
+    fullF.preprocess(words);
+
+    REQUIRE(fullF.getSharedCodePointsCount() == 0);
+    REQUIRE(fullF.test(words, 0) == static_cast<int>(words.size()));
+}
+
+TEST_CASE("is searching words for deletion index correct", "[fingerprints]")
+{
+    // Words over a small alphabet have many repeated characters and many neighbors.
+    const vector<string> words = genWords(maxNStrings, 1, 10, "abc");
+
+    vector<string> patterns = genPatterns(words, 1, 'a', 'c');
+    patterns.push_back(string(20, 'b'));
+
+    for (int deletionIndexK : { 1, 3 })
+    {
+        IndexOptions indexOptions;
+        indexOptions.deletionIndexK = deletionIndexK;
+        indexOptions.exactHash = (deletionIndexK == 3);
+
+        requireSameAsScan(words, patterns, allDistanceTypes, fingerprintTypes, indexOptions, deletionIndexK + 1, false,
+            [&](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &) {
+                REQUIRE(curF.getDeletionIndexSizeB() > 0);
+                REQUIRE(curF.getDeletionPostingsCount() >= words.size());
+            });
+    }
+}
+
+TEST_CASE("does initializing with bad deletion index k throw", "[fingerprints]")
+{
+    for (int deletionIndexK : { -2, 5, 10 })
+    {
+        IndexOptions indexOptions;
+        indexOptions.deletionIndexK = deletionIndexK;
+
+        REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+            Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+    }
+}
+
+TEST_CASE("is searching words for partition index correct", "[fingerprints]")
+{
+    // Long words are split into segments, the shortest ones are not split at all.
+    const vector<string> words = genWords(maxNStrings, 1, 40, "abcd");
+    const vector<string> patterns = genPatterns(words, 1, 'a', 'c');
+
+    for (int partitionIndexK : { 1, 2 })
+    {
+        // With both indexes built, the deletion index takes k = 0 and 1 and the partition index takes k = 2.
+        IndexOptions indexOptions;
+        indexOptions.partitionIndexK = partitionIndexK;
+        indexOptions.deletionIndexK = (partitionIndexK == 2) ? 1 : -1;
+
+        requireSameAsScan(words, patterns, allDistanceTypes, fingerprintTypes, indexOptions, partitionIndexK + 1, false,
+            [](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &) {
+                REQUIRE(curF.getPartitionIndexSizeB() > 0);
+                REQUIRE(curF.getPartitionPostingsCount() > 0);
+            });
+    }
+}
+
+TEST_CASE("does initializing with bad partition index k throw", "[fingerprints]")
+{
+    for (int partitionIndexK : { -2, 9, 20 })
+    {
+        IndexOptions indexOptions;
+        indexOptions.partitionIndexK = partitionIndexK;
+
+        REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+            Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+    }
+}
+
+TEST_CASE("is searching words with planner correct", "[fingerprints]")
+{
+    using Plan = Fingerprints<FING_T>::Plan;
+
+    const vector<string> words = genWords(maxNStrings, 1, 20, "abcd");
+    const vector<string> patterns = genPatterns(words, 1, 'b', 'c');
+
+    IndexOptions indexOptions;
+    indexOptions.planner = true;
+    indexOptions.exactHash = true;
+    indexOptions.deletionIndexK = 1;
+    indexOptions.partitionIndexK = 2;
+
+    requireSameAsScan(words, patterns, allDistanceTypes,
+        { Fingerprints<FING_T>::FingerprintType::None, Fingerprints<FING_T>::FingerprintType::Occ }, indexOptions, 4, false,
+        [&](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &scanF) {
+            for (int k = 0; k <= 4; ++k)
+            {
+                curF.test(patterns, k);
+
+                size_t nPlanned = 0;
+
+                for (size_t iPlan = 0; iPlan < Fingerprints<FING_T>::nPlans; ++iPlan)
+                {
+                    nPlanned += curF.getPlanCount(static_cast<Plan>(iPlan));
+                }
+
+                REQUIRE(nPlanned == patterns.size());
+                REQUIRE((curF.getPlanUnitCostNs(Plan::WordScan, k) >= 0.0f) == (k <= 3));
+                REQUIRE((curF.getPlanUnitCostNs(Plan::ExactHash, k) >= 0.0f) == (k == 0));
+                REQUIRE((curF.getPlanUnitCostNs(Plan::DeletionIndex, k) >= 0.0f) == (k <= 1));
+            }
+
+            // Each plan must give the same results when it is chosen for all patterns.
+            for (int k = 0; k <= 3; ++k)
+            {
+                for (size_t iPlan = 0; iPlan < Fingerprints<FING_T>::nPlans; ++iPlan)
+                {
+                    const Plan plan = static_cast<Plan>(iPlan);
+
+                    if (curF.getPlanUnitCostNs(plan, k) < 0.0f)
+                    {
+                        continue;
+                    }
+
+                    FingerprintsWhitebox::forcePlan(curF, plan, k);
+
+                    REQUIRE(curF.test(patterns, k) == scanF.test(patterns, k));
+                    REQUIRE(curF.getPlanCount(plan) == patterns.size());
+
+                    const size_t processedWordsCount = curF.getProcessedWordsCount();
+                    curF.test(patterns, k, 1, true);
+                    REQUIRE(curF.getProcessedWords().size() == processedWordsCount);
+                }
+            }
+        });
+}
+
+TEST_CASE("are planner samples made from words before normalization", "[fingerprints]")
+{
+    // Samples taken from the mapped words would be mapped again by the kernels, and decoded code units above 127
+    // are not valid UTF-8, hence such samples would not match anything.
+    const vector<string> words { "żółw", "łódź", "gęś", "Ärger", "ćma", "źdźbło" };
+
+    IndexOptions utf8Options;
+    utf8Options.utf8 = true;
+    utf8Options.planner = true;
+
+    // A mapping which is not idempotent, mapping twice gives other words.
+    IndexOptions mapOptions;
+    mapOptions.normalizationTable = Normalization::makeTable(Normalization::Type::Identity);
+    mapOptions.normalizationTable['a'] = 'b';
+    mapOptions.normalizationTable['b'] = 'c';
+    mapOptions.planner = true;
+
+    const vector<string> mapWords { "abba", "baba", "cab", "banana", "abc" };
+
+    for (auto curCase : { make_pair(utf8Options, words), make_pair(mapOptions, mapWords) })
+    {
+        Fingerprints<FING_T> curF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+            Fingerprints<FING_T>::LettersType::Common, curCase.first);
+        curF.preprocess(curCase.second);
+
+        const vector<string> samples = FingerprintsWhitebox::makePlannerSamples(curF, curCase.second);
+        REQUIRE(samples.size() == curCase.second.size());
+
+        for (const string &sample : samples)
+        {
+            REQUIRE(curF.test({ sample }, 1) >= 1);
+        }
+    }
+}
+
+TEST_CASE("is searching words with fingerprint groups correct", "[fingerprints]")
+{
+    // A small alphabet makes many words share their fingerprints.
+    const vector<string> words = genWords(maxNStrings, 1, 12, "etaoz");
+    const vector<string> patterns = genPatterns(words, 1, 'n', 'a');
+
+    IndexOptions indexOptions;
+    indexOptions.fingerprintGroups = true;
+
+    const size_t nUniqueWords = unordered_set<string>(words.begin(), words.end()).size();
+
+    requireSameAsScan(words, patterns, allDistanceTypes, usedFingerprintTypes, indexOptions, 3, true,
+        [&](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &) {
+            REQUIRE(curF.getFingerprintGroupsCount() > 0);
+            REQUIRE(curF.getFingerprintGroupsCount() <= nUniqueWords);
+            REQUIRE(curF.getFingerprintGroupsSizeB() > 0);
+        });
+
+    // Anagrams share their occurrence fingerprints.
+    Fingerprints<FING_T> anagramsF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions);
+    anagramsF.preprocess({ "ate", "eat", "tea", "toe" });
+
+    REQUIRE(anagramsF.getFingerprintGroupsCount() == 2);
+}
+
+TEST_CASE("does initializing fingerprint groups without fingerprints throw", "[fingerprints]")
+{
+    IndexOptions indexOptions;
+    indexOptions.fingerprintGroups = true;
+
+    for (auto distanceType : distanceTypes)
+    {
+        REQUIRE_THROWS_AS(Fingerprints<FING_T>(distanceType, Fingerprints<FING_T>::FingerprintType::None,
+            Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+    }
+}
+
+TEST_CASE("is searching words with fingerprint neighborhood correct", "[fingerprints]")
+{
+    // Large brackets get neighborhood directories, the brackets of the long words are scanned.
+    // Lowercase letters only, so that most words have distinct fingerprints.
+    const string alphabet = "abcdefghijklmnopqrstuvwxyz";
+
+    vector<string> words = genWords(maxNStrings * 16, 6, 7, alphabet);
+    const vector<string> longWords = genWords(maxNStrings, 8, 15, alphabet);
+    words.insert(words.end(), longWords.begin(), longWords.end());
+
+    const vector<string> patterns = genPatterns(words, 8, 'e', 'a');
+
+    IndexOptions indexOptions;
+    indexOptions.fingerprintGroups = true;
+    indexOptions.fingerprintNeighborhood = true;
+
+    // A single word gives no directories.
+    Fingerprints<FING_T> smallF(Fingerprints<FING_T>::DistanceType::Ham, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions);
+    smallF.preprocess({ "ala" });
+
+    requireSameAsScan(words, patterns, allDistanceTypes, usedFingerprintTypes, indexOptions, 3, true,
+        [&](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &) {
+            REQUIRE(curF.getFingerprintNeighborhoodSizeB() > smallF.getFingerprintNeighborhoodSizeB());
+        });
+}
+
+TEST_CASE("does initializing fingerprint neighborhood without groups throw", "[fingerprints]")
+{
+    IndexOptions indexOptions;
+    indexOptions.fingerprintNeighborhood = true;
+
+    REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+}
+
+TEST_CASE("is searching words with popcount buckets correct", "[fingerprints]")
+{
+    const vector<string> words = genWords(maxNStrings * 4, 1, 12);
+    const vector<string> patterns = genPatterns(words, 2, 'e', 't');
+
+    for (bool fingerprintGroups : { false, true })
+    {
+        IndexOptions indexOptions;
+        indexOptions.popcountBuckets = true;
+        indexOptions.fingerprintGroups = fingerprintGroups;
+
+        requireSameAsScan(words, patterns, allDistanceTypes, usedFingerprintTypes, indexOptions, 3, true,
+            [](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &) {
+                REQUIRE(curF.getPopcountBucketsSizeB() > 0);
+            });
+    }
+}
+
+TEST_CASE("does initializing popcount buckets with bad options throw", "[fingerprints]")
+{
+    IndexOptions indexOptions;
+    indexOptions.popcountBuckets = true;
+
+    REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::None,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+
+    indexOptions.fingerprintGroups = true;
+    indexOptions.fingerprintNeighborhood = true;
+
+    REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+}
+
+TEST_CASE("is searching words with packed words correct", "[fingerprints]")
+{
+    // 4 distinct chars give 4-bit codes and 20 give 5-bit codes, long words take several lanes.
+    for (const string alphabet : { "ACGT", "abcdefghijklmnopqrst" })
+    {
+        const vector<string> words = genWords(maxNStrings * 4, 1, 40, alphabet);
+
+        // Chars from outside the alphabet of the dictionary mismatch everything.
+        const vector<string> patterns = genPatterns(words, 2, 'z', alphabet[0]);
+
+        IndexOptions indexOptions;
+        indexOptions.packedWords = true;
+
+        requireSameAsScan(words, patterns, { Fingerprints<FING_T>::DistanceType::Ham },
+            { Fingerprints<FING_T>::FingerprintType::None }, indexOptions, 4, true,
+            [&](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &) {
+                REQUIRE(curF.getPackedBits() == ((alphabet.size() < 16) ? 4u : 5u));
+                REQUIRE(curF.getPackedWordsSizeB() > 0);
+            });
+    }
+}
+
+TEST_CASE("does initializing packed words with bad options throw", "[fingerprints]")
+{
+    IndexOptions indexOptions;
+    indexOptions.packedWords = true;
+
+    REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::None,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+
+    // 36 distinct chars do not fit in 5-bit codes.
+    Fingerprints<FING_T> curF(Fingerprints<FING_T>::DistanceType::Ham, Fingerprints<FING_T>::FingerprintType::None,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions);
+
+    REQUIRE_THROWS_AS(curF.preprocess({ "abcdefghijklmnopqrstuvwxyz0123456789" }), invalid_argument);
+}
+
+TEST_CASE("is searching words with front coding correct", "[fingerprints]")
+{
+    // A small alphabet gives long shared prefixes.
+    const vector<string> words = genWords(maxNStrings * 4, 1, 16, "abc");
+    const vector<string> patterns = genPatterns(words, 2, 'z', 'b');
+
+    IndexOptions indexOptions;
+    indexOptions.frontCoding = true;
+
+    requireSameAsScan(words, patterns, { Fingerprints<FING_T>::DistanceType::Lev }, fingerprintTypes, indexOptions, 4, true,
+        [&patterns](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &scanF) {
+            REQUIRE(curF.getFrontCodedSizeB() > 0);
+
+            // Nothing else needs the dictionary array, only the front coded words are kept.
+            REQUIRE(curF.isFrontCodedOnly());
+            REQUIRE(curF.getFingArraySizeB() == 0);
+            REQUIRE(curF.getFrontCodedSizeB() < scanF.getFingArraySizeB());
+            REQUIRE_THROWS_AS(curF.findExact(patterns[0]), logic_error);
+
+            // Front coded brackets are sorted, so the words are processed in a different order.
+            curF.test(patterns, 1, 1, true);
+            scanF.test(patterns, 1, 1, true);
+
+            vector<string> processedWords = curF.getProcessedWords();
+            vector<string> scanProcessedWords = scanF.getProcessedWords();
+            sort(processedWords.begin(), processedWords.end());
+            sort(scanProcessedWords.begin(), scanProcessedWords.end());
+            REQUIRE(processedWords == scanProcessedWords);
+        });
+
+    // The exact hash addresses the dictionary array, which is then kept, and answers k = 0 without scanning.
+    indexOptions.exactHash = true;
+
+    requireSameAsScan(words, patterns, { Fingerprints<FING_T>::DistanceType::Lev }, fingerprintTypes, indexOptions, 4, false,
+        [&patterns](Fingerprints<FING_T> &curF, Fingerprints<FING_T> &scanF) {
+            REQUIRE(not curF.isFrontCodedOnly());
+            REQUIRE(curF.getFingArraySizeB() == scanF.getFingArraySizeB());
+            REQUIRE((curF.findExact(patterns[0]) == nullptr) == (scanF.findExact(patterns[0]) == nullptr));
+        });
+}
+
+TEST_CASE("does initializing front coding with bad options throw", "[fingerprints]")
+{
+    IndexOptions indexOptions;
+    indexOptions.frontCoding = true;
+
+    for (auto distanceType : { Fingerprints<FING_T>::DistanceType::Ham, Fingerprints<FING_T>::DistanceType::Osa })
+    {
+        REQUIRE_THROWS_AS(Fingerprints<FING_T>(distanceType, Fingerprints<FING_T>::FingerprintType::Occ,
+            Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+    }
+
+    indexOptions.fingerprintGroups = true;
+
+    REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+}
+
+TEST_CASE("is testing with separate query contexts from multiple threads correct", "[fingerprints]")
+{
+    constexpr int nThreads = 4;
+    constexpr int maxCurK = 3;
+
+    // Large brackets get neighborhood directories.
+    vector<string> words = genWords(maxNStrings * 8, 6, 7, "abcdefghijklmnopqrstuvwxyz");
+    const vector<string> shortWords = genWords(maxNStrings * 4, 1, 12);
+    words.insert(words.end(), shortWords.begin(), shortWords.end());
+
+    const vector<string> patterns = genPatterns(words, 4, 'z', 'a');
+
+    // The accept bitmaps, accepted xors, and maximum accepted weights are calculated on first use,
+    // which happens concurrently since the threads query fresh indexes.
+    IndexOptions neighborhoodOptions;
+    neighborhoodOptions.fingerprintGroups = true;
+    neighborhoodOptions.fingerprintNeighborhood = true;
+
+    IndexOptions popcountOptions;
+    popcountOptions.popcountBuckets = true;
+
+    IndexOptions plannerOptions;
+    plannerOptions.deletionIndexK = 1;
+    plannerOptions.planner = true;
+
+    for (auto distanceType : allDistanceTypes)
+    {
+        Fingerprints<FING_T> scanF(distanceType, Fingerprints<FING_T>::FingerprintType::Occ,
+            Fingerprints<FING_T>::LettersType::Common);
+        scanF.preprocess(words);
+
+        for (const IndexOptions &indexOptions : { neighborhoodOptions, popcountOptions, plannerOptions })
+        {
+            Fingerprints<FING_T> curF(distanceType, Fingerprints<FING_T>::FingerprintType::Occ,
+                Fingerprints<FING_T>::LettersType::Common, indexOptions);
+            curF.preprocess(words);
+
+            // Planner calibration runs queries while preprocessing.
+            if (not indexOptions.planner)
+            {
+                REQUIRE(FingerprintsWhitebox::isAcceptCacheEmpty(curF));
+            }
+
+            vector<vector<int>> nThreadMatches(nThreads, vector<int>(maxCurK + 1, -1));
+            vector<vector<size_t>> threadProcessedWordsCounts(nThreads, vector<size_t>(maxCurK + 1, 0));
+            vector<thread> threads;
+
+            for (int iThread = 0; iThread < nThreads; ++iThread)
+            {
+                threads.emplace_back([&, iThread] {
+                    Fingerprints<FING_T>::QueryContext context;
+
+                    for (int k = 0; k <= maxCurK; ++k)
+                    {
+                        nThreadMatches[iThread][k] = curF.test(context, patterns, k);
+                        threadProcessedWordsCounts[iThread][k] = context.getProcessedWordsCount();
+                    }
+                });
+            }
+
+            for (thread &curThread : threads)
+            {
+                curThread.join();
+            }
+
+            for (int k = 0; k <= maxCurK; ++k)
+            {
+                const int nMatches = scanF.test(patterns, k);
+
+                curF.test(patterns, k);
+                const size_t processedWordsCount = curF.getProcessedWordsCount();
+
+                for (int iThread = 0; iThread < nThreads; ++iThread)
+                {
+                    REQUIRE(nThreadMatches[iThread][k] == nMatches);
+                    REQUIRE(threadProcessedWordsCounts[iThread][k] == processedWordsCount);
+                }
+            }
+        }
+    }
+}
+
 TEST_CASE("is calculating rejection for k = 1 for occurrence common fingerprints correct", "[fingerprints]")
 {
     vector<string> words { "kotaa", "jacek", "piesy" };
@@ -689,6 +1639,12 @@ TEST_CASE("is initializing errors LUT correct", "[fingerprints]")
     {
         for (auto fingerprintType : fingerprintTypes)
         {
+            // Each q-gram error accounts for more mismatches, which is checked separately.
+            if (fingerprintType == Fingerprints<FING_T>::FingerprintType::QGram)
+            {
+                continue;
+            }
+
             for (auto lettersType : lettersTypes)
             {
                 Fingerprints<FING_T> fingerprints(distanceType, fingerprintType, lettersType);
@@ -1110,6 +2066,186 @@ TEST_CASE("is Hamming weight calculation correct", "[fingerprints]")
     REQUIRE(FingerprintsWhitebox::calcHammingWeight<FING_T>(65535) == 16); // 2^16 - 1
 }
 
+TEST_CASE("is calculating prefetch distance correct", "[fingerprints]")
+{
+    // Entries shorter than a cache line are not prefetched.
+    for (size_t entrySize = 1; entrySize < 64; ++entrySize)
+    {
+        REQUIRE(FingerprintsWhitebox::calcPrefetchDistance<FING_T>(entrySize) == 0);
+    }
+
+    REQUIRE(FingerprintsWhitebox::calcPrefetchDistance<FING_T>(64) == 32);
+    REQUIRE(FingerprintsWhitebox::calcPrefetchDistance<FING_T>(71) == 28); // URL queries (69 chars) + fingerprint.
+    REQUIRE(FingerprintsWhitebox::calcPrefetchDistance<FING_T>(256) == 8);
+    REQUIRE(FingerprintsWhitebox::calcPrefetchDistance<FING_T>(1024) == 4);
+    REQUIRE(FingerprintsWhitebox::calcPrefetchDistance<FING_T>(2050) == 4);
+}
+
+TEST_CASE("is calculating accept bitmaps correct", "[fingerprints]")
+{
+    for (auto distanceType : distanceTypes)
+    {
+        for (auto fingerprintType = fingerprintTypes.begin() + 1; fingerprintType != fingerprintTypes.end(); 
+            ++fingerprintType)
+        {
+            Fingerprints<FING_T> curF(distanceType, *fingerprintType, Fingerprints<FING_T>::LettersType::Common);
+
+            for (int nErrors : { 0, 1, 2, 3, 4, 5, 8, 16, 17, 100 })
+            {
+                const uint64_t *acceptBitmap = FingerprintsWhitebox::getAcceptBitmap(curF, nErrors);
+                REQUIRE(acceptBitmap == FingerprintsWhitebox::getAcceptBitmap(curF, nErrors));
+
+                size_t nMismatches = 0;
+
+                const unsigned char *nMismatchesLUT = FingerprintsWhitebox::getNMismatchesLUT(curF);
+
+                for (size_t x = 0; x <= numeric_limits<FING_T>::max(); ++x)
+                {
+                    const bool expected = (distanceType == Fingerprints<FING_T>::DistanceType::Ham)
+                        ? FingerprintsWhitebox::calcNErrors<FING_T>(curF, 0, x) <= nErrors
+                        : FingerprintsWhitebox::calcLevNErrors(curF, nMismatchesLUT[x], 0) <= nErrors;
+                    nMismatches += (FingerprintsWhitebox::isAccepted<FING_T>(acceptBitmap, x) != expected);
+                }
+
+                REQUIRE(nMismatches == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("is calculating q-gram fingerprint correct", "[fingerprints]")
+{
+    for (size_t qgramSize : { 2, 3 })
+    {
+        IndexOptions indexOptions;
+        indexOptions.qgramSize = qgramSize;
+
+        Fingerprints<FING_T> fingerprints(Fingerprints<FING_T>::DistanceType::Ham, Fingerprints<FING_T>::FingerprintType::QGram,
+            Fingerprints<FING_T>::LettersType::Common, indexOptions);
+        auto calcFingerprint = FingerprintsWhitebox::getCalcFingerprintFun(fingerprints);
+
+        // Too short for a single gram.
+        REQUIRE(calcFingerprint("", 0) == 0);
+        REQUIRE(calcFingerprint("ab", qgramSize - 1) == 0);
+
+        // A single gram sets a single bit.
+        REQUIRE(FingerprintsWhitebox::calcHammingWeight<FING_T>(calcFingerprint("abc", qgramSize)) == 1);
+
+        // A gram occurring twice cancels out.
+        const string gram = string("xyz").substr(0, qgramSize);
+        REQUIRE(calcFingerprint((gram + gram).c_str(), 2 * qgramSize) == 
+            calcFingerprint((gram + gram).c_str() + 1, 2 * qgramSize - 2));
+
+        // The fingerprint combines grams of both parts, which overlap by q - 1 characters.
+        const string str = "http://www.example.com/index";
+        const size_t half = str.size() / 2;
+
+        REQUIRE(calcFingerprint(str.c_str(), str.size()) == 
+            (calcFingerprint(str.c_str(), half + qgramSize - 1) ^ calcFingerprint(str.c_str() + half, str.size() - half)));
+
+        // Each error accounts for up to 2q mismatches.
+        const unsigned char *nErrorsLUT = FingerprintsWhitebox::getNErrorsLUT(fingerprints);
+
+        REQUIRE(nErrorsLUT[0] == 0);
+        REQUIRE(nErrorsLUT[1] == 1);
+        REQUIRE(nErrorsLUT[2 * qgramSize] == 1);
+        REQUIRE(nErrorsLUT[2 * qgramSize + 1] == 2);
+    }
+}
+
+TEST_CASE("does initializing with bad q-gram size throw", "[fingerprints]")
+{
+    for (size_t qgramSize : { 0, 1, 4, 10 })
+    {
+        IndexOptions indexOptions;
+        indexOptions.qgramSize = qgramSize;
+
+        REQUIRE_THROWS_AS(Fingerprints<FING_T>(Fingerprints<FING_T>::DistanceType::Ham, Fingerprints<FING_T>::FingerprintType::QGram,
+            Fingerprints<FING_T>::LettersType::Common, indexOptions), invalid_argument);
+    }
+}
+
+TEST_CASE("is calculating Levenshtein number of errors for size differences correct", "[fingerprints]")
+{
+    Fingerprints<FING_T> occF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Occ,
+        Fingerprints<FING_T>::LettersType::Common);
+
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 0, 0) == 0);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 1, 0) == 1);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 2, 0) == 1);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 4, 0) == 2);
+
+    // A single insertion or deletion changes at most one occurrence.
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 0, 1) == 1);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 1, 1) == 1);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 2, 1) == 2);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 3, 1) == 2);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 4, 2) == 3);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occF, 16, 3) == 10);
+
+    Fingerprints<FING_T> occHalvedF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::OccHalved,
+        Fingerprints<FING_T>::LettersType::Common);
+
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occHalvedF, 3, 1) == 1);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occHalvedF, 4, 1) == 2);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(occHalvedF, 6, 0) == 2);
+
+    Fingerprints<FING_T> posF(Fingerprints<FING_T>::DistanceType::Lev, Fingerprints<FING_T>::FingerprintType::Pos,
+        Fingerprints<FING_T>::LettersType::Common);
+
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(posF, 6, 1) == 1);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(posF, 2, 0) == 1);
+    REQUIRE(FingerprintsWhitebox::calcLevNErrors(posF, 6, 0) == 2);
+}
+
+TEST_CASE("are Levenshtein accept bitmaps for size differences not rejecting matching words", "[fingerprints]")
+{
+    for (auto fingerprintType = fingerprintTypes.begin() + 1; fingerprintType != fingerprintTypes.end(); 
+        ++fingerprintType)
+    {
+        Fingerprints<FING_T> curF(Fingerprints<FING_T>::DistanceType::Lev, *fingerprintType, Fingerprints<FING_T>::LettersType::Common);
+        auto calcFingerprint = FingerprintsWhitebox::getCalcFingerprintFun(curF);
+
+        repeat(maxNStrings * 20, [&curF, &calcFingerprint] {
+            // Only fingerprint letters, so that most edits change the fingerprint.
+            const string letters = "etaoinsh";
+            string str1, str2;
+
+            for (int i = 1 + rand() % 10; i > 0; --i)
+            {
+                str1 += letters[rand() % letters.size()];
+            }
+
+            str2 = str1;
+
+            for (int i = 1 + rand() % 3; i > 0; --i)
+            {
+                const size_t pos = rand() % (str2.size() + 1);
+
+                if (rand() % 2 == 0 or str2.size() <= 1)
+                {
+                    str2.insert(str2.begin() + pos, letters[rand() % letters.size()]);
+                }
+                else
+                {
+                    str2.erase(min(pos, str2.size() - 1), 1);
+                }
+            }
+
+            const size_t lenDiff = (str1.size() > str2.size()) ? str1.size() - str2.size() : str2.size() - str1.size();
+            const FING_T fingXor = calcFingerprint(str1.c_str(), str1.size()) ^ calcFingerprint(str2.c_str(), str2.size());
+
+            for (int k = lenDiff; k <= 4; ++k)
+            {
+                if (FingerprintsWhitebox::isLevAtMostK(curF, str1.c_str(), str1.size(), str2.c_str(), str2.size(), k))
+                {
+                    REQUIRE(FingerprintsWhitebox::isAccepted<FING_T>(FingerprintsWhitebox::getAcceptBitmap(curF, k, lenDiff), fingXor));
+                }
+            }
+        });
+    }
+}
+
 TEST_CASE("is calculcating number of errors for occurrence fingerprint for common letters correct", "[fingerprints]")
 {
     for (auto distanceType : distanceTypes)
@@ -87,6 +87,30 @@ public:
         return fingerprints.calcNErrors(f1, f2);
     }
 
+    template<typename FING_T>
+    inline static size_t calcPrefetchDistance(size_t entrySize)
+    {
+        return Fingerprints<FING_T>::calcPrefetchDistance(entrySize);
+    }
+
+    template<typename FING_T>
+    inline static const uint64_t *getAcceptBitmap(Fingerprints<FING_T> &fingerprints, int nErrors, size_t lenDiff = 0)
+    {
+        return fingerprints.getAcceptBitmap(nErrors, lenDiff);
+    }
+
+    template<typename FING_T>
+    inline static unsigned char calcLevNErrors(const Fingerprints<FING_T> &fingerprints, size_t nMismatches, size_t lenDiff)
+    {
+        return fingerprints.calcLevNErrors(nMismatches, lenDiff);
+    }
+
+    template<typename FING_T>
+    inline static bool isAccepted(const uint64_t *acceptBitmap, FING_T fingXor)
+    {
+        return Fingerprints<FING_T>::isAccepted(acceptBitmap, fingXor);
+    }
+
     template<typename FING_T>
     inline static bool isHamAtMostK(const char *str1, const char *str2, size_t size, int k)
     {
@@ -96,7 +120,82 @@ public:
     template<typename FING_T>
     inline static bool isLevAtMostK(Fingerprints<FING_T> &fingerprints, const char *str1, size_t size1, const char *str2, size_t size2, int k)
     {
-        return fingerprints.isLevAtMostK(str1, size1, str2, size2, k);
+        fingerprints.prepareContext(fingerprints.defaultContext);
+        return fingerprints.isLevAtMostK(fingerprints.defaultContext, str1, size1, str2, size2, k);
+    }
+
+    template<typename FING_T>
+    inline static bool isOsaAtMostK(Fingerprints<FING_T> &fingerprints, const char *str1, size_t size1, const char *str2, size_t size2, int k)
+    {
+        typename Fingerprints<FING_T>::QueryContext &context = fingerprints.defaultContext;
+        fingerprints.prepareContext(context);
+
+        fingerprints.setOsaPattern(context, str1, size1);
+        const bool res = fingerprints.isOsaAtMostK(context, str1, size1, str2, size2, k);
+        fingerprints.clearOsaPattern(context, str1, size1);
+
+        return res;
+    }
+
+    template<typename FING_T>
+    inline static bool isOsaAtMostKDP(Fingerprints<FING_T> &fingerprints, const char *str1, size_t size1, const char *str2, size_t size2, int k)
+    {
+        fingerprints.prepareContext(fingerprints.defaultContext);
+        return fingerprints.isOsaAtMostKDP(fingerprints.defaultContext, str1, size1, str2, size2, k);
+    }
+
+    template<typename FING_T, int K>
+    inline static bool isHamAtMost(const char *str1, const char *str2, size_t size, int k)
+    {
+        return Fingerprints<FING_T>::template isHamAtMost<K>(str1, str2, size, k);
+    }
+
+    template<typename FING_T, int K>
+    inline static bool isLevAtMost(Fingerprints<FING_T> &fingerprints, const char *str1, size_t size1, const char *str2, size_t size2, int k)
+    {
+        fingerprints.prepareContext(fingerprints.defaultContext);
+        return fingerprints.template isLevAtMost<K>(fingerprints.defaultContext, str1, size1, str2, size2, k);
+    }
+
+    template<typename FING_T>
+    inline static std::vector<std::string> makePlannerSamples(Fingerprints<FING_T> &fingerprints, const std::vector<std::string> &words)
+    {
+        fingerprints.prepareContext(fingerprints.defaultContext);
+        return fingerprints.makePlannerSamples(words);
+    }
+
+    /** Returns true if none of the lazily calculated accept bitmaps, accepted xors, and maximum accepted weights is set. */
+    template<typename FING_T>
+    inline static bool isAcceptCacheEmpty(const Fingerprints<FING_T> &fingerprints)
+    {
+        for (size_t i = 0; i < Fingerprints<FING_T>::nAcceptBitmaps; ++i)
+        {
+            for (size_t j = 0; j < Fingerprints<FING_T>::nAcceptBitmaps; ++j)
+            {
+                if (fingerprints.acceptBitmaps[i][j].load() != nullptr or fingerprints.acceptedXors[i][j].load() != nullptr
+                    or fingerprints.maxAcceptedWeights[i][j].load() >= 0)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /** Makes the planner choose [plan] for all patterns with [k] errors, the other plans become infinitely expensive. */
+    template<typename FING_T>
+    inline static void forcePlan(Fingerprints<FING_T> &fingerprints, typename Fingerprints<FING_T>::Plan plan, int k)
+    {
+        for (size_t iPlan = 0; iPlan < Fingerprints<FING_T>::nPlans; ++iPlan)
+        {
+            float &unitCostNs = fingerprints.planUnitCostsNs[k][iPlan];
+
+            if (unitCostNs >= 0.0f)
+            {
+                unitCostNs = (iPlan == static_cast<size_t>(plan)) ? 0.0f : std::numeric_limits<float>::infinity();
+            }
+        }
     }
 };
 
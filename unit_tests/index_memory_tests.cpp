@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../index_memory.hpp"
+
+using namespace std;
+
+namespace fingerprints
+{
+
+namespace
+{
+
+vector<size_t> sizes { 0, 1, 100, 4096, 65536, IndexMemory::hugePageSize + 1 };
+
+vector<IndexMemory::Type> memoryTypes {
+    IndexMemory::Type::Default,
+    IndexMemory::Type::HugePages
+};
+
+}
+
+TEST_CASE("is allocating default memory correct", "[memory]")
+{
+    for (size_t size : sizes)
+    {
+        IndexMemory::Backing backing;
+        char *ptr = IndexMemory::allocate(size, IndexMemory::Type::Default, backing);
+
+        REQUIRE(ptr != nullptr);
+        REQUIRE(backing == IndexMemory::Backing::Heap);
+
+        IndexMemory::release(ptr, size, backing);
+    }
+}
+
+TEST_CASE("is allocated memory zeroed and writable", "[memory]")
+{
+    for (auto memoryType : memoryTypes)
+    {
+        for (size_t size : sizes)
+        {
+            IndexMemory::Backing backing;
+            char *ptr = IndexMemory::allocate(size, memoryType, backing);
+
+            REQUIRE(ptr != nullptr);
+
+            size_t nNonZero = 0;
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                nNonZero += (ptr[i] != 0);
+                ptr[i] = static_cast<char>(i);
+            }
+
+            REQUIRE(nNonZero == 0);
+            size_t nMismatches = 0;
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                nMismatches += (ptr[i] != static_cast<char>(i));
+            }
+
+            REQUIRE(nMismatches == 0);
+
+            IndexMemory::release(ptr, size, backing);
+        }
+    }
+}
+
+TEST_CASE("is allocating huge pages memory aligned", "[memory]")
+{
+    IndexMemory::Backing backing;
+    char *ptr = IndexMemory::allocate(IndexMemory::hugePageSize, IndexMemory::Type::HugePages, backing);
+
+    // Falling back to the heap is allowed, e.g. on systems without huge page support.
+    if (backing != IndexMemory::Backing::Heap)
+    {
+        REQUIRE(reinterpret_cast<uintptr_t>(ptr) % IndexMemory::hugePageSize == 0);
+    }
+
+    IndexMemory::release(ptr, IndexMemory::hugePageSize, backing);
+}
+
+TEST_CASE("is locking empty memory correct", "[memory]")
+{
+    REQUIRE(IndexMemory::lock(nullptr, 0) == true);
+    REQUIRE(IndexMemory::lock(vector<uint32_t>()) == true);
+}
+
+TEST_CASE("is releasing null memory correct", "[memory]")
+{
+    IndexMemory::release(nullptr, 0, IndexMemory::Backing::Heap);
+    IndexMemory::release(nullptr, 100, IndexMemory::Backing::HugeTLB);
+}
+
+} // namespace fingerprints
@@ -0,0 +1,258 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "repeat.hpp"
+
+#include "../matcher.hpp"
+#include "../matcher.cpp"
+#include "../fingerprints_c.h"
+#include "../fingerprints_c.cpp"
+
+#include "../helpers.hpp"
+
+using namespace std;
+
+namespace fingerprints
+{
+
+namespace
+{
+
+constexpr int maxK = 3;
+constexpr int nWords = 2000;
+
+const string tmpFileName = "matcher_tmp.dat";
+
+using Engine = Matcher::Engine;
+
+const vector<Matcher::DistanceType> distanceTypes { Matcher::DistanceType::Ham, Matcher::DistanceType::Lev,
+    Matcher::DistanceType::Osa };
+
+/** Returns a random string of [size] characters over a small alphabet, so that many words are close. */
+string genRandomString(size_t size)
+{
+    string str(size, 'a');
+
+    for (char &c : str)
+    {
+        c = "etbx"[rand() % 4];
+    }
+
+    return str;
+}
+
+vector<StringRef> getRefs(const vector<string> &strings)
+{
+    vector<StringRef> refs;
+
+    for (const string &str : strings)
+    {
+        refs.push_back({ str.data(), str.size() });
+    }
+
+    return refs;
+}
+
+}
+
+TEST_CASE("is querying words with matcher correct", "[matcher]")
+{
+    vector<string> words, patterns;
+
+    for (int i = 0; i < nWords; ++i)
+    {
+        words.push_back(genRandomString(1 + rand() % 12));
+    }
+    for (int i = 0; i < nWords / 10; ++i)
+    {
+        patterns.push_back(genRandomString(1 + rand() % 12));
+    }
+
+    const vector<StringRef> wordRefs = getRefs(words), patternRefs = getRefs(patterns);
+
+    IndexOptions plannerOptions;
+    plannerOptions.deletionIndexK = 1;
+    plannerOptions.partitionIndexK = 2;
+    plannerOptions.planner = true;
+
+    for (Matcher::DistanceType distanceType : distanceTypes)
+    {
+        for (const IndexOptions &indexOptions : { IndexOptions(), plannerOptions })
+        {
+            Matcher matcher(distanceType, Matcher::FingerprintType::Occ, Matcher::LettersType::Common, indexOptions);
+            matcher.build(wordRefs.data(), wordRefs.size());
+
+            Engine engine(distanceType, Matcher::FingerprintType::Occ, Matcher::LettersType::Common, indexOptions);
+            engine.preprocess(words);
+
+            Matcher::QueryContext context;
+            vector<uint32_t> nMatches(patterns.size());
+
+            for (int k = 0; k <= maxK; ++k)
+            {
+                const size_t nAllMatches = matcher.query(context, patternRefs.data(), patternRefs.size(), k, nMatches.data());
+                REQUIRE(nAllMatches == static_cast<size_t>(engine.test(patterns, k)));
+
+                for (size_t i = 0; i < patterns.size(); ++i)
+                {
+                    REQUIRE(nMatches[i] == static_cast<uint32_t>(engine.test({ patterns[i] }, k)));
+                }
+
+                REQUIRE(matcher.query(context, patternRefs.data(), patternRefs.size(), k) == nAllMatches);
+            }
+
+            REQUIRE(matcher.query(context, wordRefs.data(), wordRefs.size(), 0) == words.size());
+            REQUIRE_THROWS_AS(matcher.query(context, patternRefs.data(), patternRefs.size(), -1), invalid_argument);
+        }
+    }
+}
+
+TEST_CASE("is querying empty and long patterns with matcher correct", "[matcher]")
+{
+    const vector<string> words { "ala", "ma", "kota", "a" };
+    const vector<StringRef> wordRefs = getRefs(words);
+
+    const string longPattern(3000, 'a');
+    const vector<StringRef> patternRefs { { "", 0 }, { longPattern.data(), longPattern.size() } };
+    uint32_t nMatches[2];
+
+    Matcher::QueryContext context;
+
+    for (Matcher::DistanceType distanceType : distanceTypes)
+    {
+        Matcher matcher(distanceType, Matcher::FingerprintType::Occ, Matcher::LettersType::Common);
+
+        REQUIRE(matcher.query(context, patternRefs.data(), patternRefs.size(), 2) == 0);
+
+        matcher.build(wordRefs.data(), wordRefs.size());
+
+        for (int k = 0; k <= maxK; ++k)
+        {
+            matcher.query(context, patternRefs.data(), patternRefs.size(), k, nMatches);
+
+            // Empty patterns match the words having at most k chars, except for the Hamming distance.
+            const uint32_t nEmptyMatches = (distanceType == Matcher::DistanceType::Ham) ? 0 : (k >= 1) + (k >= 2) + (k >= 3);
+
+            REQUIRE(nMatches[0] == nEmptyMatches);
+            REQUIRE(nMatches[1] == 0);
+        }
+    }
+}
+
+TEST_CASE("is loading words with matcher correct", "[matcher]")
+{
+    Helpers::dumpToFile("ala\nma\nkota\n", tmpFileName, false);
+
+    Matcher matcher(Matcher::DistanceType::Lev, Matcher::FingerprintType::Occ, Matcher::LettersType::Common);
+    matcher.load(tmpFileName);
+
+    Helpers::removeFile(tmpFileName);
+    REQUIRE(Helpers::isFileReadable(tmpFileName) == false);
+
+    const vector<StringRef> patternRefs { { "ala", 3 }, { "kot", 3 }, { "mama", 4 } };
+    uint32_t nMatches[3];
+
+    Matcher::QueryContext context;
+
+    REQUIRE(matcher.query(context, patternRefs.data(), patternRefs.size(), 1, nMatches) == 2);
+    REQUIRE(nMatches[0] == 1);
+    REQUIRE(nMatches[1] == 1);
+    REQUIRE(nMatches[2] == 0);
+
+    // A failed load keeps the previous index.
+    REQUIRE_THROWS_AS(matcher.load(tmpFileName), runtime_error);
+    REQUIRE(matcher.query(context, patternRefs.data(), patternRefs.size(), 2, nMatches) == 2 + 1 + 2);
+}
+
+TEST_CASE("is querying words with C interface correct", "[matcher]")
+{
+    vector<string> words, patterns;
+
+    for (int i = 0; i < nWords; ++i)
+    {
+        words.push_back(genRandomString(1 + rand() % 12));
+    }
+    for (int i = 0; i < nWords / 10; ++i)
+    {
+        patterns.push_back(genRandomString(rand() % 12));
+    }
+
+    vector<const char *> patternPtrs;
+    vector<size_t> patternSizes;
+
+    for (const string &pattern : patterns)
+    {
+        patternPtrs.push_back(pattern.data());
+        patternSizes.push_back(pattern.size());
+    }
+
+    fp_options options;
+    fp_options_init(&options);
+    options.distance_type = FP_DISTANCE_LEV;
+    options.deletion_index_k = 1;
+    options.planner = 1;
+
+    IndexOptions indexOptions;
+    indexOptions.deletionIndexK = 1;
+    indexOptions.planner = true;
+
+    fp_index *index = nullptr;
+    REQUIRE(fp_index_create(&options, &index) == FP_OK);
+    REQUIRE(index != nullptr);
+
+    fp_context *context = nullptr;
+    REQUIRE(fp_context_create(&context) == FP_OK);
+
+    Helpers::dumpToFile(boost::algorithm::join(words, "\n"), tmpFileName, false);
+    REQUIRE(fp_index_load(index, tmpFileName.c_str()) == FP_OK);
+    Helpers::removeFile(tmpFileName);
+
+    Matcher matcher(Matcher::DistanceType::Lev, Matcher::FingerprintType::Occ, Matcher::LettersType::Common, indexOptions);
+    matcher.build(getRefs(words).data(), words.size());
+
+    Matcher::QueryContext matcherContext;
+    vector<uint32_t> nMatches(patterns.size()), nMatcherMatches(patterns.size());
+
+    for (int k = 0; k <= maxK; ++k)
+    {
+        size_t nAllMatches = 0;
+
+        REQUIRE(fp_query(index, context, patternPtrs.data(), patternSizes.data(), patterns.size(), k, nMatches.data(),
+            &nAllMatches) == FP_OK);
+        REQUIRE(nAllMatches == matcher.query(matcherContext, getRefs(patterns).data(), patterns.size(), k, nMatcherMatches.data()));
+        REQUIRE(nMatches == nMatcherMatches);
+    }
+
+    REQUIRE(fp_query(index, context, nullptr, nullptr, 0, 1, nullptr, nullptr) == FP_OK);
+
+    // Errors are reported with status codes and messages, and the index stays usable.
+    REQUIRE(fp_query(index, context, patternPtrs.data(), patternSizes.data(), patterns.size(), -1, nullptr, nullptr)
+        == FP_ERROR_INVALID_ARGUMENT);
+    REQUIRE(string(fp_get_last_error()) == "bad k: -1");
+    REQUIRE(fp_query(index, nullptr, patternPtrs.data(), patternSizes.data(), patterns.size(), 1, nullptr, nullptr)
+        == FP_ERROR_INVALID_ARGUMENT);
+    REQUIRE(fp_index_load(index, tmpFileName.c_str()) == FP_ERROR_IO);
+
+    const char *wordPtrs[] { "ala", "ma", "kota" };
+    const size_t wordSizes[] { 3, 2, 4 };
+    size_t nAllMatches = 0;
+
+    REQUIRE(fp_index_build(index, wordPtrs, wordSizes, 3) == FP_OK);
+    REQUIRE(fp_query(index, context, wordPtrs, wordSizes, 3, 0, nullptr, &nAllMatches) == FP_OK);
+    REQUIRE(nAllMatches == 3);
+
+    fp_context_free(context);
+    fp_index_free(index);
+
+    fp_options_init(&options);
+    options.distance_type = FP_DISTANCE_HAM;
+    options.front_coding = 1;
+
+    REQUIRE(fp_index_create(&options, &index) == FP_ERROR_INVALID_ARGUMENT);
+    REQUIRE(index == nullptr);
+    REQUIRE(fp_index_create(nullptr, &index) == FP_ERROR_INVALID_ARGUMENT);
+}
+
+} // namespace fingerprints
@@ -0,0 +1,60 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../normalization.hpp"
+
+using namespace std;
+
+namespace fingerprints
+{
+
+TEST_CASE("is identity normalization correct", "[normalization]")
+{
+    vector<unsigned char> table = Normalization::makeTable(Normalization::Type::Identity);
+    REQUIRE(table.size() == static_cast<size_t>(Normalization::tableSize));
+
+    for (size_t i = 0; i < Normalization::tableSize; ++i)
+    {
+        REQUIRE(table[i] == i);
+    }
+}
+
+TEST_CASE("is case normalization correct", "[normalization]")
+{
+    vector<unsigned char> table = Normalization::makeTable(Normalization::Type::Case);
+
+    REQUIRE(Normalization::apply(table, "Ala ma KOTA 123") == "ala ma kota 123");
+    REQUIRE(Normalization::apply(table, "[@`{") == "[@`{");
+
+    // Only ASCII letters are folded.
+    REQUIRE(Normalization::apply(table, "\xC9\xE9") == "\xC9\xE9");
+}
+
+TEST_CASE("is Latin-1 normalization correct", "[normalization]")
+{
+    vector<unsigned char> table = Normalization::makeTable(Normalization::Type::Latin1);
+
+    REQUIRE(Normalization::apply(table, "Caf\xE9") == "cafe");
+    REQUIRE(Normalization::apply(table, "\xC0\xC1\xC2\xC3\xC4\xC5\xE0\xE5") == "aaaaaaaa");
+    REQUIRE(Normalization::apply(table, "\xC7\xD1\xD6\xD8\xDC\xDD\xFF") == "cnoouyy");
+
+    // Letters without an ASCII base, and the multiplication and division signs are only case folded, if at all.
+    REQUIRE(Normalization::apply(table, "\xC6\xDF\xD7\xF7\xDE") == "\xE6\xDF\xD7\xF7\xFE");
+}
+
+TEST_CASE("is adding normalization mapping correct", "[normalization]")
+{
+    vector<unsigned char> table = Normalization::makeTable(Normalization::Type::Case);
+    Normalization::addMapping(table, "-\xFF", "_y");
+
+    REQUIRE(Normalization::apply(table, "Long-Term\xFF") == "long_termy");
+
+    REQUIRE_THROWS_AS(Normalization::addMapping(table, "ab", "a"), invalid_argument);
+
+    vector<unsigned char> badTable(10);
+    REQUIRE_THROWS_AS(Normalization::addMapping(badTable, "a", "b"), invalid_argument);
+}
+
+} // namespace fingerprints
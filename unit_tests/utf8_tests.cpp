@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "../utf8.hpp"
+
+using namespace std;
+
+namespace fingerprints
+{
+
+namespace
+{
+
+/** Returns all code points decoded from [str], 0xFFFFFFFF marks an invalid sequence. */
+vector<uint32_t> decodeAll(const string &str)
+{
+    vector<uint32_t> res;
+    size_t pos = 0;
+
+    while (pos < str.size())
+    {
+        uint32_t codePoint;
+        res.push_back(Utf8::decodeNext(str.c_str(), str.size(), pos, codePoint) ? codePoint : 0xFFFFFFFF);
+    }
+
+    return res;
+}
+
+}
+
+TEST_CASE("is decoding valid UTF-8 correct", "[utf8]")
+{
+    REQUIRE(decodeAll("") == vector<uint32_t> { });
+    REQUIRE(decodeAll("abc") == (vector<uint32_t> { 'a', 'b', 'c' }));
+
+    // 2, 3, and 4 byte sequences.
+    REQUIRE(decodeAll("\xC5\xBC\xC3\xB3\xC5\x82w") == (vector<uint32_t> { 0x17C, 0xF3, 0x142, 'w' }));
+    REQUIRE(decodeAll("\xE2\x82\xAC") == vector<uint32_t> { 0x20AC });
+    REQUIRE(decodeAll("\xF0\x9F\x98\x80") == vector<uint32_t> { 0x1F600 });
+
+    // The boundaries of each sequence size.
+    REQUIRE(decodeAll("\x7F\xC2\x80\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF\xF0\x90\x80\x80\xF4\x8F\xBF\xBF")
+        == (vector<uint32_t> { 0x7F, 0x80, 0x7FF, 0x800, 0xFFFF, 0x10000, 0x10FFFF }));
+}
+
+TEST_CASE("is decoding invalid UTF-8 correct", "[utf8]")
+{
+    const uint32_t bad = 0xFFFFFFFF;
+
+    // A continuation byte without a lead byte, and bytes which never occur in UTF-8.
+    REQUIRE(decodeAll("\x80" "a") == (vector<uint32_t> { bad, 'a' }));
+    REQUIRE(decodeAll("\xFF\xFE") == (vector<uint32_t> { bad, bad }));
+
+    // Truncated sequences, including at the end of the string.
+    REQUIRE(decodeAll("\xC5" "a") == (vector<uint32_t> { bad, 'a' }));
+    REQUIRE(decodeAll("a\xE2\x82") == (vector<uint32_t> { 'a', bad, bad }));
+
+    // Overlong encodings, surrogates, and code points above U+10FFFF.
+    REQUIRE(decodeAll("\xC0\xAF") == (vector<uint32_t> { bad, bad }));
+    REQUIRE(decodeAll("\xE0\x80\xAF") == (vector<uint32_t> { bad, bad, bad }));
+    REQUIRE(decodeAll("\xED\xA0\x80") == (vector<uint32_t> { bad, bad, bad }));
+    REQUIRE(decodeAll("\xF4\x90\x80\x80") == (vector<uint32_t> { bad, bad, bad, bad }));
+}
+
+} // namespace fingerprints
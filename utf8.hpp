@@ -0,0 +1,96 @@
+#ifndef UTF8_HPP
+#define UTF8_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fingerprints
+{
+
+/** Decodes UTF-8 encoded strings. */
+class Utf8
+{
+public:
+    Utf8() = delete;
+
+    /** Decodes the code point starting at byte [pos] of [str] having [size] bytes into [codePoint] and advances [pos] past it.
+     * Returns false if the sequence is not valid UTF-8 (truncated, overlong, a surrogate, or above U+10FFFF),
+     * in which case [pos] is advanced by a single byte. */
+    inline static bool decodeNext(const char *str, size_t size, size_t &pos, uint32_t &codePoint);
+
+    /** Maximum number of bytes in a single encoded code point. */
+    static constexpr size_t maxSequenceSize = 4;
+    static constexpr uint32_t maxCodePoint = 0x10FFFF;
+};
+
+bool Utf8::decodeNext(const char *str, size_t size, size_t &pos, uint32_t &codePoint)
+{
+    const unsigned char lead = static_cast<unsigned char>(str[pos]);
+
+    if (lead < 0x80)
+    {
+        codePoint = lead;
+        pos += 1;
+
+        return true;
+    }
+
+    size_t nContinuation;
+    uint32_t minCodePoint;
+
+    if ((lead & 0xE0) == 0xC0)
+    {
+        nContinuation = 1;
+        minCodePoint = 0x80;
+        codePoint = lead & 0x1F;
+    }
+    else if ((lead & 0xF0) == 0xE0)
+    {
+        nContinuation = 2;
+        minCodePoint = 0x800;
+        codePoint = lead & 0x0F;
+    }
+    else if ((lead & 0xF8) == 0xF0)
+    {
+        nContinuation = 3;
+        minCodePoint = 0x10000;
+        codePoint = lead & 0x07;
+    }
+    else
+    {
+        pos += 1;
+        return false;
+    }
+
+    if (pos + nContinuation >= size + 1)
+    {
+        pos += 1;
+        return false;
+    }
+
+    for (size_t i = 1; i <= nContinuation; ++i)
+    {
+        const unsigned char c = static_cast<unsigned char>(str[pos + i]);
+
+        if ((c & 0xC0) != 0x80)
+        {
+            pos += 1;
+            return false;
+        }
+
+        codePoint = (codePoint << 6) | (c & 0x3F);
+    }
+
+    if (codePoint < minCodePoint or codePoint > maxCodePoint or (codePoint >= 0xD800 and codePoint <= 0xDFFF))
+    {
+        pos += 1;
+        return false;
+    }
+
+    pos += nContinuation + 1;
+    return true;
+}
+
+} // namespace fingerprints
+
+#endif // UTF8_HPP